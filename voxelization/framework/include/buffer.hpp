@@ -23,6 +23,7 @@ namespace gpupro {
 			INDIRECT_DISPATCH = GL_DISPATCH_INDIRECT_BUFFER,
 			INDIRECT_DRAW = GL_DRAW_INDIRECT_BUFFER,
 			TRANSFORM_FEEDBACK = GL_TRANSFORM_FEEDBACK_BUFFER,
+			PIXEL_UNPACK = GL_PIXEL_UNPACK_BUFFER,
 		};
 
 		enum Usage
@@ -56,6 +57,7 @@ namespace gpupro {
 		Buffer& operator = (Buffer&& _rhs);
 		Buffer& operator = (const Buffer& _rhs) = delete;
 
+		// All bind methods go through the binding cache of the OGLContext.
 		// Bind as vertex buffer
 		// _offset: offset to the first element in number of elements
 		void bindAsVertexBuffer(GLuint _bindingIndex, GLuint _offset = 0);
@@ -67,6 +69,9 @@ namespace gpupro {
 		//		This gives the offset in byte to the begin of the range.
 		// _size: size of the range in bytes. -1 binds the entire buffer.
 		void bindAsUniformBuffer(GLuint _bindingIndex, GLintptr _offset = 0, GLsizeiptr _size = GLsizeiptr(-1));
+		// Bind as shader storage buffer, the range parameters are the same as
+		// for bindAsUniformBuffer().
+		void bindAsShaderStorageBuffer(GLuint _bindingIndex, GLintptr _offset = 0, GLsizeiptr _size = GLsizeiptr(-1));
 
 		// Upload a small chunk of data to a specific position.
 		// Requires Usage::SUB_DATA_UPDATE.
@@ -94,29 +99,33 @@ namespace gpupro {
 		// Mapping is the recommended way to handle buffer data.
 		// You can read/write the returned pointer until unmap(). If mapped
 		// persistently you must make changes visible through flush() and receive().
-		void* map(MappingFlags _access, GLintptr _offset = 0, GLsizei _size = GLsizei(-1));
+		void* map(MappingFlags _access, GLintptr _offset = 0, GLsizeiptr _size = GLsizeiptr(-1));
 		// Release mapping (pointer becomes invalid), a flush is done automatically
 		// except for PERSISTENT INCOHERENT buffers.
 		void unmap();
 		// Make CPU sided writes visible for the GPU.
 		void flush();
-		// Make GPU sided writes visible on CPU (slow sync!).
+		// Make GPU sided writes visible on CPU (slow sync!). Waits until
+		// the GPU finished all previous commands.
 		// Mapping with the READ flag is doing this automatically except
 		// ASYNCHRONOUS is set.
 		void receive();
 
-		GLuint numElements() const { return m_size / m_elementSize; }
+		GLuint numElements() const { return GLuint(m_size / m_elementSize); }
+		GLuint elementSize() const { return m_elementSize; }
+		// Size in bytes, 64 bit since element size times count can exceed 2 GB.
+		GLsizeiptr size() const { return m_size; }
 
 		GLuint glID() { return m_id; }
 	private:
 		GLuint m_id;
 		Type m_type;
-		GLsizei m_size;
+		GLsizeiptr m_size;
 		GLuint m_elementSize;
 		Usage m_usage;
 
 		GLintptr m_mappedOffset;
-		GLsizei m_mappedSize;
+		GLsizeiptr m_mappedSize;
 	};
 
 } // namespace gpupro
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "buffer.hpp"
+
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace gpupro {
+
+	// A range of elements in a (shared) buffer.
+	struct BufferSlice
+	{
+		Buffer* buffer = nullptr;
+		GLintptr offset = 0;			///< Bytes, a multiple of elementSize
+		GLsizeiptr size = 0;			///< Bytes
+		GLuint elementSize = 0;
+
+		bool isValid() const { return buffer != nullptr; }
+		GLuint firstElement() const { return GLuint(offset / elementSize); }
+		GLuint numElements() const { return GLuint(size / elementSize); }
+
+		// Binds the buffer at the begin of the slice. To share the binding
+		// between slices of the same buffer use buffer->bindAsVertexBuffer()
+		// and firstElement() as base vertex.
+		void bindAsVertexBuffer(GLuint _bindingIndex) const;
+		// Binds the entire buffer, draw with firstElement() as first index.
+		void bindAsIndexBuffer() const;
+		void bindAsUniformBuffer(GLuint _bindingIndex) const;
+		void bindAsShaderStorageBuffer(GLuint _bindingIndex) const;
+		// _offset: bytes relative to the slice.
+		void subDataUpdate(GLintptr _offset, GLsizei _size, const GLvoid* _data) const;
+	};
+
+	// Suballocates slices from a few large immutable buffers instead of
+	// creating one buffer per object. A heap serves one usage class: all
+	// buffers have the same type, usage bits and element size.
+	// Free ranges are kept per buffer in a list ordered by offset. Slices
+	// are placed first-fit and freed ranges merge with their neighbors.
+	// Slices start at a multiple of the element size, which is not enough
+	// for uniform buffer offsets in general.
+	class BufferHeap
+	{
+	public:
+		// _elementsPerBuffer: size of each buffer. Larger allocations get a
+		//		buffer of their own.
+		// SUB_DATA_UPDATE is always added to the usage to upload the initial data.
+		BufferHeap(Buffer::Type _type, GLuint _elementSize, GLuint _elementsPerBuffer, Buffer::Usage _usageBits = Buffer::Usage());
+		BufferHeap(const BufferHeap&) = delete;
+		BufferHeap& operator = (const BufferHeap&) = delete;
+
+		// _data: _numElements elements for initialization or nullptr.
+		BufferSlice allocate(GLuint _numElements, const GLvoid* _data = nullptr);
+		// Return a slice of this heap. The slice must not be used anymore.
+		void free(const BufferSlice& _slice);
+
+		size_t numBuffers() const { return m_pages.size(); }
+		// Allocated bytes (without the free ranges)
+		size_t usedBytes() const { return m_usedBytes; }
+	private:
+		struct Page
+		{
+			std::unique_ptr<Buffer> buffer;
+			std::map<GLuint, GLuint> freeRanges;	///< First element -> number of elements
+		};
+
+		Buffer::Type m_type;
+		GLuint m_elementSize;
+		GLuint m_elementsPerBuffer;
+		Buffer::Usage m_usage;
+		std::vector<Page> m_pages;
+		size_t m_usedBytes;
+	};
+
+} // namespace gpupro
@@ -26,11 +26,65 @@ namespace gpupro {
 
 		// The constructor enables the Debug extension (former KHR_DEBUG,
 		// core since 4.3).
-		OGLContext(DebugSeverity _dbgLevel);
+		// _loadProc: Function loader of the window system (e.g.
+		//		glfwGetProcAddress). Direct state access and parallel
+		//		shader compilation are only used if a loader is given, see
+		//		dsa::load() and Program::enableParallelCompile().
+		OGLContext(DebugSeverity _dbgLevel, GLADloadproc _loadProc = nullptr);
+		~OGLContext();
 
+		// The context which was created last (nullptr before). Texture and
+		// Buffer bind through it to use the binding cache.
+		static OGLContext* current() { return s_current; }
+
+		// Search the extension strings of the context.
+		static bool hasExtension(const char* _name);
+
+		// Compares every single state with the current one.
 		void setState(Pipeline& _pipeline);
+		// Compares one hash per state group, see PipelineStateBlock.
+		void setState(const PipelineStateBlock& _block);
 		void setState(ComputePipeline& _pipeline);
+
+		// Counters of all setState() calls.
+		struct Statistics
+		{
+			uint64_t issuedCalls = 0;	///< State changes which were sent to GL
+			uint64_t skippedCalls = 0;	///< Redundant binds and unchanged state groups of blocks
+		};
+		const Statistics& statistics() const { return m_statistics; }
+		void resetStatistics() { m_statistics = Statistics(); }
+
+		// ***** Resource bindings ********************************************
+		// The context keeps a shadow copy of the texture units, the indexed
+		// uniform and shader storage buffer ranges and the vertex and index
+		// buffers of the bound vertex array. Only changed bindings are sent
+		// to GL. Consecutive changes of the multi-bind variants are set by a
+		// single glBindTextures/glBindBuffersRange.
+		// Texture units are set with glBindTextures, which does not need the
+		// active texture. The active unit stays at EDIT_TEXTURE_UNIT, where
+		// Texture binds itself for uploads.
+		static const GLuint NUM_CACHED_TEXTURE_UNITS = 64;
+		static const GLuint NUM_CACHED_BUFFER_BINDINGS = 64;
+		static const GLuint NUM_CACHED_VERTEX_BUFFERS = 16;
+		static const GLuint EDIT_TEXTURE_UNIT = NUM_CACHED_TEXTURE_UNITS;
+
+		void bindTexture(GLuint _unit, GLuint _texture);
+		void bindTextures(GLuint _firstUnit, GLsizei _count, const GLuint* _textures);
+		// _target: GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER
+		void bindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size);
+		void bindBuffersRange(GLenum _target, GLuint _firstIndex, GLsizei _count, const GLuint* _buffers,
+			const GLintptr* _offsets, const GLsizeiptr* _sizes);
+		void bindVertexBuffer(GLuint _binding, GLuint _buffer, GLintptr _offset, GLsizei _stride);
+		void bindIndexBuffer(GLuint _buffer);
+
+		// Deleted GL names can be reused for new objects. Texture and Buffer
+		// remove their bindings from the cache when they are deleted.
+		void forgetTexture(GLuint _texture);
+		void forgetBuffer(GLuint _buffer);
 	private:
+		static OGLContext* s_current;
+
 		struct {
 			RasterizerState rasterizer;
 			DepthStencilState depthStencil;
@@ -38,7 +92,43 @@ namespace gpupro {
 			// 64 textures is very high. It might be that your GPU does not support
 			// that many. Have a look at GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS.
 			SamplerState* samplerState[64] = {nullptr};
+			GLuint program = 0;
+			unsigned vertexFormat = 0;		///< VertexFormat::serial() of the bound vertex array
+			// Hashes of the last block per group, 0 if unknown.
+			uint64_t rasterizerHash = 0;
+			uint64_t depthStencilHash = 0;
+			uint64_t blendHash = 0;
+			uint64_t samplerHash = 0;
 		} m_currentState;
+		Statistics m_statistics;
+
+		struct BufferRange
+		{
+			GLuint buffer = 0;
+			GLintptr offset = 0;
+			GLsizeiptr size = 0;
+		};
+		// All units/indices are unbound (0) initially.
+		struct {
+			GLuint textures[NUM_CACHED_TEXTURE_UNITS] = {0};
+			BufferRange uniformBuffers[NUM_CACHED_BUFFER_BINDINGS];
+			BufferRange storageBuffers[NUM_CACHED_BUFFER_BINDINGS];
+			// State of the bound vertex array, unknown (buffer ~0) after a
+			// vertex array change.
+			BufferRange vertexBuffers[NUM_CACHED_VERTEX_BUFFERS];	///< size is the stride
+			GLuint indexBuffer = 0;
+		} m_bindings;
+
+		BufferRange* bufferRanges(GLenum _target);
+		void resetVertexArrayBindings();
+
+		// Change the differing single states only.
+		void applyRasterizer(const RasterizerState& _state);
+		void applyDepthStencil(const DepthStencilState& _state);
+		void applyBlend(const BlendState& _state);
+		void applySamplers(SamplerState* const* _samplerState);
+		void bindProgram(GLuint _program);
+		void bindVertexFormat(VertexFormat& _vertexFormat);
 	};
 
 } // namespace gpupro
\ No newline at end of file
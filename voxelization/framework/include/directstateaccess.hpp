@@ -0,0 +1,41 @@
+#pragma once
+
+#include "gl.hpp"
+
+namespace gpupro {
+
+	// Direct state access (core since 4.5, ARB_direct_state_access) edits
+	// objects by name without binding them to a target first.
+	// The included glad loader only covers 4.4. Therefore, the OGLContext
+	// loads the few entry points which are used by Texture and Buffer
+	// itself, if it gets a loader function. Without DSA these classes bind
+	// the object to an edit target instead.
+	namespace dsa {
+
+		// Load the entry points. Returns isAvailable().
+		bool load(GLADloadproc _loadProc);
+		bool isAvailable();
+
+		extern void (APIENTRYP createBuffers)(GLsizei _n, GLuint* _buffers);
+		extern void (APIENTRYP namedBufferStorage)(GLuint _buffer, GLsizeiptr _size, const void* _data, GLbitfield _flags);
+		extern void (APIENTRYP namedBufferSubData)(GLuint _buffer, GLintptr _offset, GLsizeiptr _size, const void* _data);
+		extern void (APIENTRYP clearNamedBufferData)(GLuint _buffer, GLenum _internalFormat, GLenum _format, GLenum _type, const void* _data);
+		extern void* (APIENTRYP mapNamedBufferRange)(GLuint _buffer, GLintptr _offset, GLsizeiptr _length, GLbitfield _access);
+		extern GLboolean (APIENTRYP unmapNamedBuffer)(GLuint _buffer);
+		extern void (APIENTRYP flushMappedNamedBufferRange)(GLuint _buffer, GLintptr _offset, GLsizeiptr _length);
+
+		extern void (APIENTRYP createTextures)(GLenum _target, GLsizei _n, GLuint* _textures);
+		extern void (APIENTRYP textureStorage1D)(GLuint _texture, GLsizei _levels, GLenum _internalFormat, GLsizei _width);
+		extern void (APIENTRYP textureStorage2D)(GLuint _texture, GLsizei _levels, GLenum _internalFormat, GLsizei _width, GLsizei _height);
+		extern void (APIENTRYP textureStorage3D)(GLuint _texture, GLsizei _levels, GLenum _internalFormat, GLsizei _width, GLsizei _height, GLsizei _depth);
+		extern void (APIENTRYP textureSubImage1D)(GLuint _texture, GLint _level, GLint _x, GLsizei _width,
+			GLenum _format, GLenum _type, const void* _pixels);
+		extern void (APIENTRYP textureSubImage2D)(GLuint _texture, GLint _level, GLint _x, GLint _y, GLsizei _width, GLsizei _height,
+			GLenum _format, GLenum _type, const void* _pixels);
+		extern void (APIENTRYP textureSubImage3D)(GLuint _texture, GLint _level, GLint _x, GLint _y, GLint _z,
+			GLsizei _width, GLsizei _height, GLsizei _depth, GLenum _format, GLenum _type, const void* _pixels);
+		extern void (APIENTRYP generateTextureMipmap)(GLuint _texture);
+
+	} // namespace dsa
+
+} // namespace gpupro
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "gl.hpp"
+
+namespace gpupro {
+
+	// A fence marks a position in the command stream. It is signaled when
+	// the GPU finished all commands before it. Use it to find out whether
+	// memory which is written by the CPU (e.g. a persistent mapping) is
+	// still in use.
+	class Fence
+	{
+	public:
+		// Create an empty fence which counts as signaled.
+		Fence();
+		~Fence();
+		// Move but not copy-able
+		Fence(Fence&& _rhs);
+		Fence(const Fence&) = delete;
+		Fence& operator = (Fence&& _rhs);
+		Fence& operator = (const Fence&) = delete;
+
+		// Insert the fence after the commands issued so far. A previous
+		// position is released.
+		void set();
+
+		// Check without waiting.
+		bool isSignaled() const;
+
+		// Block until the GPU reached the fence. The commands are flushed,
+		// so this cannot dead-lock.
+		// Returns false if the wait failed (e.g. lost context).
+		bool wait() const;
+
+		GLsync glID() { return m_sync; }
+	private:
+		GLsync m_sync;
+	};
+
+} // namespace gpupro
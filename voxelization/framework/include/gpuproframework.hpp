@@ -5,12 +5,19 @@
 
 #include "context.hpp"
 #include "buffer.hpp"
+#include "bufferheap.hpp"
 #include "framebuffer.hpp"
 #include "objloader.hpp"
 #include "pipeline.hpp"
 #include "program.hpp"
+#include "programcache.hpp"
+#include "programvariants.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 #include "vertexformat.hpp"
 #include "model.hpp"
-#include "query.hpp"
\ No newline at end of file
+#include "query.hpp"
+#include "fence.hpp"
+#include "uniformring.hpp"
+#include "stagingring.hpp"
+#include "renderqueue.hpp"
\ No newline at end of file
@@ -2,8 +2,43 @@
 
 #include "objloader.hpp"
 #include "buffer.hpp"
+#include "bufferheap.hpp"
+
+#include <vector>
+#include <memory>
 
 namespace gpupro {
+
+	// Shared buffers for many models. The three vertex streams are always
+	// allocated and freed together and have the same number of elements
+	// per buffer. Therefore, a model has the same first vertex in all
+	// streams and models in the same buffers can be drawn with a single
+	// set of bindings (see Model::drawMerged()).
+	class ModelHeap
+	{
+	public:
+		ModelHeap(GLuint _verticesPerBuffer = 1 << 20, GLuint _indicesPerBuffer = 3 << 20);
+		ModelHeap(const ModelHeap&) = delete;
+		ModelHeap& operator = (const ModelHeap&) = delete;
+
+		// Allocate the vertices in all three streams. The slices have the
+		// same first element, otherwise it throws.
+		// _data: _numVertices elements per stream for initialization or nullptr.
+		void allocateVertices(GLuint _numVertices, const GLvoid* _positions, const GLvoid* _tangentSpaces, const GLvoid* _texCoords,
+			BufferSlice& _positionSlice, BufferSlice& _tangentSpaceSlice, BufferSlice& _texCoordSlice);
+		// Return the slices of allocateVertices().
+		void freeVertices(const BufferSlice& _positionSlice, const BufferSlice& _tangentSpaceSlice, const BufferSlice& _texCoordSlice);
+
+		BufferSlice allocateIndices(GLuint _numIndices, const GLvoid* _data = nullptr) { return m_indices.allocate(_numIndices, _data); }
+		void freeIndices(const BufferSlice& _slice) { m_indices.free(_slice); }
+	private:
+		// Only used together, so the streams stay in sync.
+		BufferHeap m_positions;
+		BufferHeap m_tangentSpaces;
+		BufferHeap m_texCoords;
+		BufferHeap m_indices;
+	};
+
 	// The model is a helper class which takes data from a loader
 	// (currently there is only the objloader) and handles the binding
 	// of the data.
@@ -16,7 +51,14 @@ namespace gpupro {
 	class Model
 	{
 	public:
+		// Create buffers for this model only.
 		Model(const OBJLoader& _loader);
+		// Suballocate slices from the heap. The heap must outlive the model.
+		Model(const OBJLoader& _loader, ModelHeap& _heap);
+		~Model();
+		// Not copy-able, the slices are returned to the heap in the destructor
+		Model(const Model&) = delete;
+		Model& operator = (const Model&) = delete;
 
 		enum class DrawPrimitiveType {
 			TRIANGLES = GL_TRIANGLES,
@@ -32,21 +74,39 @@ namespace gpupro {
 		//		A negative number causes the buffer to not be bound.
 		// _texBindIdx: Binding slot of the texCoord-vertex buffer.
 		//		A negative number causes the buffer to not be bound.
+		// The buffers are bound entirely, models which share them keep the
+		// bindings.
 		void bind(int _posBindIdx, int _tsBindIdx, int _texBindIdx);
 
 		// Call glDrawElements for the entire internal vertex buffer.
 		void draw(DrawPrimitiveType _primType = DrawPrimitiveType::TRIANGLES) const;
 
+		// Draw several models. Consecutive models in the same buffers are
+		// bound once and drawn with one glMultiDrawElementsBaseVertex.
+		// The binding parameters are the same as for bind().
+		static void drawMerged(const std::vector<Model*>& _models, int _posBindIdx, int _tsBindIdx, int _texBindIdx,
+			DrawPrimitiveType _primType = DrawPrimitiveType::TRIANGLES);
+
+		const BufferSlice& positions() const { return m_positions; }
+		const BufferSlice& tangentSpaces() const { return m_tangentSpaces; }
+		const BufferSlice& texCoords() const { return m_texCoords; }
+		const BufferSlice& indices() const { return m_indices; }
+
 		const glm::vec3& boundingBoxMin() const { return m_bbMin; }
 		const glm::vec3& boundingBoxMax() const { return m_bbMax; }
 	private:
-		Buffer m_positions;
-		Buffer m_tangentSpaces;
-		Buffer m_texCoords;
-		Buffer m_indices;
+		ModelHeap* m_heap;						///< nullptr if the model owns its buffers
+		std::unique_ptr<Buffer> m_buffers[4];	///< Own buffers without heap
+		BufferSlice m_positions;
+		BufferSlice m_tangentSpaces;
+		BufferSlice m_texCoords;
+		BufferSlice m_indices;
 
 		glm::vec3 m_bbMin;
 		glm::vec3 m_bbMax;
+
+		void computeBoundingBox(const OBJLoader& _loader);
+		bool sharesBuffers(const Model& _other) const;
 	};
 
 } // namespace gpupro
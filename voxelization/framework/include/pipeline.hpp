@@ -4,6 +4,7 @@
 #include "vertexformat.hpp"
 
 #include "gl.hpp"
+#include <cstdint>
 
 namespace gpupro {
 
@@ -239,7 +240,8 @@ namespace gpupro {
 	//	  OGLContext::setState() will do as few as possible real state changes
 	//	  on GPU side. However, each state is tested if it changed since the
 	//	  previous state. All together this can be faster or slower than a raw
-	//	  implementation with many states.
+	//	  implementation with many states. A PipelineStateBlock replaces most
+	//	  of these tests by a few hash compares.
 	//	* API upward compatibility DX12 and Vulkan follow the same concept.
 	struct Pipeline
 	{
@@ -261,4 +263,31 @@ namespace gpupro {
 		Program* shader = nullptr;
 	};
 
+	// Immutable copy of a Pipeline which is precompiled for fast state
+	// changes. Each state group (rasterizer, depth-stencil, blend and
+	// samplers) gets a 64 bit content hash. OGLContext::setState() compares
+	// one hash per group with the previous block and only looks at the
+	// single states of groups which changed. Equal hashes of different
+	// states are practically impossible.
+	// Create the blocks outside of the render loop. Later changes to the
+	// source Pipeline are not seen by the block.
+	class PipelineStateBlock
+	{
+	public:
+		explicit PipelineStateBlock(const Pipeline& _pipeline);
+
+		const Pipeline& state() const { return m_state; }
+		uint64_t rasterizerHash() const { return m_rasterizerHash; }
+		uint64_t depthStencilHash() const { return m_depthStencilHash; }
+		uint64_t blendHash() const { return m_blendHash; }
+		uint64_t samplerHash() const { return m_samplerHash; }
+	private:
+		Pipeline m_state;
+		// Hashes are never 0, which marks an unknown state in the context.
+		uint64_t m_rasterizerHash;
+		uint64_t m_depthStencilHash;
+		uint64_t m_blendHash;
+		uint64_t m_samplerHash;
+	};
+
 } // namespace gpupro
\ No newline at end of file
@@ -35,13 +35,27 @@ namespace gpupro {
 		void attach(class Shader& _shader);
 		// Link all the shaders now.
 		void link();
+		// Only start linking, see isReady().
+		void linkAsync();
+		// Check without blocking whether compiling and linking finished.
+		// This needs KHR_parallel_shader_compile, otherwise it is always
+		// true and checkLinkStatus() may still wait for the driver.
+		bool isReady() const;
+		// Wait for linking. Throws with the info log on errors.
+		void checkLinkStatus();
+
+		// Load KHR/ARB_parallel_shader_compile and let the driver use as
+		// many compiler threads as it likes. Returns false if the extension
+		// is missing.
+		static bool enableParallelCompile(GLADloadproc _loadProc);
 		// Aplly transform feedback if wished
 		void applyFeedback(TransformFeedback _feedback, std::initializer_list<std::string> _fbVaryings) const;
 
 		// Load from cached binary data (core since 4.1). This includes an
 		// implicit linking.
-		// The binary blob is driver dependent!
-		void loadFromBinary(GLenum _binaryFormat, const std::vector<unsigned char>& _binary);
+		// The binary blob is driver dependent! Returns false if the driver
+		// rejected it, the program must be linked from source then.
+		bool loadFromBinary(GLenum _binaryFormat, const std::vector<unsigned char>& _binary);
 		// Load a shader from a binary blob which was compiled
 		// for the very same driver.
 		// _binaryFormat: Second return value which specifies the format
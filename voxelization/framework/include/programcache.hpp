@@ -0,0 +1,87 @@
+#pragma once
+
+#include "program.hpp"
+#include "shader.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <initializer_list>
+
+namespace gpupro {
+
+	// Program binaries on disk. The file of a program is named after a
+	// hash of the preprocessed shader sources, the driver (vendor, renderer, version)
+	// and the transform feedback varyings. If the file exists and the
+	// driver accepts the binary, nothing is compiled. Otherwise the
+	// program is compiled and linked from source and the file is written.
+	// loadAsync() only starts compiling and linking. Meanwhile the driver
+	// compiles in the background (in parallel with
+	// KHR_parallel_shader_compile), errors are reported by Future::get().
+	class ProgramCache
+	{
+	public:
+		struct Stage
+		{
+			Shader::Type type;
+			const char* fileName;
+		};
+
+		// A program which may still be compiled by the driver.
+		class Future
+		{
+		public:
+			Future(Future&&) = default;
+			Future& operator = (Future&&) = default;
+
+			// Non-blocking if the driver supports KHR_parallel_shader_compile,
+			// see Program::isReady().
+			bool isReady() const { return m_program.isReady(); }
+			// Wait for the program, throws compile and link errors and
+			// stores the binary. Can be called only once.
+			Program get();
+		private:
+			friend class ProgramCache;
+			Future(ProgramCache& _cache) : m_cache(&_cache), m_key(0) {}
+
+			ProgramCache* m_cache;
+			Program m_program;
+			std::vector<std::unique_ptr<Shader>> m_shaders;	///< Empty if loaded from a binary
+			std::string m_fileName;
+			uint64_t m_key;
+		};
+
+		// _directory: created if it does not exist.
+		ProgramCache(const char* _directory);
+
+		// _defines: added to all stages, see Shader::preprocess(). Each
+		//		define set is a separate binary.
+		Future loadAsync(const std::vector<Stage>& _stages, const Shader::Defines& _defines,
+			Program::TransformFeedback _feedback = Program::TransformFeedback::NONE, std::initializer_list<std::string> _fbVaryings = {});
+		Future loadAsync(const std::vector<Stage>& _stages, Program::TransformFeedback _feedback = Program::TransformFeedback::NONE,
+			std::initializer_list<std::string> _fbVaryings = {});
+		// Equivalent to loadAsync(...).get()
+		Program load(const std::vector<Stage>& _stages, const Shader::Defines& _defines,
+			Program::TransformFeedback _feedback = Program::TransformFeedback::NONE, std::initializer_list<std::string> _fbVaryings = {});
+		Program load(const std::vector<Stage>& _stages, Program::TransformFeedback _feedback = Program::TransformFeedback::NONE,
+			std::initializer_list<std::string> _fbVaryings = {});
+
+		// Programs which were loaded from binaries/compiled since creation
+		size_t numLoaded() const { return m_numLoaded; }
+		size_t numCompiled() const { return m_numCompiled; }
+		// Time spent in load(), loadAsync() and Future::get() in ms. Compare
+		// a cold (empty directory) and a warm start.
+		double loadTime() const { return m_loadTime; }
+	private:
+		std::string m_directory;
+		std::string m_driver;
+		bool m_supported;				///< The driver has at least one binary format
+		size_t m_numLoaded;
+		size_t m_numCompiled;
+		double m_loadTime;
+
+		bool readBinary(const std::string& _fileName, uint64_t _key, Program& _program) const;
+		void writeBinary(const std::string& _fileName, uint64_t _key, Program& _program) const;
+	};
+
+} // namespace gpupro
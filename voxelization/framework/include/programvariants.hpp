@@ -0,0 +1,37 @@
+#pragma once
+
+#include "programcache.hpp"
+
+#include <map>
+
+namespace gpupro {
+
+	// Specializations of the same stages for different define sets (e.g.
+	// one program per data format or mode), such that hot loops do not
+	// branch on uniforms. Each variant is loaded through the ProgramCache
+	// on the first request and kept until destruction. The addresses of
+	// the programs do not change, pipelines can point to them.
+	class ProgramVariants
+	{
+	public:
+		// The cache must outlive this object.
+		ProgramVariants(ProgramCache& _cache, std::initializer_list<ProgramCache::Stage> _stages);
+		ProgramVariants(const ProgramVariants&) = delete;
+		ProgramVariants& operator = (const ProgramVariants&) = delete;
+
+		// Start compiling a variant which will be needed later. Does
+		// nothing if the variant was requested before.
+		void prepare(const Shader::Defines& _defines);
+		// The variant for the define set. Waits for (or starts and waits
+		// for) the compilation if it is not ready yet.
+		Program& get(const Shader::Defines& _defines);
+
+		size_t numVariants() const { return m_programs.size() + m_pending.size(); }
+	private:
+		ProgramCache& m_cache;
+		std::vector<ProgramCache::Stage> m_stages;
+		std::map<Shader::Defines, Program> m_programs;
+		std::map<Shader::Defines, ProgramCache::Future> m_pending;	///< Prepared but not requested yet
+	};
+
+} // namespace gpupro
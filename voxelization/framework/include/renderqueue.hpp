@@ -0,0 +1,122 @@
+#pragma once
+
+#include "context.hpp"
+#include "buffer.hpp"
+#include "bufferheap.hpp"
+#include "texture.hpp"
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+namespace gpupro {
+
+	// Textures and buffers which are bound before a draw. Items of a
+	// RenderQueue which share the same object are bound only once.
+	// Consecutive texture units and uniform/shader storage indices are set
+	// with one multi-bind call.
+	struct ResourceBindings
+	{
+		struct TextureBinding
+		{
+			Texture* texture;
+			GLuint bindingIndex;
+		};
+
+		struct BufferBinding
+		{
+			enum class Target
+			{
+				VERTEX,
+				INDEX,
+				UNIFORM,
+				SHADER_STORAGE
+			};
+
+			Buffer* buffer;
+			Target target;
+			GLuint bindingIndex;			///< Ignored for INDEX
+			GLintptr offset;				///< Bytes for UNIFORM and SHADER_STORAGE, elements for VERTEX
+			GLsizeiptr size;				///< -1 binds the remaining buffer
+
+			// Binding of a heap slice. Vertex slices are bound at their
+			// first element, index slices bind the entire buffer (draw with
+			// the first element as first index).
+			static BufferBinding fromSlice(const BufferSlice& _slice, Target _target, GLuint _bindingIndex = 0);
+		};
+
+		std::vector<TextureBinding> textures;
+		std::vector<BufferBinding> buffers;
+
+		void apply() const;
+	};
+
+	// Arguments of a glDrawArrays*/glDrawElements* call.
+	struct DrawArgs
+	{
+		GLenum primitive = GL_TRIANGLES;
+		GLint first = 0;					///< First vertex or index
+		GLsizei count = 0;
+		GLsizei instanceCount = 1;
+		GLuint baseInstance = 0;
+		bool indexed = false;				///< Draw 32 bit indices from the bound index buffer
+	};
+
+	// Collects the draws of a frame and executes them in an order which
+	// minimizes the state changes. Each item gets a 64 bit key
+	//	bits 48-63: program
+	//	bits 32-47: resource bindings (in order of first submission)
+	//	bits 16-31: folded hashes of the other states and the vertex format
+	//	bits  0-15: depth (front to back)
+	// and the items are sorted by a radix sort. Items with equal keys keep
+	// their submission order.
+	// Blending which depends on the order (back to front) must be drawn
+	// with a separate queue or directly.
+	class RenderQueue
+	{
+	public:
+		// The state block and bindings must live until flush().
+		// _depth: non-negative distance to the camera.
+		void submit(const PipelineStateBlock& _state, const ResourceBindings* _bindings, const DrawArgs& _args, float _depth = 0.0f);
+		// Custom draw call, e.g. a multi-draw or a transform feedback draw.
+		void submit(const PipelineStateBlock& _state, const ResourceBindings* _bindings, std::function<void()> _draw, float _depth = 0.0f);
+
+		// Execute all items (sorted if _sort) and clear the queue.
+		void flush(OGLContext& _context, bool _sort = true);
+
+		size_t size() const { return m_items.size(); }
+
+		// Changes between consecutive items of the last flush.
+		struct Statistics
+		{
+			size_t numItems = 0;
+			size_t stateChangesSubmitted = 0;		///< setState() calls in submission order
+			size_t stateChanges = 0;				///< setState() calls in execution order
+			size_t bindingChangesSubmitted = 0;
+			size_t bindingChanges = 0;
+		};
+		const Statistics& statistics() const { return m_statistics; }
+	private:
+		struct Item
+		{
+			const PipelineStateBlock* state;
+			const ResourceBindings* bindings;
+			DrawArgs args;
+			std::function<void()> draw;		///< Replaces args if set
+		};
+
+		std::vector<Item> m_items;
+		std::vector<uint64_t> m_keys;
+		std::vector<uint32_t> m_order;
+		// Radix sort buffers
+		std::vector<uint64_t> m_tmpKeys;
+		std::vector<uint32_t> m_tmpOrder;
+		std::unordered_map<const ResourceBindings*, uint16_t> m_bindingIDs;
+		Statistics m_statistics;
+
+		void push(const PipelineStateBlock& _state, const ResourceBindings* _bindings, float _depth);
+		void sort();
+		void execute(const Item& _item);
+	};
+
+} // namespace gpupro
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "gl.hpp"
+#include <string>
+#include <map>
 
 namespace gpupro {
 
@@ -19,6 +21,10 @@ namespace gpupro {
 			COMPUTE = GL_COMPUTE_SHADER
 		};
 
+		// Macros which are injected after the #version line, name -> value.
+		// The map is ordered, so equal sets have the same source.
+		typedef std::map<std::string, std::string> Defines;
+
 		Shader(Type _type);
 		// Shortcut: equivalent to Shader(_type) and then loadFromFile(_fileName).
 		Shader(Type _type, const char* _fileName);
@@ -32,14 +38,32 @@ namespace gpupro {
 		// Load from source code and compile.
 		// This is called by loadFromFile indirectly.
 		void loadFromSource(const char* _source, const char* _debugName = nullptr);
-		// Reads the file in memory and calls loadFromSource.
-		void loadFromFile(const char* _fileName);
+		// Only start the compilation. The driver may compile in the
+		// background until the status is queried with checkStatus() or
+		// the program is linked.
+		void compile(const char* _source, const char* _debugName = nullptr);
+		// Wait for the compilation. Throws with the info log on errors.
+		void checkStatus();
+		// Preprocesses the file and calls loadFromSource.
+		void loadFromFile(const char* _fileName, const Defines& _defines = Defines());
+
+		// The file content without any processing.
+		static std::string readFile(const char* _fileName);
+		// The source code which loadFromFile() compiles:
+		// #include "file" is replaced by the file, relative to the directory
+		// of the including file. Every file is included only once per
+		// shader, so shared files need no guards. The source string number
+		// of #line (shown in compile errors) is the position of the file in
+		// the order of first inclusion, 0 is _fileName itself.
+		// _defines are added after the #version line.
+		static std::string preprocess(const char* _fileName, const Defines& _defines = Defines());
 
 		GLuint glID() { return m_id; }
 		GLenum type() const { return m_type; }
 	private:
 		GLuint m_id;
 		GLenum m_type;
+		std::string m_debugName;
 	};
 
 } // namespace gpupro
\ No newline at end of file
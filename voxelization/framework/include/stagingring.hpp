@@ -0,0 +1,110 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "texture.hpp"
+#include "fence.hpp"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace gpupro {
+
+	// Asynchronous texture uploads. The ring consists of a few persistent,
+	// coherent mapped pixel unpack buffers. Worker threads write the texels
+	// of an upload directly into a buffer, the GL thread only issues the
+	// glTex(ture)SubImage call from the buffer offset once the data is
+	// complete. Uploads of one frame share a buffer, which is fenced and
+	// reused when the GPU finished the copies.
+	// The GL thread never waits: if no buffer is free, hasSpace() fails and
+	// the caller retries in a later frame.
+	class StagingRing
+	{
+	public:
+		// Writes the tightly packed texels of the region to _destination.
+		// Runs on a worker thread and must not call OpenGL.
+		typedef std::function<void(void* _destination)> FillFunction;
+		// Called on the GL thread after the copy was issued.
+		typedef std::function<void()> UploadedFunction;
+
+		// _bufferSize: bytes of each buffer, this limits the uploads per frame.
+		// _numThreads: 0 uses one thread per core.
+		StagingRing(GLsizeiptr _bufferSize, int _numBuffers = 3, unsigned _numThreads = 0);
+		~StagingRing();
+		StagingRing(const StagingRing&) = delete;
+		StagingRing& operator = (const StagingRing&) = delete;
+
+		// Check if an upload of _size bytes fits into the current buffer or
+		// into the next one if that is no longer used by the GPU.
+		bool hasSpace(GLsizeiptr _size);
+
+		// Queue the upload of a sub-region (see Texture::setData). Returns
+		// false without a free buffer. The texture must live until the
+		// upload is issued.
+		bool upload(Texture& _texture, GLuint _mipLevel, GLint _x, GLint _y, GLint _z,
+			GLsizei _width, GLsizei _height, GLsizei _depth, SetDataFormat _format, SetDataType _type,
+			GLsizeiptr _size, FillFunction _fill, UploadedFunction _uploaded = nullptr);
+
+		// Issue the copies of all uploads which are filled by now (in order of
+		// upload()) and close the buffer of this frame. Call once per frame.
+		// Returns the number of issued copies.
+		int update();
+
+		// Block until all queued uploads are issued.
+		void finish();
+
+		// Queued uploads which are not issued yet
+		size_t numPending() const { return m_pending.size(); }
+	private:
+		struct Staging
+		{
+			Buffer buffer;
+			char* data;
+			GLsizeiptr used;
+			int numPending;			///< Queued uploads which are not issued yet
+			bool closed;			///< No further uploads until it is reused
+			bool fenced;
+			Fence fence;
+
+			Staging(GLsizeiptr _size);
+		};
+
+		struct Job
+		{
+			Texture* texture;
+			GLuint mipLevel;
+			GLint offset[3];
+			GLsizei size[3];
+			SetDataFormat format;
+			SetDataType type;
+			int staging;
+			GLintptr bufferOffset;
+			FillFunction fill;
+			UploadedFunction uploaded;
+			std::atomic<bool> filled;
+		};
+
+		std::vector<std::unique_ptr<Staging>> m_stagings;
+		int m_current;
+		std::deque<std::unique_ptr<Job>> m_pending;		///< Order of upload()
+
+		// Jobs for the worker threads
+		std::vector<std::thread> m_threads;
+		std::deque<Job*> m_work;
+		std::mutex m_workMutex;
+		std::condition_variable m_workCondition;
+		bool m_stop;
+
+		void workerLoop();
+		// Issue the filled jobs at the front of the queue
+		int issue();
+		// Fence a closed buffer once all its copies are issued.
+		void fenceIfDone(Staging& _staging);
+	};
+
+} // namespace gpupro
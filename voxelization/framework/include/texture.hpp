@@ -10,7 +10,6 @@ namespace gpupro {
 	// There are features not covered by this class:
 	//	* no multi-sampling
 	//	* no compressed formats
-	//	* sub-rectangle updates
 	class Texture
 	{
 	public:
@@ -71,8 +70,20 @@ namespace gpupro {
 		//		per cube map! I.e. indices 0 to 5 are the faces of cube map 0.
 		//		Use 0 for other texture layouts.
 		void setData(GLuint _mipLevel, GLuint _layer, SetDataFormat _format, SetDataType _type, const void* _data);
+		// Update a sub-region of a mip level.
+		// _x, _y, _z: Offset of the region. For CUBE_MAP, ARRAY_2D and ARRAY_CUBE_MAP
+		//		the z-coordinates are layers. Unused coordinates must be 0.
+		//		Without direct state access cube maps take one face per call.
+		// _width, _height, _depth: Size of the region. Unused sizes must be 1.
+		// _data: Tightly packed texels of the region. Set GL_UNPACK_ROW_LENGTH and
+		//		GL_UNPACK_IMAGE_HEIGHT to read the region from a larger image.
+		//		If a GL_PIXEL_UNPACK_BUFFER is bound this is a byte offset into
+		//		that buffer (see StagingRing).
+		void setData(GLuint _mipLevel, GLint _x, GLint _y, GLint _z, GLsizei _width, GLsizei _height, GLsizei _depth,
+			SetDataFormat _format, SetDataType _type, const void* _data);
 
-		// Bind as sampled texture
+		// Bind as sampled texture. Skipped by the OGLContext if the texture is
+		// already bound to the unit.
 		void bindAsTexture(GLuint _bindingIndex);
 
 		GLsizei width() const { return m_size[0]; }
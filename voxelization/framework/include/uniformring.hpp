@@ -0,0 +1,82 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "fence.hpp"
+
+#include <deque>
+#include <cstring>
+
+namespace gpupro {
+
+	// Per-frame uniform data without glBufferSubData. The ring is one
+	// persistent, coherent mapped uniform buffer with space for several
+	// frames in flight. Each frame suballocates aligned blocks, writes
+	// them through the pointer and binds them by offset.
+	// endFrame() puts a fence behind the commands of the frame. Only if an
+	// allocation wraps into memory of a frame which the GPU did not finish
+	// yet, the ring waits for the fence of that frame.
+	class UniformRing
+	{
+	public:
+		// _frameSize: bytes which are expected per frame (blocks are
+		//		aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT).
+		UniformRing(GLsizeiptr _frameSize, int _numFramesInFlight = 3);
+		~UniformRing();
+		UniformRing(const UniformRing&) = delete;
+		UniformRing& operator = (const UniformRing&) = delete;
+
+		struct Block
+		{
+			void* data;					///< Write-only, nullptr if the allocation failed
+			GLintptr offset;			///< Bytes from the begin of buffer()
+			GLsizeiptr size;
+		};
+
+		// The block is valid until the ring wraps around again, i.e. at
+		// least for the current frame.
+		Block allocate(GLsizeiptr _size);
+		// Allocate and copy in one step
+		template<typename T>
+		Block push(const T& _data);
+
+		void bindAsUniformBuffer(GLuint _bindingIndex, const Block& _block);
+
+		// Close the current frame after all draws which use its blocks.
+		void endFrame();
+
+		// Number of allocations which had to wait for the GPU.
+		size_t numStalls() const { return m_numStalls; }
+
+		Buffer& buffer() { return m_buffer; }
+	private:
+		struct Frame
+		{
+			Fence fence;
+			GLsizeiptr numBytes;		///< Including alignment and wrap padding
+		};
+
+		GLsizeiptr m_capacity;
+		GLsizeiptr m_alignment;
+		Buffer m_buffer;
+		char* m_data;
+		GLsizeiptr m_head;				///< Next free byte
+		GLsizeiptr m_used;				///< Bytes of frames in flight and the current frame
+		GLsizeiptr m_frameBytes;		///< Bytes of the current frame
+		std::deque<Frame> m_frames;		///< Frames in flight, oldest first
+		size_t m_numStalls;
+
+		// Release the oldest frame in flight, waits if the GPU is still
+		// using it.
+		void retireFrame();
+	};
+
+	template<typename T>
+	UniformRing::Block UniformRing::push(const T& _data)
+	{
+		Block block = allocate(sizeof(T));
+		if(block.data)
+			memcpy(block.data, &_data, sizeof(T));
+		return block;
+	}
+
+} // namespace gpupro
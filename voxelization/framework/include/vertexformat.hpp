@@ -61,7 +61,7 @@ namespace gpupro {
 	class VertexFormat
 	{
 	public:
-		VertexFormat() : m_id(0) {}
+		VertexFormat() : m_id(0), m_serial(0) {}
 		VertexFormat(const std::vector<VertexAttribute>& _attributes);
 		~VertexFormat();
 		// Move but not copy-able
@@ -71,8 +71,13 @@ namespace gpupro {
 		VertexFormat& operator = (const VertexFormat&) = delete;
 
 		GLuint glID() { return m_id; }
+		// Unique number of each created vertex format. Unlike the GL name it
+		// is never reused after deletion, so the OGLContext can use it to
+		// skip redundant binds.
+		unsigned serial() const { return m_serial; }
 	private:
 		GLuint m_id;
+		unsigned m_serial;
 	};
 
 } // namespace gpupro
\ No newline at end of file
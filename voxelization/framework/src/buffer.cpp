@@ -1,23 +1,34 @@
 #include "buffer.hpp"
+#include "context.hpp"
+#include "directstateaccess.hpp"
+#include "fence.hpp"
 #include <iostream>
 
 gpupro::Buffer::Buffer(Type _type, GLuint _elementSize, GLuint _numElements, Usage _usageBits, const GLvoid* _data) :
 	m_type(_type),
-	m_size(_elementSize * _numElements),
+	m_size(GLsizeiptr(_elementSize) * _numElements),
 	m_elementSize(_elementSize),
 	m_usage(_usageBits),
 	m_mappedOffset(0),
 	m_mappedSize(0)
 {
-	// Generated one buffer
-	glGenBuffers(1, &m_id);
-	// Allocate space
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
-	glBufferStorage(static_cast<GLenum>(m_type), m_size, _data, static_cast<GLbitfield>(_usageBits));
+	if(dsa::isAvailable())
+	{
+		dsa::createBuffers(1, &m_id);
+		dsa::namedBufferStorage(m_id, m_size, _data, static_cast<GLbitfield>(_usageBits));
+	} else {
+		// Generated one buffer
+		glGenBuffers(1, &m_id);
+		// Allocate space. All edits use the copy target, binding an index
+		// buffer would change the bound vertex array.
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, m_size, _data, static_cast<GLbitfield>(_usageBits));
+	}
 }
 
 gpupro::Buffer::~Buffer()
 {
+	if(OGLContext::current()) OGLContext::current()->forgetBuffer(m_id);
 	glDeleteBuffers(1, &m_id);
 }
 
@@ -35,6 +46,7 @@ gpupro::Buffer::Buffer(Buffer&& _rhs) :
 
 gpupro::Buffer& gpupro::Buffer::operator=(Buffer&& _rhs)
 {
+	if(OGLContext::current()) OGLContext::current()->forgetBuffer(m_id);
 	glDeleteBuffers(1, &m_id);
 
 	m_id = _rhs.m_id;
@@ -50,19 +62,34 @@ gpupro::Buffer& gpupro::Buffer::operator=(Buffer&& _rhs)
 
 void gpupro::Buffer::bindAsVertexBuffer(GLuint _bindingIndex, GLuint _offset)
 {
-	glBindVertexBuffer(_bindingIndex, m_id, _offset * m_elementSize, m_elementSize);
+	if(OGLContext::current())
+		OGLContext::current()->bindVertexBuffer(_bindingIndex, m_id, _offset * m_elementSize, m_elementSize);
+	else glBindVertexBuffer(_bindingIndex, m_id, _offset * m_elementSize, m_elementSize);
 }
 
 void gpupro::Buffer::bindAsIndexBuffer()
 {
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
+	if(OGLContext::current())
+		OGLContext::current()->bindIndexBuffer(m_id);
+	else glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
 }
 
 void gpupro::Buffer::bindAsUniformBuffer(GLuint _bindingIndex, GLintptr _offset, GLsizeiptr _size)
 {
 	if(_size == -1)
 		_size = m_size - _offset;
-	glBindBufferRange(GL_UNIFORM_BUFFER, _bindingIndex, m_id, _offset, _size);
+	if(OGLContext::current())
+		OGLContext::current()->bindBufferRange(GL_UNIFORM_BUFFER, _bindingIndex, m_id, _offset, _size);
+	else glBindBufferRange(GL_UNIFORM_BUFFER, _bindingIndex, m_id, _offset, _size);
+}
+
+void gpupro::Buffer::bindAsShaderStorageBuffer(GLuint _bindingIndex, GLintptr _offset, GLsizeiptr _size)
+{
+	if(_size == -1)
+		_size = m_size - _offset;
+	if(OGLContext::current())
+		OGLContext::current()->bindBufferRange(GL_SHADER_STORAGE_BUFFER, _bindingIndex, m_id, _offset, _size);
+	else glBindBufferRange(GL_SHADER_STORAGE_BUFFER, _bindingIndex, m_id, _offset, _size);
 }
 
 void gpupro::Buffer::subDataUpdate(GLintptr _offset, GLsizei _size, const GLvoid* _data)
@@ -73,24 +100,32 @@ void gpupro::Buffer::subDataUpdate(GLintptr _offset, GLsizei _size, const GLvoid
 	}
 
 	if(_size == -1)
-		_size = m_size - (GLsizei)_offset;
-
-	// Bind to arbitrary buffer point to call the storage command
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
-	glBufferSubData(static_cast<GLenum>(m_type), _offset, _size, _data);
+		_size = GLsizei(m_size - _offset);
+
+	if(dsa::isAvailable())
+		dsa::namedBufferSubData(m_id, _offset, _size, _data);
+	else {
+		// Bind to arbitrary buffer point to call the storage command
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, _offset, _size, _data);
+	}
 }
 
 void gpupro::Buffer::clear()
 {
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
 	unsigned zero = 0;
-	glClearBufferData(static_cast<GLenum>(m_type), GL_R32UI, GL_RED, GL_UNSIGNED_INT, &zero);
+	if(dsa::isAvailable())
+		dsa::clearNamedBufferData(m_id, GL_R32UI, GL_RED, GL_UNSIGNED_INT, &zero);
+	else {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+		glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED, GL_UNSIGNED_INT, &zero);
+	}
 }
 
-void* gpupro::Buffer::map(MappingFlags _access, GLintptr _offset, GLsizei _size)
+void* gpupro::Buffer::map(MappingFlags _access, GLintptr _offset, GLsizeiptr _size)
 {
 	if(_size == -1)
-		_size = m_size - (GLsizei)_offset;
+		_size = m_size - _offset;
 
 	GLbitfield access = _access & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
 	if(_access & MappingFlags::PERSISTENT)
@@ -105,26 +140,42 @@ void* gpupro::Buffer::map(MappingFlags _access, GLintptr _offset, GLsizei _size)
 
 	m_mappedOffset = _offset;
 	m_mappedSize = _size;
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
-	return glMapBufferRange(static_cast<GLenum>(m_type), _offset, _size, access);
+	if(dsa::isAvailable())
+		return dsa::mapNamedBufferRange(m_id, _offset, _size, access);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, _offset, _size, access);
 }
 
 void gpupro::Buffer::unmap()
 {
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
-	glUnmapBuffer(static_cast<GLenum>(m_type));
+	if(dsa::isAvailable())
+		dsa::unmapNamedBuffer(m_id);
+	else {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
 }
 
 void gpupro::Buffer::flush()
 {
-	glBindBuffer(static_cast<GLenum>(m_type), m_id);
+	// The flushed range is relative to the mapped range
 	if(m_usage & Usage::MAP_PERSISTENT && !(m_usage & Usage::MAP_COHERENT))
-		glFlushMappedBufferRange(static_cast<GLenum>(m_type), m_mappedOffset, m_mappedSize);
+	{
+		if(dsa::isAvailable())
+			dsa::flushMappedNamedBufferRange(m_id, 0, m_mappedSize);
+		else {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+			glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, m_mappedSize);
+		}
+	}
 	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
 }
 
 void gpupro::Buffer::receive()
 {
 	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
-	glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// Wait until the writes before the barrier are done
+	Fence fence;
+	fence.set();
+	fence.wait();
 }
@@ -0,0 +1,116 @@
+#include "bufferheap.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+
+void gpupro::BufferSlice::bindAsVertexBuffer(GLuint _bindingIndex) const
+{
+	buffer->bindAsVertexBuffer(_bindingIndex, firstElement());
+}
+
+void gpupro::BufferSlice::bindAsIndexBuffer() const
+{
+	buffer->bindAsIndexBuffer();
+}
+
+void gpupro::BufferSlice::bindAsUniformBuffer(GLuint _bindingIndex) const
+{
+	buffer->bindAsUniformBuffer(_bindingIndex, offset, size);
+}
+
+void gpupro::BufferSlice::bindAsShaderStorageBuffer(GLuint _bindingIndex) const
+{
+	buffer->bindAsShaderStorageBuffer(_bindingIndex, offset, size);
+}
+
+void gpupro::BufferSlice::subDataUpdate(GLintptr _offset, GLsizei _size, const GLvoid* _data) const
+{
+	buffer->subDataUpdate(offset + _offset, _size, _data);
+}
+
+gpupro::BufferHeap::BufferHeap(Buffer::Type _type, GLuint _elementSize, GLuint _elementsPerBuffer, Buffer::Usage _usageBits) :
+	m_type(_type),
+	m_elementSize(_elementSize),
+	m_elementsPerBuffer(_elementsPerBuffer),
+	m_usage(Buffer::Usage(_usageBits | Buffer::Usage::SUB_DATA_UPDATE)),
+	m_usedBytes(0)
+{
+}
+
+gpupro::BufferSlice gpupro::BufferHeap::allocate(GLuint _numElements, const GLvoid* _data)
+{
+	BufferSlice slice;
+	if(_numElements == 0)
+		return slice;
+
+	// First fit in the existing buffers
+	Page* page = nullptr;
+	std::map<GLuint, GLuint>::iterator range;
+	for(Page& p : m_pages)
+	{
+		range = std::find_if(p.freeRanges.begin(), p.freeRanges.end(),
+			[_numElements](const std::pair<const GLuint, GLuint>& _range) { return _range.second >= _numElements; });
+		if(range != p.freeRanges.end())
+		{
+			page = &p;
+			break;
+		}
+	}
+	if(!page)
+	{
+		GLuint numElements = std::max(m_elementsPerBuffer, _numElements);
+		m_pages.emplace_back();
+		page = &m_pages.back();
+		page->buffer.reset(new Buffer(m_type, m_elementSize, numElements, m_usage));
+		range = page->freeRanges.emplace(0, numElements).first;
+	}
+
+	GLuint first = range->first;
+	GLuint remaining = range->second - _numElements;
+	page->freeRanges.erase(range);
+	if(remaining > 0)
+		page->freeRanges.emplace(first + _numElements, remaining);
+
+	slice.buffer = page->buffer.get();
+	slice.offset = GLintptr(first) * m_elementSize;
+	slice.size = GLsizeiptr(_numElements) * m_elementSize;
+	slice.elementSize = m_elementSize;
+	if(_data)
+		slice.subDataUpdate(0, GLsizei(slice.size), _data);
+	m_usedBytes += slice.size;
+	return slice;
+}
+
+void gpupro::BufferHeap::free(const BufferSlice& _slice)
+{
+	if(!_slice.isValid())
+		return;
+	auto page = std::find_if(m_pages.begin(), m_pages.end(), [&_slice](const Page& _page) { return _page.buffer.get() == _slice.buffer; });
+	if(page == m_pages.end())
+	{
+		std::cerr << "ERR: The slice does not belong to this heap!\n";
+		return;
+	}
+
+	GLuint first = _slice.firstElement();
+	GLuint count = _slice.numElements();
+	m_usedBytes -= _slice.size;
+	// Merge with the free neighbors
+	auto next = page->freeRanges.lower_bound(first);
+	if(next != page->freeRanges.end() && next->first == first + count)
+	{
+		count += next->second;
+		next = page->freeRanges.erase(next);
+	}
+	if(next != page->freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if(previous->first + previous->second == first)
+		{
+			previous->second += count;
+			return;
+		}
+	}
+	page->freeRanges.emplace_hint(next, first, count);
+}
@@ -1,7 +1,10 @@
 #include "context.hpp"
 #include "gl.hpp"
+#include "directstateaccess.hpp"
+#include "program.hpp"
 #include <iostream>
 #include <string>
+#include <cstring>
 
 static void glDebugOutput(GLenum _source, GLenum _type, GLuint _id, GLenum _severity, GLsizei _length, const GLchar* _message, const void* _userParam)
 {
@@ -51,11 +54,27 @@ static void glDebugOutput(GLenum _source, GLenum _type, GLuint _id, GLenum _seve
 		std::cerr << "WAR: " << logMessage.c_str() << '\n';
 }
 
-gpupro::OGLContext::OGLContext(DebugSeverity _dbgLevel)
+gpupro::OGLContext* gpupro::OGLContext::s_current = nullptr;
+
+bool gpupro::OGLContext::hasExtension(const char* _name)
+{
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for(GLint i = 0; i < numExtensions; ++i)
+		if(strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), _name) == 0)
+			return true;
+	return false;
+}
+
+gpupro::OGLContext::OGLContext(DebugSeverity _dbgLevel, GLADloadproc _loadProc)
 {
-	if(!gladLoadGL())
+	if(!(_loadProc ? gladLoadGLLoader(_loadProc) : gladLoadGL()))
 		throw std::exception("Cannot initialize Glad/load gl-function pointers!\n");
 	std::cerr << "INF: Loaded GL-context is version " << GLVersion.major << '.' << GLVersion.minor << '\n';
+	if(dsa::load(_loadProc))
+		std::cerr << "INF: Using direct state access for textures and buffers\n";
+	if(Program::enableParallelCompile(_loadProc))
+		std::cerr << "INF: Using parallel shader compilation\n";
 
 	// Disable or enable the different levels
 	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, _dbgLevel <= DebugSeverity::NOTIFICATION ? GL_TRUE : GL_FALSE);
@@ -69,210 +88,447 @@ gpupro::OGLContext::OGLContext(DebugSeverity _dbgLevel)
 	// Enable seamless cube map sampling which is always a good idea since
 	// it is core (3.2).
 	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	// Texture units are set by glBindTextures. The active unit is only used
+	// by Texture for uploads and must not be one of the cached units.
+	glActiveTexture(GL_TEXTURE0 + EDIT_TEXTURE_UNIT);
+	resetVertexArrayBindings();
+	s_current = this;
+}
+
+gpupro::OGLContext::~OGLContext()
+{
+	if(s_current == this)
+		s_current = nullptr;
+}
+
+static gpupro::VertexFormat& dummyVertexFormat()
+{
+	// Vertex pulling without attributes still needs a bound vertex array.
+	static gpupro::VertexFormat dummy(std::vector<gpupro::VertexAttribute>{{}});
+	return dummy;
 }
 
 void gpupro::OGLContext::setState(Pipeline& _pipeline)
 {
-	// ***** Rasterizer state *************************************************
-	if(m_currentState.rasterizer.cullMode != _pipeline.rasterizer.cullMode)
+	applyRasterizer(_pipeline.rasterizer);
+	applyDepthStencil(_pipeline.depthStencil);
+	applyBlend(_pipeline.blendState);
+	applySamplers(_pipeline.samplerState);
+	// The current state is no longer the one of a known block
+	m_currentState.rasterizerHash = 0;
+	m_currentState.depthStencilHash = 0;
+	m_currentState.blendHash = 0;
+	m_currentState.samplerHash = 0;
+
+	if(_pipeline.shader) bindProgram(_pipeline.shader->glID());
+	if(_pipeline.vertexFormat) bindVertexFormat(*_pipeline.vertexFormat);
+	else bindVertexFormat(dummyVertexFormat());
+}
+
+void gpupro::OGLContext::setState(const PipelineStateBlock& _block)
+{
+	const Pipeline& state = _block.state();
+	if(m_currentState.rasterizerHash != _block.rasterizerHash())
+	{
+		applyRasterizer(state.rasterizer);
+		m_currentState.rasterizerHash = _block.rasterizerHash();
+	} else ++m_statistics.skippedCalls;
+	if(m_currentState.depthStencilHash != _block.depthStencilHash())
+	{
+		applyDepthStencil(state.depthStencil);
+		m_currentState.depthStencilHash = _block.depthStencilHash();
+	} else ++m_statistics.skippedCalls;
+	if(m_currentState.blendHash != _block.blendHash())
+	{
+		applyBlend(state.blendState);
+		m_currentState.blendHash = _block.blendHash();
+	} else ++m_statistics.skippedCalls;
+	if(m_currentState.samplerHash != _block.samplerHash())
+	{
+		applySamplers(state.samplerState);
+		m_currentState.samplerHash = _block.samplerHash();
+	} else ++m_statistics.skippedCalls;
+
+	if(state.shader) bindProgram(state.shader->glID());
+	if(state.vertexFormat) bindVertexFormat(*state.vertexFormat);
+	else bindVertexFormat(dummyVertexFormat());
+}
+
+void gpupro::OGLContext::setState(ComputePipeline & _pipeline)
+{
+	applySamplers(_pipeline.samplerState);
+	m_currentState.samplerHash = 0;
+
+	if(_pipeline.shader) bindProgram(_pipeline.shader->glID());
+}
+
+void gpupro::OGLContext::applyRasterizer(const RasterizerState& _state)
+{
+	if(m_currentState.rasterizer.cullMode != _state.cullMode)
 	{
-		if(_pipeline.rasterizer.cullMode == RasterizerState::CullMode::NONE)
+		if(_state.cullMode == RasterizerState::CullMode::NONE)
 			glDisable(GL_CULL_FACE);
 		else {
 			glEnable(GL_CULL_FACE);
-			glCullFace(static_cast<GLenum>(_pipeline.rasterizer.cullMode));
+			glCullFace(static_cast<GLenum>(_state.cullMode));
 		}
-		m_currentState.rasterizer.cullMode = _pipeline.rasterizer.cullMode;
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.cullMode = _state.cullMode;
 	}
-	if(m_currentState.rasterizer.frontFaceWinding != _pipeline.rasterizer.frontFaceWinding)
+	if(m_currentState.rasterizer.frontFaceWinding != _state.frontFaceWinding)
 	{
-		glFrontFace(static_cast<GLenum>(_pipeline.rasterizer.frontFaceWinding));
-		m_currentState.rasterizer.frontFaceWinding = _pipeline.rasterizer.frontFaceWinding;
+		glFrontFace(static_cast<GLenum>(_state.frontFaceWinding));
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.frontFaceWinding = _state.frontFaceWinding;
 	}
-	if(m_currentState.rasterizer.fillMode != _pipeline.rasterizer.fillMode)
+	if(m_currentState.rasterizer.fillMode != _state.fillMode)
 	{
-		glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(_pipeline.rasterizer.fillMode));
-		m_currentState.rasterizer.fillMode = _pipeline.rasterizer.fillMode;
+		glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(_state.fillMode));
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.fillMode = _state.fillMode;
 	}
-	if(m_currentState.rasterizer.lineWidth != _pipeline.rasterizer.lineWidth)
+	if(m_currentState.rasterizer.lineWidth != _state.lineWidth)
 	{
-		glLineWidth(_pipeline.rasterizer.lineWidth);
-		m_currentState.rasterizer.lineWidth = _pipeline.rasterizer.lineWidth;
+		glLineWidth(_state.lineWidth);
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.lineWidth = _state.lineWidth;
 	}
-	if(m_currentState.rasterizer.discard != _pipeline.rasterizer.discard)
+	if(m_currentState.rasterizer.discard != _state.discard)
 	{
-		if(_pipeline.rasterizer.discard)
+		if(_state.discard)
 			glEnable(GL_RASTERIZER_DISCARD);
 		else
 			glDisable(GL_RASTERIZER_DISCARD);
-		m_currentState.rasterizer.discard = _pipeline.rasterizer.discard;
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.discard = _state.discard;
 	}
-	if(m_currentState.rasterizer.colorWrite != _pipeline.rasterizer.colorWrite)
+	if(m_currentState.rasterizer.colorWrite != _state.colorWrite)
 	{
-		glColorMask(_pipeline.rasterizer.colorWrite, _pipeline.rasterizer.colorWrite, _pipeline.rasterizer.colorWrite, _pipeline.rasterizer.colorWrite);
-		m_currentState.rasterizer.colorWrite = _pipeline.rasterizer.colorWrite;
+		glColorMask(_state.colorWrite, _state.colorWrite, _state.colorWrite, _state.colorWrite);
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.colorWrite = _state.colorWrite;
 	}
-	if(m_currentState.rasterizer.dithering != _pipeline.rasterizer.dithering)
+	if(m_currentState.rasterizer.dithering != _state.dithering)
 	{
-		if(_pipeline.rasterizer.dithering)
+		if(_state.dithering)
 			glEnable(GL_DITHER);
 		else
 			glDisable(GL_DITHER);
-		m_currentState.rasterizer.dithering = _pipeline.rasterizer.dithering;
+		++m_statistics.issuedCalls;
+		m_currentState.rasterizer.dithering = _state.dithering;
 	}
+}
 
-	// ***** Depth-stencil state **********************************************
-	if(m_currentState.depthStencil.depthTest != _pipeline.depthStencil.depthTest)
+void gpupro::OGLContext::applyDepthStencil(const DepthStencilState& _state)
+{
+	if(m_currentState.depthStencil.depthTest != _state.depthTest)
 	{
-		if(_pipeline.depthStencil.depthTest)
+		if(_state.depthTest)
 			glEnable(GL_DEPTH_TEST);
 		else
 			glDisable(GL_DEPTH_TEST);
-		m_currentState.depthStencil.depthTest = _pipeline.depthStencil.depthTest;
+		++m_statistics.issuedCalls;
+		m_currentState.depthStencil.depthTest = _state.depthTest;
 	}
 	if(m_currentState.depthStencil.depthTest &&
-		m_currentState.depthStencil.depthCmpFunc != _pipeline.depthStencil.depthCmpFunc)
+		m_currentState.depthStencil.depthCmpFunc != _state.depthCmpFunc)
 	{
-		glDepthFunc(static_cast<GLenum>(_pipeline.depthStencil.depthCmpFunc));
-		m_currentState.depthStencil.depthCmpFunc = _pipeline.depthStencil.depthCmpFunc;
+		glDepthFunc(static_cast<GLenum>(_state.depthCmpFunc));
+		++m_statistics.issuedCalls;
+		m_currentState.depthStencil.depthCmpFunc = _state.depthCmpFunc;
 	}
-	if(m_currentState.depthStencil.depthWrite != _pipeline.depthStencil.depthWrite)
+	if(m_currentState.depthStencil.depthWrite != _state.depthWrite)
 	{
-		glDepthMask(_pipeline.depthStencil.depthWrite);
-		m_currentState.depthStencil.depthWrite = _pipeline.depthStencil.depthWrite;
+		glDepthMask(_state.depthWrite);
+		++m_statistics.issuedCalls;
+		m_currentState.depthStencil.depthWrite = _state.depthWrite;
 	}
-	if(m_currentState.depthStencil.stencilTest != _pipeline.depthStencil.stencilTest)
+	if(m_currentState.depthStencil.stencilTest != _state.stencilTest)
 	{
-		if(_pipeline.depthStencil.stencilTest)
+		if(_state.stencilTest)
 			glEnable(GL_STENCIL_TEST);
 		else
 			glDisable(GL_STENCIL_TEST);
-		m_currentState.depthStencil.stencilTest = _pipeline.depthStencil.stencilTest;
+		++m_statistics.issuedCalls;
+		m_currentState.depthStencil.stencilTest = _state.stencilTest;
 	}
 	if(m_currentState.depthStencil.stencilTest)
 	{
-		if(m_currentState.depthStencil.stencilCmpFuncFront != _pipeline.depthStencil.stencilCmpFuncFront
-			|| m_currentState.depthStencil.stencilRefFront != _pipeline.depthStencil.stencilRefFront)
+		if(m_currentState.depthStencil.stencilCmpFuncFront != _state.stencilCmpFuncFront
+			|| m_currentState.depthStencil.stencilRefFront != _state.stencilRefFront)
 		{
-			glStencilFuncSeparate(GL_FRONT, static_cast<GLenum>(_pipeline.depthStencil.stencilCmpFuncFront), _pipeline.depthStencil.stencilRefFront, 0xffffffff);
-			m_currentState.depthStencil.stencilCmpFuncFront = _pipeline.depthStencil.stencilCmpFuncFront;
-			m_currentState.depthStencil.stencilRefFront = _pipeline.depthStencil.stencilRefFront;
+			glStencilFuncSeparate(GL_FRONT, static_cast<GLenum>(_state.stencilCmpFuncFront), _state.stencilRefFront, 0xffffffff);
+			++m_statistics.issuedCalls;
+			m_currentState.depthStencil.stencilCmpFuncFront = _state.stencilCmpFuncFront;
+			m_currentState.depthStencil.stencilRefFront = _state.stencilRefFront;
 		}
-		if(m_currentState.depthStencil.stencilCmpFuncBack != _pipeline.depthStencil.stencilCmpFuncBack
-			|| m_currentState.depthStencil.stencilRefBack != _pipeline.depthStencil.stencilRefBack)
+		if(m_currentState.depthStencil.stencilCmpFuncBack != _state.stencilCmpFuncBack
+			|| m_currentState.depthStencil.stencilRefBack != _state.stencilRefBack)
 		{
-			glStencilFuncSeparate(GL_BACK, static_cast<GLenum>(_pipeline.depthStencil.stencilCmpFuncBack), _pipeline.depthStencil.stencilRefBack, 0xffffffff);
-			m_currentState.depthStencil.stencilCmpFuncBack = _pipeline.depthStencil.stencilCmpFuncBack;
-			m_currentState.depthStencil.stencilRefBack = _pipeline.depthStencil.stencilRefBack;
+			glStencilFuncSeparate(GL_BACK, static_cast<GLenum>(_state.stencilCmpFuncBack), _state.stencilRefBack, 0xffffffff);
+			++m_statistics.issuedCalls;
+			m_currentState.depthStencil.stencilCmpFuncBack = _state.stencilCmpFuncBack;
+			m_currentState.depthStencil.stencilRefBack = _state.stencilRefBack;
 		}
-		if(m_currentState.depthStencil.stencilFailOpFront != _pipeline.depthStencil.stencilFailOpFront
-			|| m_currentState.depthStencil.zfailOpFront != _pipeline.depthStencil.zfailOpFront
-			|| m_currentState.depthStencil.passOpFront != _pipeline.depthStencil.passOpFront)
+		if(m_currentState.depthStencil.stencilFailOpFront != _state.stencilFailOpFront
+			|| m_currentState.depthStencil.zfailOpFront != _state.zfailOpFront
+			|| m_currentState.depthStencil.passOpFront != _state.passOpFront)
 		{
-			glStencilOpSeparate(GL_FRONT, static_cast<GLenum>(_pipeline.depthStencil.stencilFailOpFront),
-				static_cast<GLenum>(_pipeline.depthStencil.zfailOpFront),
-				static_cast<GLenum>(_pipeline.depthStencil.passOpFront));
-			m_currentState.depthStencil.stencilFailOpFront = _pipeline.depthStencil.stencilFailOpFront;
-			m_currentState.depthStencil.zfailOpFront = _pipeline.depthStencil.zfailOpFront;
-			m_currentState.depthStencil.passOpFront = _pipeline.depthStencil.passOpFront;
+			glStencilOpSeparate(GL_FRONT, static_cast<GLenum>(_state.stencilFailOpFront),
+				static_cast<GLenum>(_state.zfailOpFront),
+				static_cast<GLenum>(_state.passOpFront));
+			++m_statistics.issuedCalls;
+			m_currentState.depthStencil.stencilFailOpFront = _state.stencilFailOpFront;
+			m_currentState.depthStencil.zfailOpFront = _state.zfailOpFront;
+			m_currentState.depthStencil.passOpFront = _state.passOpFront;
 		}
-		if(m_currentState.depthStencil.stencilFailOpBack != _pipeline.depthStencil.stencilFailOpBack
-			|| m_currentState.depthStencil.zfailOpBack != _pipeline.depthStencil.zfailOpBack
-			|| m_currentState.depthStencil.passOpBack != _pipeline.depthStencil.passOpBack)
+		if(m_currentState.depthStencil.stencilFailOpBack != _state.stencilFailOpBack
+			|| m_currentState.depthStencil.zfailOpBack != _state.zfailOpBack
+			|| m_currentState.depthStencil.passOpBack != _state.passOpBack)
 		{
-			glStencilOpSeparate(GL_BACK, static_cast<GLenum>(_pipeline.depthStencil.stencilFailOpBack),
-				static_cast<GLenum>(_pipeline.depthStencil.zfailOpBack),
-				static_cast<GLenum>(_pipeline.depthStencil.passOpBack));
-			m_currentState.depthStencil.stencilFailOpBack = _pipeline.depthStencil.stencilFailOpBack;
-			m_currentState.depthStencil.zfailOpBack = _pipeline.depthStencil.zfailOpBack;
-			m_currentState.depthStencil.passOpBack = _pipeline.depthStencil.passOpBack;
+			glStencilOpSeparate(GL_BACK, static_cast<GLenum>(_state.stencilFailOpBack),
+				static_cast<GLenum>(_state.zfailOpBack),
+				static_cast<GLenum>(_state.passOpBack));
+			++m_statistics.issuedCalls;
+			m_currentState.depthStencil.stencilFailOpBack = _state.stencilFailOpBack;
+			m_currentState.depthStencil.zfailOpBack = _state.zfailOpBack;
+			m_currentState.depthStencil.passOpBack = _state.passOpBack;
 		}
 	}
+}
 
-	// ***** Blend state ******************************************************
-	if(m_currentState.blendState.enableBlending != _pipeline.blendState.enableBlending)
+void gpupro::OGLContext::applyBlend(const BlendState& _state)
+{
+	if(m_currentState.blendState.enableBlending != _state.enableBlending)
 	{
-		if(_pipeline.blendState.enableBlending == BlendState::BlendMode::BLEND) {
+		if(_state.enableBlending == BlendState::BlendMode::BLEND) {
 			glEnable(GL_BLEND);
 			glDisable(GL_COLOR_LOGIC_OP);
-		} else if(_pipeline.blendState.enableBlending == BlendState::BlendMode::LOGIC)
+		} else if(_state.enableBlending == BlendState::BlendMode::LOGIC)
 			glEnable(GL_COLOR_LOGIC_OP);
 		else {
 			glDisable(GL_BLEND);
 			glDisable(GL_COLOR_LOGIC_OP);
 		}
-		m_currentState.blendState.enableBlending = _pipeline.blendState.enableBlending;
+		++m_statistics.issuedCalls;
+		m_currentState.blendState.enableBlending = _state.enableBlending;
 	}
 	if(m_currentState.blendState.enableBlending == BlendState::BlendMode::BLEND)
 	{
 		for(int i = 0; i < 8; ++i)
 		{
-			if(m_currentState.blendState.buf[i].colorBlendOp != _pipeline.blendState.buf[i].colorBlendOp
-				|| m_currentState.blendState.buf[i].alphaBlendOp != _pipeline.blendState.buf[i].alphaBlendOp)
+			if(m_currentState.blendState.buf[i].colorBlendOp != _state.buf[i].colorBlendOp
+				|| m_currentState.blendState.buf[i].alphaBlendOp != _state.buf[i].alphaBlendOp)
 			{
-				glBlendEquationSeparatei(i, static_cast<GLenum>(_pipeline.blendState.buf[i].colorBlendOp), static_cast<GLenum>(_pipeline.blendState.buf[i].alphaBlendOp));
-				m_currentState.blendState.buf[i].colorBlendOp = _pipeline.blendState.buf[i].colorBlendOp;
-				m_currentState.blendState.buf[i].alphaBlendOp = _pipeline.blendState.buf[i].alphaBlendOp;
+				glBlendEquationSeparatei(i, static_cast<GLenum>(_state.buf[i].colorBlendOp), static_cast<GLenum>(_state.buf[i].alphaBlendOp));
+				++m_statistics.issuedCalls;
+				m_currentState.blendState.buf[i].colorBlendOp = _state.buf[i].colorBlendOp;
+				m_currentState.blendState.buf[i].alphaBlendOp = _state.buf[i].alphaBlendOp;
 			}
-			if(m_currentState.blendState.buf[i].srcColorFactor != _pipeline.blendState.buf[i].srcColorFactor
-				|| m_currentState.blendState.buf[i].srcAlphaFactor != _pipeline.blendState.buf[i].srcAlphaFactor
-				|| m_currentState.blendState.buf[i].dstColorFactor != _pipeline.blendState.buf[i].dstColorFactor
-				|| m_currentState.blendState.buf[i].dstAlphaFactor != _pipeline.blendState.buf[i].dstAlphaFactor)
+			if(m_currentState.blendState.buf[i].srcColorFactor != _state.buf[i].srcColorFactor
+				|| m_currentState.blendState.buf[i].srcAlphaFactor != _state.buf[i].srcAlphaFactor
+				|| m_currentState.blendState.buf[i].dstColorFactor != _state.buf[i].dstColorFactor
+				|| m_currentState.blendState.buf[i].dstAlphaFactor != _state.buf[i].dstAlphaFactor)
 			{
 				glBlendFuncSeparatei(i,
-					static_cast<GLenum>(_pipeline.blendState.buf[i].srcColorFactor), static_cast<GLenum>(_pipeline.blendState.buf[i].dstColorFactor),
-					static_cast<GLenum>(_pipeline.blendState.buf[i].srcAlphaFactor), static_cast<GLenum>(_pipeline.blendState.buf[i].dstAlphaFactor));
-				m_currentState.blendState.buf[i].srcColorFactor = _pipeline.blendState.buf[i].srcColorFactor;
-				m_currentState.blendState.buf[i].srcAlphaFactor = _pipeline.blendState.buf[i].srcAlphaFactor;
-				m_currentState.blendState.buf[i].dstColorFactor = _pipeline.blendState.buf[i].dstColorFactor;
-				m_currentState.blendState.buf[i].dstAlphaFactor = _pipeline.blendState.buf[i].dstAlphaFactor;
+					static_cast<GLenum>(_state.buf[i].srcColorFactor), static_cast<GLenum>(_state.buf[i].dstColorFactor),
+					static_cast<GLenum>(_state.buf[i].srcAlphaFactor), static_cast<GLenum>(_state.buf[i].dstAlphaFactor));
+				++m_statistics.issuedCalls;
+				m_currentState.blendState.buf[i].srcColorFactor = _state.buf[i].srcColorFactor;
+				m_currentState.blendState.buf[i].srcAlphaFactor = _state.buf[i].srcAlphaFactor;
+				m_currentState.blendState.buf[i].dstColorFactor = _state.buf[i].dstColorFactor;
+				m_currentState.blendState.buf[i].dstAlphaFactor = _state.buf[i].dstAlphaFactor;
 			}
 		}
 	}
-	if(m_currentState.blendState.logicOp != _pipeline.blendState.logicOp)
+	if(m_currentState.blendState.logicOp != _state.logicOp)
 	{
-		glLogicOp(static_cast<GLenum>(_pipeline.blendState.logicOp));
-		m_currentState.blendState.logicOp = _pipeline.blendState.logicOp;
+		glLogicOp(static_cast<GLenum>(_state.logicOp));
+		++m_statistics.issuedCalls;
+		m_currentState.blendState.logicOp = _state.logicOp;
 	}
-	if(m_currentState.blendState.alphaToCoverage != _pipeline.blendState.alphaToCoverage)
+	if(m_currentState.blendState.alphaToCoverage != _state.alphaToCoverage)
 	{
-		if(_pipeline.blendState.alphaToCoverage)
+		if(_state.alphaToCoverage)
 			glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 		else
 			glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
-		m_currentState.blendState.alphaToCoverage = _pipeline.blendState.alphaToCoverage;
+		++m_statistics.issuedCalls;
+		m_currentState.blendState.alphaToCoverage = _state.alphaToCoverage;
 	}
+}
 
-	// ***** Sampler states ***************************************************
+void gpupro::OGLContext::applySamplers(SamplerState* const* _samplerState)
+{
 	for(int i = 0; i < 64; ++i)
 	{
-		if(m_currentState.samplerState[i] != _pipeline.samplerState[i])
+		if(m_currentState.samplerState[i] != _samplerState[i])
 		{
-			glBindSampler(i, _pipeline.samplerState[i] ? _pipeline.samplerState[i]->glID() : 0);
-			m_currentState.samplerState[i] = _pipeline.samplerState[i];
+			glBindSampler(i, _samplerState[i] ? _samplerState[i]->glID() : 0);
+			++m_statistics.issuedCalls;
+			m_currentState.samplerState[i] = _samplerState[i];
 		}
 	}
+}
 
-	// ***** Shader program ***************************************************
-	if(_pipeline.shader) glUseProgram(_pipeline.shader->glID());
+void gpupro::OGLContext::bindProgram(GLuint _program)
+{
+	if(m_currentState.program != _program)
+	{
+		glUseProgram(_program);
+		++m_statistics.issuedCalls;
+		m_currentState.program = _program;
+	} else ++m_statistics.skippedCalls;
+}
 
-	static VertexFormat dummyVertexFormat({{}});
-	if(_pipeline.vertexFormat) glBindVertexArray(_pipeline.vertexFormat->glID());
-	else glBindVertexArray(dummyVertexFormat.glID());
+void gpupro::OGLContext::bindVertexFormat(VertexFormat& _vertexFormat)
+{
+	if(m_currentState.vertexFormat != _vertexFormat.serial())
+	{
+		glBindVertexArray(_vertexFormat.glID());
+		++m_statistics.issuedCalls;
+		m_currentState.vertexFormat = _vertexFormat.serial();
+		resetVertexArrayBindings();
+	} else ++m_statistics.skippedCalls;
 }
 
-void gpupro::OGLContext::setState(ComputePipeline & _pipeline)
+void gpupro::OGLContext::bindTexture(GLuint _unit, GLuint _texture)
 {
-	// ***** Sampler states ***************************************************
-	for(int i = 0; i < 64; ++i)
+	bindTextures(_unit, 1, &_texture);
+}
+
+void gpupro::OGLContext::bindTextures(GLuint _firstUnit, GLsizei _count, const GLuint* _textures)
+{
+	if(_firstUnit + _count > NUM_CACHED_TEXTURE_UNITS)
+	{
+		glBindTextures(_firstUnit, _count, _textures);
+		++m_statistics.issuedCalls;
+		return;
+	}
+	// One call for the range between the first and last change
+	int first = -1, last = -1;
+	for(int i = 0; i < _count; ++i)
+		if(m_bindings.textures[_firstUnit + i] != _textures[i])
+		{
+			if(first == -1) first = i;
+			last = i;
+			m_bindings.textures[_firstUnit + i] = _textures[i];
+		}
+	if(first == -1)
+	{
+		++m_statistics.skippedCalls;
+		return;
+	}
+	glBindTextures(_firstUnit + first, last - first + 1, _textures + first);
+	++m_statistics.issuedCalls;
+}
+
+gpupro::OGLContext::BufferRange* gpupro::OGLContext::bufferRanges(GLenum _target)
+{
+	if(_target == GL_UNIFORM_BUFFER) return m_bindings.uniformBuffers;
+	if(_target == GL_SHADER_STORAGE_BUFFER) return m_bindings.storageBuffers;
+	return nullptr;
+}
+
+void gpupro::OGLContext::bindBufferRange(GLenum _target, GLuint _index, GLuint _buffer, GLintptr _offset, GLsizeiptr _size)
+{
+	bindBuffersRange(_target, _index, 1, &_buffer, &_offset, &_size);
+}
+
+void gpupro::OGLContext::bindBuffersRange(GLenum _target, GLuint _firstIndex, GLsizei _count, const GLuint* _buffers,
+	const GLintptr* _offsets, const GLsizeiptr* _sizes)
+{
+	BufferRange* ranges = bufferRanges(_target);
+	if(!ranges || _firstIndex + _count > NUM_CACHED_BUFFER_BINDINGS)
 	{
-		if(m_currentState.samplerState[i] != _pipeline.samplerState[i])
+		glBindBuffersRange(_target, _firstIndex, _count, _buffers, _offsets, _sizes);
+		++m_statistics.issuedCalls;
+		return;
+	}
+	int first = -1, last = -1;
+	for(int i = 0; i < _count; ++i)
+	{
+		BufferRange& range = ranges[_firstIndex + i];
+		if(range.buffer != _buffers[i] || range.offset != _offsets[i] || range.size != _sizes[i])
 		{
-			glBindSampler(i, _pipeline.samplerState[i] ? _pipeline.samplerState[i]->glID() : 0);
-			m_currentState.samplerState[i] = _pipeline.samplerState[i];
+			if(first == -1) first = i;
+			last = i;
+			range.buffer = _buffers[i];
+			range.offset = _offsets[i];
+			range.size = _sizes[i];
 		}
 	}
+	if(first == -1)
+	{
+		++m_statistics.skippedCalls;
+		return;
+	}
+	if(first == last)
+		glBindBufferRange(_target, _firstIndex + first, _buffers[first], _offsets[first], _sizes[first]);
+	else
+		glBindBuffersRange(_target, _firstIndex + first, last - first + 1, _buffers + first, _offsets + first, _sizes + first);
+	++m_statistics.issuedCalls;
+}
 
-	// ***** Shader program ***************************************************
-	if(_pipeline.shader) glUseProgram(_pipeline.shader->glID());
+void gpupro::OGLContext::bindVertexBuffer(GLuint _binding, GLuint _buffer, GLintptr _offset, GLsizei _stride)
+{
+	if(_binding < NUM_CACHED_VERTEX_BUFFERS)
+	{
+		BufferRange& range = m_bindings.vertexBuffers[_binding];
+		if(range.buffer == _buffer && range.offset == _offset && range.size == _stride)
+		{
+			++m_statistics.skippedCalls;
+			return;
+		}
+		range.buffer = _buffer;
+		range.offset = _offset;
+		range.size = _stride;
+	}
+	glBindVertexBuffer(_binding, _buffer, _offset, _stride);
+	++m_statistics.issuedCalls;
+}
+
+void gpupro::OGLContext::bindIndexBuffer(GLuint _buffer)
+{
+	if(m_bindings.indexBuffer == _buffer)
+	{
+		++m_statistics.skippedCalls;
+		return;
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffer);
+	++m_statistics.issuedCalls;
+	m_bindings.indexBuffer = _buffer;
+}
+
+void gpupro::OGLContext::resetVertexArrayBindings()
+{
+	for(GLuint i = 0; i < NUM_CACHED_VERTEX_BUFFERS; ++i)
+		m_bindings.vertexBuffers[i].buffer = ~0u;
+	m_bindings.indexBuffer = ~0u;
+}
+
+void gpupro::OGLContext::forgetTexture(GLuint _texture)
+{
+	// GL unbinds deleted textures
+	for(GLuint i = 0; i < NUM_CACHED_TEXTURE_UNITS; ++i)
+		if(m_bindings.textures[i] == _texture)
+			m_bindings.textures[i] = 0;
+}
+
+void gpupro::OGLContext::forgetBuffer(GLuint _buffer)
+{
+	for(GLuint i = 0; i < NUM_CACHED_BUFFER_BINDINGS; ++i)
+	{
+		if(m_bindings.uniformBuffers[i].buffer == _buffer)
+			m_bindings.uniformBuffers[i] = BufferRange();
+		if(m_bindings.storageBuffers[i].buffer == _buffer)
+			m_bindings.storageBuffers[i] = BufferRange();
+	}
+	// Only the bound vertex array loses the buffer, others keep a stale name
+	for(GLuint i = 0; i < NUM_CACHED_VERTEX_BUFFERS; ++i)
+		if(m_bindings.vertexBuffers[i].buffer == _buffer)
+			m_bindings.vertexBuffers[i].buffer = ~0u;
+	if(m_bindings.indexBuffer == _buffer)
+		m_bindings.indexBuffer = ~0u;
 }
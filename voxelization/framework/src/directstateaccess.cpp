@@ -0,0 +1,66 @@
+#include "directstateaccess.hpp"
+#include "context.hpp"
+
+namespace gpupro {
+namespace dsa {
+
+	static bool s_available = false;
+
+	void (APIENTRYP createBuffers)(GLsizei, GLuint*) = nullptr;
+	void (APIENTRYP namedBufferStorage)(GLuint, GLsizeiptr, const void*, GLbitfield) = nullptr;
+	void (APIENTRYP namedBufferSubData)(GLuint, GLintptr, GLsizeiptr, const void*) = nullptr;
+	void (APIENTRYP clearNamedBufferData)(GLuint, GLenum, GLenum, GLenum, const void*) = nullptr;
+	void* (APIENTRYP mapNamedBufferRange)(GLuint, GLintptr, GLsizeiptr, GLbitfield) = nullptr;
+	GLboolean (APIENTRYP unmapNamedBuffer)(GLuint) = nullptr;
+	void (APIENTRYP flushMappedNamedBufferRange)(GLuint, GLintptr, GLsizeiptr) = nullptr;
+
+	void (APIENTRYP createTextures)(GLenum, GLsizei, GLuint*) = nullptr;
+	void (APIENTRYP textureStorage1D)(GLuint, GLsizei, GLenum, GLsizei) = nullptr;
+	void (APIENTRYP textureStorage2D)(GLuint, GLsizei, GLenum, GLsizei, GLsizei) = nullptr;
+	void (APIENTRYP textureStorage3D)(GLuint, GLsizei, GLenum, GLsizei, GLsizei, GLsizei) = nullptr;
+	void (APIENTRYP textureSubImage1D)(GLuint, GLint, GLint, GLsizei, GLenum, GLenum, const void*) = nullptr;
+	void (APIENTRYP textureSubImage2D)(GLuint, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*) = nullptr;
+	void (APIENTRYP textureSubImage3D)(GLuint, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void*) = nullptr;
+	void (APIENTRYP generateTextureMipmap)(GLuint) = nullptr;
+
+	template<typename Func>
+	static bool loadFunction(GLADloadproc _loadProc, const char* _name, Func& _function)
+	{
+		_function = reinterpret_cast<Func>(_loadProc(_name));
+		return _function != nullptr;
+	}
+
+	bool load(GLADloadproc _loadProc)
+	{
+		s_available = false;
+		if(!_loadProc)
+			return false;
+		if(GLVersion.major * 10 + GLVersion.minor < 45 && !OGLContext::hasExtension("GL_ARB_direct_state_access"))
+			return false;
+
+		bool complete = loadFunction(_loadProc, "glCreateBuffers", createBuffers);
+		complete &= loadFunction(_loadProc, "glNamedBufferStorage", namedBufferStorage);
+		complete &= loadFunction(_loadProc, "glNamedBufferSubData", namedBufferSubData);
+		complete &= loadFunction(_loadProc, "glClearNamedBufferData", clearNamedBufferData);
+		complete &= loadFunction(_loadProc, "glMapNamedBufferRange", mapNamedBufferRange);
+		complete &= loadFunction(_loadProc, "glUnmapNamedBuffer", unmapNamedBuffer);
+		complete &= loadFunction(_loadProc, "glFlushMappedNamedBufferRange", flushMappedNamedBufferRange);
+		complete &= loadFunction(_loadProc, "glCreateTextures", createTextures);
+		complete &= loadFunction(_loadProc, "glTextureStorage1D", textureStorage1D);
+		complete &= loadFunction(_loadProc, "glTextureStorage2D", textureStorage2D);
+		complete &= loadFunction(_loadProc, "glTextureStorage3D", textureStorage3D);
+		complete &= loadFunction(_loadProc, "glTextureSubImage1D", textureSubImage1D);
+		complete &= loadFunction(_loadProc, "glTextureSubImage2D", textureSubImage2D);
+		complete &= loadFunction(_loadProc, "glTextureSubImage3D", textureSubImage3D);
+		complete &= loadFunction(_loadProc, "glGenerateTextureMipmap", generateTextureMipmap);
+		s_available = complete;
+		return s_available;
+	}
+
+	bool isAvailable()
+	{
+		return s_available;
+	}
+
+} // namespace dsa
+} // namespace gpupro
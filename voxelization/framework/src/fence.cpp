@@ -0,0 +1,61 @@
+#include "fence.hpp"
+
+#include <iostream>
+
+gpupro::Fence::Fence() :
+	m_sync(nullptr)
+{
+}
+
+gpupro::Fence::~Fence()
+{
+	glDeleteSync(m_sync);
+}
+
+gpupro::Fence::Fence(Fence&& _rhs) :
+	m_sync(_rhs.m_sync)
+{
+	_rhs.m_sync = nullptr;
+}
+
+gpupro::Fence& gpupro::Fence::operator=(Fence&& _rhs)
+{
+	glDeleteSync(m_sync);
+	m_sync = _rhs.m_sync;
+	_rhs.m_sync = nullptr;
+	return *this;
+}
+
+void gpupro::Fence::set()
+{
+	glDeleteSync(m_sync);
+	m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool gpupro::Fence::isSignaled() const
+{
+	if(!m_sync)
+		return true;
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(m_sync, GL_SYNC_STATUS, 1, nullptr, &status);
+	return status == GL_SIGNALED;
+}
+
+bool gpupro::Fence::wait() const
+{
+	if(!m_sync)
+		return true;
+	// Timeout in ns, retried until the fence is signaled
+	const GLuint64 TIMEOUT = 1000000000;
+	while(true)
+	{
+		GLenum result = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, TIMEOUT);
+		if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+			return true;
+		if(result == GL_WAIT_FAILED)
+		{
+			std::cerr << "ERR: Waiting for a fence failed!\n";
+			return false;
+		}
+	}
+}
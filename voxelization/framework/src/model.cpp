@@ -1,12 +1,81 @@
 #include "model.hpp"
 
+#include <iostream>
+
 using namespace glm;
 
+// A slice over an entire buffer
+static gpupro::BufferSlice wholeBuffer(gpupro::Buffer& _buffer)
+{
+	gpupro::BufferSlice slice;
+	slice.buffer = &_buffer;
+	slice.size = _buffer.size();
+	slice.elementSize = _buffer.elementSize();
+	return slice;
+}
+
+gpupro::ModelHeap::ModelHeap(GLuint _verticesPerBuffer, GLuint _indicesPerBuffer) :
+	m_positions(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)), _verticesPerBuffer),
+	m_tangentSpaces(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)*3), _verticesPerBuffer),
+	m_texCoords(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec2)), _verticesPerBuffer),
+	m_indices(Buffer::Type::INDEX, 4, _indicesPerBuffer)
+{
+}
+
+void gpupro::ModelHeap::allocateVertices(GLuint _numVertices, const GLvoid* _positions, const GLvoid* _tangentSpaces, const GLvoid* _texCoords,
+	BufferSlice& _positionSlice, BufferSlice& _tangentSpaceSlice, BufferSlice& _texCoordSlice)
+{
+	_positionSlice = m_positions.allocate(_numVertices, _positions);
+	_tangentSpaceSlice = m_tangentSpaces.allocate(_numVertices, _tangentSpaces);
+	_texCoordSlice = m_texCoords.allocate(_numVertices, _texCoords);
+	// A model draws all streams with the first position as base vertex.
+	if(_positionSlice.firstElement() != _tangentSpaceSlice.firstElement() || _positionSlice.firstElement() != _texCoordSlice.firstElement())
+	{
+		freeVertices(_positionSlice, _tangentSpaceSlice, _texCoordSlice);
+		throw std::exception("The vertex streams of a model heap are out of sync");
+	}
+}
+
+void gpupro::ModelHeap::freeVertices(const BufferSlice& _positionSlice, const BufferSlice& _tangentSpaceSlice, const BufferSlice& _texCoordSlice)
+{
+	m_positions.free(_positionSlice);
+	m_tangentSpaces.free(_tangentSpaceSlice);
+	m_texCoords.free(_texCoordSlice);
+}
+
 gpupro::Model::Model(const OBJLoader& _loader) :
-	m_positions(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)), _loader.getNumVertices(), Buffer::Usage(), _loader.getPositions()),
-	m_tangentSpaces(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)*3), _loader.getNumVertices(), Buffer::Usage(), _loader.getTangentSpaces()),
-	m_texCoords(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec2)), _loader.getNumVertices(), Buffer::Usage(), _loader.getTexCoords()),
-	m_indices(Buffer::Type::INDEX, 4, _loader.getNumIndices(), Buffer::Usage(), _loader.getIndices())
+	m_heap(nullptr)
+{
+	m_buffers[0].reset(new Buffer(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)), _loader.getNumVertices(), Buffer::Usage(), _loader.getPositions()));
+	m_buffers[1].reset(new Buffer(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec3)*3), _loader.getNumVertices(), Buffer::Usage(), _loader.getTangentSpaces()));
+	m_buffers[2].reset(new Buffer(Buffer::Type::VERTEX, static_cast<GLuint>(sizeof(vec2)), _loader.getNumVertices(), Buffer::Usage(), _loader.getTexCoords()));
+	m_buffers[3].reset(new Buffer(Buffer::Type::INDEX, 4, _loader.getNumIndices(), Buffer::Usage(), _loader.getIndices()));
+	m_positions = wholeBuffer(*m_buffers[0]);
+	m_tangentSpaces = wholeBuffer(*m_buffers[1]);
+	m_texCoords = wholeBuffer(*m_buffers[2]);
+	m_indices = wholeBuffer(*m_buffers[3]);
+	computeBoundingBox(_loader);
+}
+
+gpupro::Model::Model(const OBJLoader& _loader, ModelHeap& _heap) :
+	m_heap(&_heap)
+{
+	_heap.allocateVertices(_loader.getNumVertices(), _loader.getPositions(), _loader.getTangentSpaces(), _loader.getTexCoords(),
+		m_positions, m_tangentSpaces, m_texCoords);
+	m_indices = _heap.allocateIndices(_loader.getNumIndices(), _loader.getIndices());
+	computeBoundingBox(_loader);
+}
+
+gpupro::Model::~Model()
+{
+	if(m_heap)
+	{
+		m_heap->freeVertices(m_positions, m_tangentSpaces, m_texCoords);
+		m_heap->freeIndices(m_indices);
+	}
+}
+
+void gpupro::Model::computeBoundingBox(const OBJLoader& _loader)
 {
 	m_bbMin = m_bbMax = _loader.getPositions()[0];
 	for(unsigned i = 1; i < _loader.getNumVertices(); ++i)
@@ -19,15 +88,51 @@ gpupro::Model::Model(const OBJLoader& _loader) :
 void gpupro::Model::bind(int _posBindIdx, int _tsBindIdx, int _texBindIdx)
 {
 	if(_posBindIdx >= 0)
-		m_positions.bindAsVertexBuffer(_posBindIdx);
+		m_positions.buffer->bindAsVertexBuffer(_posBindIdx);
 	if(_tsBindIdx >= 0)
-		m_tangentSpaces.bindAsVertexBuffer(_tsBindIdx);
+		m_tangentSpaces.buffer->bindAsVertexBuffer(_tsBindIdx);
 	if(_texBindIdx >= 0)
-		m_texCoords.bindAsVertexBuffer(_texBindIdx);
+		m_texCoords.buffer->bindAsVertexBuffer(_texBindIdx);
 	m_indices.bindAsIndexBuffer();
 }
 
 void gpupro::Model::draw(DrawPrimitiveType _primType) const
 {
-	glDrawElements(static_cast<GLenum>(_primType), m_indices.numElements(), GL_UNSIGNED_INT, nullptr);
+	glDrawElementsBaseVertex(static_cast<GLenum>(_primType), m_indices.numElements(), GL_UNSIGNED_INT,
+		reinterpret_cast<const GLvoid*>(m_indices.offset), m_positions.firstElement());
+}
+
+bool gpupro::Model::sharesBuffers(const Model& _other) const
+{
+	return m_positions.buffer == _other.m_positions.buffer && m_tangentSpaces.buffer == _other.m_tangentSpaces.buffer
+		&& m_texCoords.buffer == _other.m_texCoords.buffer && m_indices.buffer == _other.m_indices.buffer;
+}
+
+void gpupro::Model::drawMerged(const std::vector<Model*>& _models, int _posBindIdx, int _tsBindIdx, int _texBindIdx,
+	DrawPrimitiveType _primType)
+{
+	std::vector<GLsizei> counts;
+	std::vector<const GLvoid*> indexOffsets;
+	std::vector<GLint> baseVertices;
+	size_t first = 0;
+	while(first < _models.size())
+	{
+		size_t end = first + 1;
+		while(end < _models.size() && _models[end]->sharesBuffers(*_models[first]))
+			++end;
+
+		counts.clear();
+		indexOffsets.clear();
+		baseVertices.clear();
+		for(size_t i = first; i < end; ++i)
+		{
+			counts.push_back(_models[i]->m_indices.numElements());
+			indexOffsets.push_back(reinterpret_cast<const GLvoid*>(_models[i]->m_indices.offset));
+			baseVertices.push_back(_models[i]->m_positions.firstElement());
+		}
+		_models[first]->bind(_posBindIdx, _tsBindIdx, _texBindIdx);
+		glMultiDrawElementsBaseVertex(static_cast<GLenum>(_primType), counts.data(), GL_UNSIGNED_INT,
+			indexOffsets.data(), GLsizei(counts.size()), baseVertices.data());
+		first = end;
+	}
 }
@@ -79,3 +79,52 @@ gpupro::SamplerState& gpupro::SamplerState::operator=(SamplerState&& _rhs)
 
 	return *this;
 }
+
+// FNV-1a over the single members. Hashing the structs as a whole would
+// include undefined padding bytes.
+class StateHash
+{
+public:
+	template<typename T>
+	StateHash& operator << (const T& _value)
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&_value);
+		for(size_t i = 0; i < sizeof(T); ++i)
+		{
+			m_hash ^= bytes[i];
+			m_hash *= 1099511628211ull;
+		}
+		return *this;
+	}
+
+	uint64_t value() const { return m_hash | 1; }
+private:
+	uint64_t m_hash = 14695981039346656037ull;
+};
+
+gpupro::PipelineStateBlock::PipelineStateBlock(const Pipeline& _pipeline) :
+	m_state(_pipeline)
+{
+	const RasterizerState& rs = _pipeline.rasterizer;
+	m_rasterizerHash = (StateHash() << rs.cullMode << rs.frontFaceWinding << rs.fillMode << rs.lineWidth
+		<< rs.discard << rs.colorWrite << rs.dithering).value();
+
+	const DepthStencilState& ds = _pipeline.depthStencil;
+	m_depthStencilHash = (StateHash() << ds.depthTest << ds.depthCmpFunc << ds.depthWrite << ds.stencilTest
+		<< ds.stencilCmpFuncFront << ds.stencilCmpFuncBack << ds.stencilRefFront << ds.stencilRefBack
+		<< ds.stencilFailOpFront << ds.zfailOpFront << ds.passOpFront
+		<< ds.stencilFailOpBack << ds.zfailOpBack << ds.passOpBack).value();
+
+	const BlendState& bs = _pipeline.blendState;
+	StateHash blendHash;
+	for(int i = 0; i < 8; ++i)
+		blendHash << bs.buf[i].srcColorFactor << bs.buf[i].srcAlphaFactor << bs.buf[i].dstColorFactor
+			<< bs.buf[i].dstAlphaFactor << bs.buf[i].colorBlendOp << bs.buf[i].alphaBlendOp;
+	blendHash << bs.enableBlending << bs.logicOp << bs.alphaToCoverage;
+	m_blendHash = blendHash.value();
+
+	StateHash samplerHash;
+	for(int i = 0; i < 64; ++i)
+		samplerHash << _pipeline.samplerState[i];
+	m_samplerHash = samplerHash.value();
+}
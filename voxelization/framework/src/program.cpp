@@ -1,7 +1,16 @@
 #include "program.hpp"
 #include "shader.hpp"
+#include "context.hpp"
 #include <iostream>
 
+// KHR_parallel_shader_compile is not part of the glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+static void (APIENTRYP s_maxShaderCompilerThreads)(GLuint) = nullptr;
+static bool s_parallelCompile = false;
+
 gpupro::Program::Program()
 {
 	m_id = glCreateProgram();
@@ -83,9 +92,47 @@ void gpupro::Program::attach(Shader& _shader)
 }
 
 void gpupro::Program::link()
+{
+	linkAsync();
+	checkLinkStatus();
+}
+
+void gpupro::Program::linkAsync()
 {
 	// Link all attached shaders (if possible)
 	glLinkProgram(m_id);
+}
+
+bool gpupro::Program::isReady() const
+{
+	if(!s_parallelCompile)
+		return true;
+	GLint isDone = GL_FALSE;
+	glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &isDone);
+	return isDone != GL_FALSE;
+}
+
+bool gpupro::Program::enableParallelCompile(GLADloadproc _loadProc)
+{
+	s_parallelCompile = false;
+	if(!_loadProc)
+		return false;
+	if(OGLContext::hasExtension("GL_KHR_parallel_shader_compile"))
+		s_maxShaderCompilerThreads = reinterpret_cast<void (APIENTRYP)(GLuint)>(_loadProc("glMaxShaderCompilerThreadsKHR"));
+	else if(OGLContext::hasExtension("GL_ARB_parallel_shader_compile"))
+		s_maxShaderCompilerThreads = reinterpret_cast<void (APIENTRYP)(GLuint)>(_loadProc("glMaxShaderCompilerThreadsARB"));
+	else
+		return false;
+	if(!s_maxShaderCompilerThreads)
+		return false;
+	// 0xffffffff: implementation dependent maximum
+	s_maxShaderCompilerThreads(0xffffffff);
+	s_parallelCompile = true;
+	return true;
+}
+
+void gpupro::Program::checkLinkStatus()
+{
 	// Check success
 	GLint isLinked = 0;
 	glGetProgramiv(m_id, GL_LINK_STATUS, &isLinked);
@@ -117,9 +164,12 @@ void gpupro::Program::applyFeedback(TransformFeedback _feedback, std::initialize
 	glTransformFeedbackVaryings(m_id, GLsizei(_fbVaryings.size()), varyingStrings.data(), static_cast<GLenum>(_feedback));
 }
 
-void gpupro::Program::loadFromBinary(GLenum _binaryFormat, const std::vector<unsigned char>& _binary)
+bool gpupro::Program::loadFromBinary(GLenum _binaryFormat, const std::vector<unsigned char>& _binary)
 {
 	glProgramBinary(m_id, _binaryFormat, _binary.data(), static_cast<GLsizei>(_binary.size()));
+	GLint isLinked = 0;
+	glGetProgramiv(m_id, GL_LINK_STATUS, &isLinked);
+	return isLinked != GL_FALSE;
 }
 
 std::vector<unsigned char> gpupro::Program::getBinary(GLenum& _binaryFormat)
@@ -0,0 +1,192 @@
+#include "programcache.hpp"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <chrono>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const uint32_t BINARY_MAGIC = 0x43425047;	// "GPBC"
+
+static void makeDirectory(const char* _path)
+{
+#ifdef _WIN32
+	_mkdir(_path);
+#else
+	mkdir(_path, 0755);
+#endif
+}
+
+// FNV-1a, strings are hashed with their terminator so that the borders
+// of consecutive strings matter.
+static void hashBytes(uint64_t& _hash, const void* _data, size_t _size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+	for(size_t i = 0; i < _size; ++i)
+	{
+		_hash ^= bytes[i];
+		_hash *= 0x100000001b3ull;
+	}
+}
+
+static void hashString(uint64_t& _hash, const std::string& _string)
+{
+	hashBytes(_hash, _string.c_str(), _string.size() + 1);
+}
+
+static std::string glString(GLenum _name)
+{
+	const GLubyte* string = glGetString(_name);
+	return string ? reinterpret_cast<const char*>(string) : "";
+}
+
+gpupro::ProgramCache::ProgramCache(const char* _directory) :
+	m_directory(_directory),
+	m_numLoaded(0),
+	m_numCompiled(0),
+	m_loadTime(0.0)
+{
+	makeDirectory(_directory);
+	m_driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	m_supported = numFormats > 0;
+	if(!m_supported)
+		std::cerr << "WAR: The driver does not support program binaries, shaders are always compiled.\n";
+}
+
+gpupro::Program gpupro::ProgramCache::load(const std::vector<Stage>& _stages, const Shader::Defines& _defines,
+	Program::TransformFeedback _feedback, std::initializer_list<std::string> _fbVaryings)
+{
+	return loadAsync(_stages, _defines, _feedback, _fbVaryings).get();
+}
+
+gpupro::Program gpupro::ProgramCache::load(const std::vector<Stage>& _stages, Program::TransformFeedback _feedback,
+	std::initializer_list<std::string> _fbVaryings)
+{
+	return loadAsync(_stages, Shader::Defines(), _feedback, _fbVaryings).get();
+}
+
+gpupro::ProgramCache::Future gpupro::ProgramCache::loadAsync(const std::vector<Stage>& _stages, Program::TransformFeedback _feedback,
+	std::initializer_list<std::string> _fbVaryings)
+{
+	return loadAsync(_stages, Shader::Defines(), _feedback, _fbVaryings);
+}
+
+gpupro::ProgramCache::Future gpupro::ProgramCache::loadAsync(const std::vector<Stage>& _stages, const Shader::Defines& _defines,
+	Program::TransformFeedback _feedback, std::initializer_list<std::string> _fbVaryings)
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+	std::vector<std::string> sources;
+	uint64_t key = 0xcbf29ce484222325ull;
+	hashString(key, m_driver);
+	for(const Stage& stage : _stages)
+	{
+		sources.push_back(Shader::preprocess(stage.fileName, _defines));
+		GLenum type = static_cast<GLenum>(stage.type);
+		hashBytes(key, &type, sizeof(type));
+		hashString(key, sources.back());
+	}
+	hashBytes(key, &_feedback, sizeof(_feedback));
+	for(const std::string& varying : _fbVaryings)
+		hashString(key, varying);
+
+	char name[32];
+	sprintf(name, "/%016llx.bin", static_cast<unsigned long long>(key));
+	Future future(*this);
+	future.m_fileName = m_directory + name;
+	future.m_key = key;
+
+	if(!m_supported || !readBinary(future.m_fileName, key, future.m_program))
+	{
+		// Issue all compiles and the link without waiting, the sources are
+		// already in memory.
+		int i = 0;
+		for(const Stage& stage : _stages)
+		{
+			future.m_shaders.emplace_back(new Shader(stage.type));
+			future.m_shaders.back()->compile(sources[i++].c_str(), stage.fileName);
+			future.m_program.attach(*future.m_shaders.back());
+		}
+		future.m_program.applyFeedback(_feedback, _fbVaryings);
+		glProgramParameteri(future.m_program.glID(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		future.m_program.linkAsync();
+	}
+	m_loadTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+	return future;
+}
+
+gpupro::Program gpupro::ProgramCache::Future::get()
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+	if(m_shaders.empty())
+		++m_cache->m_numLoaded;
+	else {
+		// Compile errors are more helpful than the link error
+		for(auto& shader : m_shaders)
+			shader->checkStatus();
+		m_program.checkLinkStatus();
+		m_shaders.clear();
+		++m_cache->m_numCompiled;
+		if(m_cache->m_supported)
+			m_cache->writeBinary(m_fileName, m_key, m_program);
+	}
+	m_cache->m_loadTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - time_start).count();
+	return std::move(m_program);
+}
+
+bool gpupro::ProgramCache::readBinary(const std::string& _fileName, uint64_t _key, Program& _program) const
+{
+	FILE* file = fopen(_fileName.c_str(), "rb");
+	if(!file)
+		return false;
+
+	// Header: magic, key, binary format
+	uint32_t magic = 0;
+	uint64_t key = 0;
+	GLenum format = 0;
+	bool valid = fread(&magic, sizeof(magic), 1, file) == 1 && fread(&key, sizeof(key), 1, file) == 1
+		&& fread(&format, sizeof(format), 1, file) == 1 && magic == BINARY_MAGIC && key == _key;
+	std::vector<unsigned char> binary;
+	if(valid)
+	{
+		long begin = ftell(file);
+		fseek(file, 0, SEEK_END);
+		binary.resize(ftell(file) - begin);
+		fseek(file, begin, SEEK_SET);
+		valid = !binary.empty() && fread(binary.data(), binary.size(), 1, file) == 1;
+	}
+	fclose(file);
+
+	// A driver update can invalidate the binary without changing the version string
+	if(valid && !_program.loadFromBinary(format, binary))
+	{
+		std::cerr << "INF: Program binary " << _fileName << " was rejected, compiling from source\n";
+		return false;
+	}
+	return valid;
+}
+
+void gpupro::ProgramCache::writeBinary(const std::string& _fileName, uint64_t _key, Program& _program) const
+{
+	GLenum format = 0;
+	std::vector<unsigned char> binary = _program.getBinary(format);
+	if(binary.empty())
+		return;
+	FILE* file = fopen(_fileName.c_str(), "wb");
+	if(!file)
+	{
+		std::cerr << "WAR: Cannot write program binary " << _fileName << '\n';
+		return;
+	}
+	fwrite(&BINARY_MAGIC, sizeof(BINARY_MAGIC), 1, file);
+	fwrite(&_key, sizeof(_key), 1, file);
+	fwrite(&format, sizeof(format), 1, file);
+	fwrite(binary.data(), binary.size(), 1, file);
+	fclose(file);
+}
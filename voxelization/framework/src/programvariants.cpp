@@ -0,0 +1,30 @@
+#include "programvariants.hpp"
+
+gpupro::ProgramVariants::ProgramVariants(ProgramCache& _cache, std::initializer_list<ProgramCache::Stage> _stages) :
+	m_cache(_cache),
+	m_stages(_stages)
+{
+}
+
+void gpupro::ProgramVariants::prepare(const Shader::Defines& _defines)
+{
+	if(m_programs.find(_defines) != m_programs.end() || m_pending.find(_defines) != m_pending.end())
+		return;
+	m_pending.emplace(_defines, m_cache.loadAsync(m_stages, _defines));
+}
+
+gpupro::Program& gpupro::ProgramVariants::get(const Shader::Defines& _defines)
+{
+	auto program = m_programs.find(_defines);
+	if(program != m_programs.end())
+		return program->second;
+
+	auto pending = m_pending.find(_defines);
+	if(pending != m_pending.end())
+	{
+		program = m_programs.emplace(_defines, pending->second.get()).first;
+		m_pending.erase(pending);
+	} else
+		program = m_programs.emplace(_defines, m_cache.load(m_stages, _defines)).first;
+	return program->second;
+}
@@ -0,0 +1,222 @@
+#include "renderqueue.hpp"
+
+#include <cstring>
+
+// Bind the ranges of consecutive units/indices in the mask with one call.
+template<typename BindFunc>
+static void forEachRun(uint64_t _mask, BindFunc _bind)
+{
+	while(_mask)
+	{
+		GLuint first = 0;
+		while(!(_mask & (uint64_t(1) << first))) ++first;
+		GLuint end = first;
+		while(end < 64 && (_mask & (uint64_t(1) << end))) ++end;
+		_bind(first, GLsizei(end - first));
+		_mask &= end < 64 ? ~((uint64_t(1) << end) - 1) : 0;
+	}
+}
+
+gpupro::ResourceBindings::BufferBinding gpupro::ResourceBindings::BufferBinding::fromSlice(const BufferSlice& _slice, Target _target, GLuint _bindingIndex)
+{
+	switch(_target)
+	{
+	case Target::VERTEX:
+		return BufferBinding{_slice.buffer, _target, _bindingIndex, GLintptr(_slice.firstElement()), -1};
+	case Target::INDEX:
+		return BufferBinding{_slice.buffer, _target, 0, 0, -1};
+	default:
+		return BufferBinding{_slice.buffer, _target, _bindingIndex, _slice.offset, _slice.size};
+	}
+}
+
+void gpupro::ResourceBindings::apply() const
+{
+	OGLContext* context = OGLContext::current();
+	// Textures and indexed buffers with a slot < 64 are collected and
+	// consecutive slots use the multi-bind calls of the context.
+	GLuint textureIDs[64];
+	uint64_t textureMask = 0;
+	for(const TextureBinding& binding : textures)
+	{
+		if(binding.bindingIndex < 64 && context)
+		{
+			textureIDs[binding.bindingIndex] = binding.texture->glID();
+			textureMask |= uint64_t(1) << binding.bindingIndex;
+		} else binding.texture->bindAsTexture(binding.bindingIndex);
+	}
+	forEachRun(textureMask, [&](GLuint _first, GLsizei _count) {
+		context->bindTextures(_first, _count, textureIDs + _first);
+	});
+
+	GLuint bufferIDs[2][64];
+	GLintptr offsets[2][64];
+	GLsizeiptr sizes[2][64];
+	uint64_t bufferMask[2] = {0, 0};
+	for(const BufferBinding& binding : buffers)
+	{
+		int target = binding.target == BufferBinding::Target::UNIFORM ? 0 : 1;
+		switch(binding.target)
+		{
+		case BufferBinding::Target::VERTEX:
+			binding.buffer->bindAsVertexBuffer(binding.bindingIndex, GLuint(binding.offset));
+			break;
+		case BufferBinding::Target::INDEX:
+			binding.buffer->bindAsIndexBuffer();
+			break;
+		case BufferBinding::Target::UNIFORM:
+		case BufferBinding::Target::SHADER_STORAGE:
+			if(binding.bindingIndex < 64 && context)
+			{
+				bufferIDs[target][binding.bindingIndex] = binding.buffer->glID();
+				offsets[target][binding.bindingIndex] = binding.offset;
+				sizes[target][binding.bindingIndex] = binding.size == -1 ? binding.buffer->size() - binding.offset : binding.size;
+				bufferMask[target] |= uint64_t(1) << binding.bindingIndex;
+			} else if(target == 0)
+				binding.buffer->bindAsUniformBuffer(binding.bindingIndex, binding.offset, binding.size);
+			else binding.buffer->bindAsShaderStorageBuffer(binding.bindingIndex, binding.offset, binding.size);
+			break;
+		}
+	}
+	for(int target = 0; target < 2; ++target)
+		forEachRun(bufferMask[target], [&](GLuint _first, GLsizei _count) {
+			context->bindBuffersRange(target == 0 ? GL_UNIFORM_BUFFER : GL_SHADER_STORAGE_BUFFER, _first, _count,
+				bufferIDs[target] + _first, offsets[target] + _first, sizes[target] + _first);
+		});
+}
+
+// Fold a 64 bit hash into 16 bits.
+static uint64_t fold16(uint64_t _hash)
+{
+	_hash ^= _hash >> 32;
+	_hash ^= _hash >> 16;
+	return _hash & 0xffff;
+}
+
+void gpupro::RenderQueue::push(const PipelineStateBlock& _state, const ResourceBindings* _bindings, float _depth)
+{
+	const Pipeline& pipeline = _state.state();
+	uint64_t program = pipeline.shader ? pipeline.shader->glID() & 0xffff : 0;
+
+	// Bindings are numbered in the order of their first use
+	auto it = m_bindingIDs.find(_bindings);
+	if(it == m_bindingIDs.end())
+		it = m_bindingIDs.emplace(_bindings, uint16_t(m_bindingIDs.size())).first;
+	uint64_t bindings = it->second;
+
+	uint64_t states = fold16(_state.rasterizerHash() ^ _state.depthStencilHash() * 3
+		^ _state.blendHash() * 5 ^ _state.samplerHash() * 7
+		^ (pipeline.vertexFormat ? uint64_t(pipeline.vertexFormat->serial()) * 0x9e3779b97f4a7c15ull : 0));
+
+	// The bits of positive floats are ordered like the values
+	float depth = _depth > 0.0f ? _depth : 0.0f;
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(float));
+
+	m_keys.push_back(program << 48 | bindings << 32 | states << 16 | depthBits >> 16);
+}
+
+void gpupro::RenderQueue::submit(const PipelineStateBlock& _state, const ResourceBindings* _bindings, const DrawArgs& _args, float _depth)
+{
+	push(_state, _bindings, _depth);
+	m_items.push_back(Item{&_state, _bindings, _args, nullptr});
+}
+
+void gpupro::RenderQueue::submit(const PipelineStateBlock& _state, const ResourceBindings* _bindings, std::function<void()> _draw, float _depth)
+{
+	push(_state, _bindings, _depth);
+	m_items.push_back(Item{&_state, _bindings, DrawArgs(), std::move(_draw)});
+}
+
+void gpupro::RenderQueue::sort()
+{
+	// LSD radix sort with 8 bit digits. Digits which are equal for all
+	// keys (e.g. the program of a single shader queue) are skipped.
+	size_t n = m_keys.size();
+	m_tmpKeys.resize(n);
+	m_tmpOrder.resize(n);
+	uint32_t histogram[8][256] = {{0}};
+	for(uint64_t key : m_keys)
+		for(int d = 0; d < 8; ++d)
+			++histogram[d][(key >> (d * 8)) & 0xff];
+
+	for(int d = 0; d < 8; ++d)
+	{
+		if(histogram[d][(m_keys[0] >> (d * 8)) & 0xff] == n)
+			continue;
+		uint32_t offset = 0;
+		for(int b = 0; b < 256; ++b)
+		{
+			uint32_t count = histogram[d][b];
+			histogram[d][b] = offset;
+			offset += count;
+		}
+		for(size_t i = 0; i < n; ++i)
+		{
+			uint32_t dst = histogram[d][(m_keys[i] >> (d * 8)) & 0xff]++;
+			m_tmpKeys[dst] = m_keys[i];
+			m_tmpOrder[dst] = m_order[i];
+		}
+		m_keys.swap(m_tmpKeys);
+		m_order.swap(m_tmpOrder);
+	}
+}
+
+void gpupro::RenderQueue::execute(const Item& _item)
+{
+	if(_item.draw)
+		_item.draw();
+	else if(_item.args.indexed)
+		glDrawElementsInstancedBaseInstance(_item.args.primitive, _item.args.count, GL_UNSIGNED_INT,
+			reinterpret_cast<const GLvoid*>(size_t(_item.args.first) * sizeof(GLuint)), _item.args.instanceCount, _item.args.baseInstance);
+	else
+		glDrawArraysInstancedBaseInstance(_item.args.primitive, _item.args.first, _item.args.count,
+			_item.args.instanceCount, _item.args.baseInstance);
+}
+
+void gpupro::RenderQueue::flush(OGLContext& _context, bool _sort)
+{
+	m_statistics = Statistics();
+	m_statistics.numItems = m_items.size();
+	m_order.resize(m_items.size());
+	for(uint32_t i = 0; i < uint32_t(m_items.size()); ++i)
+		m_order[i] = i;
+
+	// Changes in submission order for comparison
+	const PipelineStateBlock* state = nullptr;
+	const ResourceBindings* bindings = nullptr;
+	for(const Item& item : m_items)
+	{
+		if(item.state != state) ++m_statistics.stateChangesSubmitted;
+		if(item.bindings != bindings && item.bindings) ++m_statistics.bindingChangesSubmitted;
+		state = item.state;
+		bindings = item.bindings;
+	}
+
+	if(_sort && !m_items.empty())
+		sort();
+
+	state = nullptr;
+	bindings = nullptr;
+	for(uint32_t index : m_order)
+	{
+		const Item& item = m_items[index];
+		if(item.state != state)
+		{
+			_context.setState(*item.state);
+			++m_statistics.stateChanges;
+			state = item.state;
+		}
+		if(item.bindings != bindings && item.bindings)
+		{
+			item.bindings->apply();
+			++m_statistics.bindingChanges;
+		}
+		bindings = item.bindings;
+		execute(item);
+	}
+
+	m_items.clear();
+	m_keys.clear();
+	m_bindingIDs.clear();
+}
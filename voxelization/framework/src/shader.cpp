@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <sstream>
 #include <iostream>
 
 gpupro::Shader::Shader(Type _type)
@@ -23,7 +25,8 @@ gpupro::Shader::~Shader()
 
 gpupro::Shader::Shader(Shader&& _rhs) :
 	m_id(_rhs.m_id),
-	m_type(_rhs.m_type)
+	m_type(_rhs.m_type),
+	m_debugName(std::move(_rhs.m_debugName))
 {
 	_rhs.m_id = 0;
 }
@@ -34,17 +37,29 @@ gpupro::Shader& gpupro::Shader::operator=(Shader&& _rhs)
 
 	m_id = _rhs.m_id;
 	m_type = _rhs.m_type;
+	m_debugName = std::move(_rhs.m_debugName);
 	_rhs.m_id = 0;
 	return *this;
 }
 
 void gpupro::Shader::loadFromSource(const char* _source, const char* _debugName)
 {
+	compile(_source, _debugName);
+	checkStatus();
+}
+
+void gpupro::Shader::compile(const char* _source, const char* _debugName)
+{
+	m_debugName = _debugName ? _debugName : "";
 	// Attach one or multiple strings as source code.
 	glShaderSource(m_id, 1, &_source, nullptr);
 
 	// Compile
 	glCompileShader(m_id);
+}
+
+void gpupro::Shader::checkStatus()
+{
 	// Check success
 	GLint isCompiled = 0;
 	glGetShaderiv(m_id, GL_COMPILE_STATUS, &isCompiled);
@@ -56,17 +71,23 @@ void gpupro::Shader::loadFromSource(const char* _source, const char* _debugName)
 		std::string errorLog;
 		errorLog.resize(length);
 		glGetShaderInfoLog(m_id, length, &length, &errorLog[0]);
-		if(_debugName)
-			errorLog = "Failed to compile " + std::string(_debugName) + '\n' + errorLog;
+		if(!m_debugName.empty())
+			errorLog = "Failed to compile " + m_debugName + '\n' + errorLog;
 		else
 			errorLog = "Failed to compile shader " + std::to_string(m_id) + '\n' + errorLog;
 		throw std::exception(errorLog.c_str());
 	} else {
-		std::cerr << "INF: Successfully compiled " << (_debugName ? _debugName : "shader") << "\n";
+		std::cerr << "INF: Successfully compiled " << (m_debugName.empty() ? "shader" : m_debugName) << "\n";
 	}
 }
 
-void gpupro::Shader::loadFromFile(const char* _fileName)
+void gpupro::Shader::loadFromFile(const char* _fileName, const Defines& _defines)
+{
+	std::string source = preprocess(_fileName, _defines);
+	loadFromSource(source.c_str(), _fileName);
+}
+
+std::string gpupro::Shader::readFile(const char* _fileName)
 {
 	// Open the file
 	FILE* file = fopen(_fileName, "rb");
@@ -77,12 +98,78 @@ void gpupro::Shader::loadFromFile(const char* _fileName)
 	unsigned length = ftell(file);
 	fseek(file, 0, SEEK_SET);
 	std::string source;
-	source.resize(length + 1);
+	source.resize(length);
 
-	// Read file and add 0-termination
+	// Read file
 	fread(&source[0], length, 1, file);
-	source[length] = 0;
 	fclose(file);
+	return source;
+}
 
-	loadFromSource(source.c_str(), _fileName);
+// Returns true and the file name if the line is an #include "file" directive.
+static bool parseInclude(const std::string& _line, const std::string& _fileName, std::string& _include)
+{
+	size_t begin = _line.find_first_not_of(" \t");
+	if(begin == std::string::npos || _line.compare(begin, 8, "#include") != 0)
+		return false;
+	size_t open = _line.find('"', begin + 8);
+	size_t close = open == std::string::npos ? open : _line.find('"', open + 1);
+	if(close == std::string::npos)
+		throw std::exception(("Invalid #include in " + _fileName + ": " + _line).c_str());
+	_include = _line.substr(open + 1, close - open - 1);
+	return true;
+}
+
+// Appends the file to _output with all includes replaced. _files contains
+// the files which were included so far, _fileName is the last one.
+static void expandIncludes(const std::string& _fileName, std::vector<std::string>& _files, std::string& _output)
+{
+	const std::string fileIndex = std::to_string(_files.size() - 1);
+	const std::string directory = _fileName.substr(0, _fileName.find_last_of("/\\") + 1);
+	std::istringstream lines(gpupro::Shader::readFile(_fileName.c_str()));
+	std::string line;
+	int lineNumber = 0;
+	while(std::getline(lines, line))
+	{
+		++lineNumber;
+		std::string include;
+		if(!parseInclude(line, _fileName, include))
+		{
+			_output += line;
+			_output += '\n';
+			continue;
+		}
+		include = directory + include;
+		if(std::find(_files.begin(), _files.end(), include) == _files.end())
+		{
+			_files.push_back(include);
+			_output += "#line 1 " + std::to_string(_files.size() - 1) + '\n';
+			expandIncludes(include, _files, _output);
+		}
+		_output += "#line " + std::to_string(lineNumber + 1) + ' ' + fileIndex + '\n';
+	}
+}
+
+std::string gpupro::Shader::preprocess(const char* _fileName, const Defines& _defines)
+{
+	std::vector<std::string> files(1, _fileName);
+	std::string source;
+	expandIncludes(_fileName, files, source);
+	if(_defines.empty())
+		return source;
+
+	// Nothing but comments may precede #version
+	size_t version = source.find("#version");
+	if(version == std::string::npos)
+		throw std::exception(("Cannot add defines to " + std::string(_fileName) + " without #version").c_str());
+	size_t lineEnd = source.find('\n', version);
+	if(lineEnd == std::string::npos)
+		lineEnd = source.size();
+	std::string defines;
+	for(auto& define : _defines)
+		defines += "#define " + define.first + ' ' + define.second + '\n';
+	int nextLine = int(std::count(source.begin(), source.begin() + lineEnd, '\n')) + 2;
+	defines += "#line " + std::to_string(nextLine) + " 0\n";
+	source.insert(std::min(lineEnd + 1, source.size()), defines);
+	return source;
 }
@@ -0,0 +1,186 @@
+#include "stagingring.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+gpupro::StagingRing::Staging::Staging(GLsizeiptr _size) :
+	buffer(Buffer::Type::PIXEL_UNPACK, GLuint(_size), 1,
+		Buffer::Usage(Buffer::Usage::MAP_WRITE | Buffer::Usage::MAP_PERSISTENT | Buffer::Usage::MAP_COHERENT)),
+	used(0),
+	numPending(0),
+	closed(false),
+	fenced(false)
+{
+	data = static_cast<char*>(buffer.map(Buffer::MappingFlags(Buffer::MappingFlags::WRITE | Buffer::MappingFlags::PERSISTENT)));
+}
+
+gpupro::StagingRing::StagingRing(GLsizeiptr _bufferSize, int _numBuffers, unsigned _numThreads) :
+	m_current(0),
+	m_stop(false)
+{
+	for(int i = 0; i < std::max(_numBuffers, 1); ++i)
+	{
+		m_stagings.emplace_back(new Staging(_bufferSize));
+		if(!m_stagings.back()->data)
+			std::cerr << "ERR: Cannot map a staging buffer persistently!\n";
+	}
+
+	if(_numThreads == 0)
+		_numThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned i = 0; i < _numThreads; ++i)
+		m_threads.emplace_back(&StagingRing::workerLoop, this);
+}
+
+gpupro::StagingRing::~StagingRing()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_stop = true;
+	}
+	m_workCondition.notify_all();
+	for(auto& thread : m_threads)
+		thread.join();
+
+	for(auto& staging : m_stagings)
+		if(staging->data)
+			staging->buffer.unmap();
+}
+
+void gpupro::StagingRing::workerLoop()
+{
+	while(true)
+	{
+		Job* job;
+		{
+			std::unique_lock<std::mutex> lock(m_workMutex);
+			m_workCondition.wait(lock, [this]() { return m_stop || !m_work.empty(); });
+			if(m_stop)
+				return;
+			job = m_work.front();
+			m_work.pop_front();
+		}
+		job->fill(m_stagings[job->staging]->data + job->bufferOffset);
+		job->filled.store(true, std::memory_order_release);
+	}
+}
+
+bool gpupro::StagingRing::hasSpace(GLsizeiptr _size)
+{
+	Staging* staging = m_stagings[m_current].get();
+	if(!staging->closed && staging->used + _size > staging->buffer.size())
+	{
+		if(staging->used == 0)
+		{
+			std::cerr << "ERR: Upload is larger than a staging buffer!\n";
+			return false;
+		}
+		// Continue with the next buffer
+		staging->closed = true;
+		fenceIfDone(*staging);
+		m_current = (m_current + 1) % int(m_stagings.size());
+		staging = m_stagings[m_current].get();
+	}
+
+	if(staging->closed)
+	{
+		// Reuse a buffer after the GPU read it
+		if(!staging->fenced || !staging->fence.isSignaled())
+			return false;
+		staging->used = 0;
+		staging->closed = false;
+		staging->fenced = false;
+	}
+	return staging->data && staging->used + _size <= staging->buffer.size();
+}
+
+bool gpupro::StagingRing::upload(Texture& _texture, GLuint _mipLevel, GLint _x, GLint _y, GLint _z,
+	GLsizei _width, GLsizei _height, GLsizei _depth, SetDataFormat _format, SetDataType _type,
+	GLsizeiptr _size, FillFunction _fill, UploadedFunction _uploaded)
+{
+	if(!hasSpace(_size))
+		return false;
+
+	Staging& staging = *m_stagings[m_current];
+	std::unique_ptr<Job> job(new Job);
+	job->texture = &_texture;
+	job->mipLevel = _mipLevel;
+	job->offset[0] = _x; job->offset[1] = _y; job->offset[2] = _z;
+	job->size[0] = _width; job->size[1] = _height; job->size[2] = _depth;
+	job->format = _format;
+	job->type = _type;
+	job->staging = m_current;
+	job->bufferOffset = staging.used;
+	job->fill = std::move(_fill);
+	job->uploaded = std::move(_uploaded);
+	job->filled = false;
+	// Keep the offsets 16 byte aligned for the texel sizes of all formats
+	staging.used = (staging.used + _size + 15) / 16 * 16;
+	++staging.numPending;
+
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_work.push_back(job.get());
+	}
+	m_workCondition.notify_one();
+	m_pending.push_back(std::move(job));
+	return true;
+}
+
+int gpupro::StagingRing::issue()
+{
+	int numIssued = 0;
+	// The staged texels are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	while(!m_pending.empty() && m_pending.front()->filled.load(std::memory_order_acquire))
+	{
+		Job& job = *m_pending.front();
+		Staging& staging = *m_stagings[job.staging];
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer.glID());
+		job.texture->setData(job.mipLevel, job.offset[0], job.offset[1], job.offset[2],
+			job.size[0], job.size[1], job.size[2], job.format, job.type, reinterpret_cast<const void*>(job.bufferOffset));
+		if(job.uploaded)
+			job.uploaded();
+		--staging.numPending;
+		fenceIfDone(staging);
+		m_pending.pop_front();
+		++numIssued;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return numIssued;
+}
+
+void gpupro::StagingRing::fenceIfDone(Staging& _staging)
+{
+	if(_staging.closed && !_staging.fenced && _staging.numPending == 0)
+	{
+		_staging.fence.set();
+		_staging.fenced = true;
+	}
+}
+
+int gpupro::StagingRing::update()
+{
+	int numIssued = issue();
+
+	// The next frame writes into the next buffer
+	Staging& staging = *m_stagings[m_current];
+	if(!staging.closed && staging.used > 0)
+	{
+		staging.closed = true;
+		fenceIfDone(staging);
+		m_current = (m_current + 1) % int(m_stagings.size());
+	}
+	return numIssued;
+}
+
+void gpupro::StagingRing::finish()
+{
+	while(!m_pending.empty())
+	{
+		issue();
+		std::this_thread::yield();
+	}
+}
@@ -1,4 +1,6 @@
 #include "texture.hpp"
+#include "context.hpp"
+#include "directstateaccess.hpp"
 
 #include <iostream>
 #include <algorithm>
@@ -31,11 +33,10 @@ gpupro::Texture::Texture(InternalFormat _format, const char* _fileName) :
 }
 
 gpupro::Texture::Texture(Layout _layout, GLsizei _width, InternalFormat _format, GLsizei _numMipLevels) :
+	m_id(0),
 	m_layout(_layout),
 	m_format(_format)
 {
-	glGenTextures(1, &m_id);
-
 	m_numMipLevels = computeCorrectedMipmapLevels(_numMipLevels, _width);
 
 	switch(_layout)
@@ -61,11 +62,10 @@ gpupro::Texture::Texture(Layout _layout, GLsizei _width, InternalFormat _format,
 }
 
 gpupro::Texture::Texture(Layout _layout, GLsizei _width, GLsizei _height, InternalFormat _format, GLsizei _numMipLevels) :
+	m_id(0),
 	m_layout(_layout),
 	m_format(_format)
 {
-	glGenTextures(1, &m_id);
-
 	switch(_layout)
 	{
 	case Layout::TEX_2D:
@@ -88,11 +88,10 @@ gpupro::Texture::Texture(Layout _layout, GLsizei _width, GLsizei _height, Intern
 }
 
 gpupro::Texture::Texture(Layout _layout, GLsizei _width, GLsizei _height, GLsizei _depth, InternalFormat _format, GLsizei _numMipLevels) :
+	m_id(0),
 	m_layout(_layout),
 	m_format(_format)
 {
-	glGenTextures(1, &m_id);
-
 	switch(_layout)
 	{
 	case Layout::TEX_3D:
@@ -111,6 +110,7 @@ gpupro::Texture::Texture(Layout _layout, GLsizei _width, GLsizei _height, GLsize
 
 gpupro::Texture::~Texture()
 {
+	if(OGLContext::current()) OGLContext::current()->forgetTexture(m_id);
 	glDeleteTextures(1, &m_id);
 }
 
@@ -126,6 +126,7 @@ gpupro::Texture::Texture(Texture&& _rhs) :
 
 gpupro::Texture& gpupro::Texture::operator=(Texture&& _rhs)
 {
+	if(OGLContext::current()) OGLContext::current()->forgetTexture(m_id);
 	glDeleteTextures(1, &m_id);
 
 	m_id = _rhs.m_id;
@@ -165,7 +166,6 @@ void gpupro::Texture::load(const char* _fileName, GLuint _layer, bool _generateM
 			*this = std::move(Texture(m_layout, width, height, m_format, _generateMipMaps ? 0 : 1));
 		} else {
 			// Texture was created without allocation
-			glGenTextures(1, &m_id);
 			m_size[0] = width;
 			m_size[1] = height;
 			m_size[2] = 1;
@@ -180,44 +180,135 @@ void gpupro::Texture::load(const char* _fileName, GLuint _layer, bool _generateM
 	if(_generateMipMaps) {
 		if(m_layout != Layout::CUBE_MAP || _layer == 5)
 		{
-			glBindTexture(static_cast<GLenum>(m_layout), m_id);
-			glGenerateMipmap(static_cast<GLenum>(m_layout));
+			if(dsa::isAvailable())
+				dsa::generateTextureMipmap(m_id);
+			else {
+				glBindTexture(static_cast<GLenum>(m_layout), m_id);
+				glGenerateMipmap(static_cast<GLenum>(m_layout));
+			}
 		}
 	}
 }
 
 void gpupro::Texture::setData(GLuint _mipLevel, GLuint _layer, SetDataFormat _format, SetDataType _type, const void* _data)
 {
+	// Size of the mip level
+	GLsizei width = std::max(1, m_size[0] >> _mipLevel);
+	GLsizei height = std::max(1, m_size[1] >> _mipLevel);
+	GLsizei depth = std::max(1, m_size[2] >> _mipLevel);
+
+	if(dsa::isAvailable())
+	{
+		// Cube map faces and array layers are the z-coordinate of the
+		// 3D variant.
+		if(m_layout == Layout::TEX_1D)
+			dsa::textureSubImage1D(m_id, _mipLevel, 0, width, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		else if(m_layout == Layout::TEX_2D)
+			dsa::textureSubImage2D(m_id, _mipLevel, 0, 0, width, height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		else if(m_layout == Layout::TEX_3D)
+			dsa::textureSubImage3D(m_id, _mipLevel, 0, 0, 0, width, height, depth, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		else
+			dsa::textureSubImage3D(m_id, _mipLevel, 0, 0, _layer, width, height, 1, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		return;
+	}
+
 	glBindTexture(static_cast<GLenum>(m_layout), m_id);
 	switch(m_layout)
 	{
 	case Layout::TEX_1D:
-		glTexSubImage1D(static_cast<GLenum>(m_layout), _mipLevel, 0, m_size[0], static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		glTexSubImage1D(static_cast<GLenum>(m_layout), _mipLevel, 0, width, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
 		break;
 	case Layout::TEX_2D:
-		glTexSubImage2D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, m_size[0], m_size[1], static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		glTexSubImage2D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, width, height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
 		break;
 	case Layout::TEX_3D:
-		glTexSubImage3D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, 0, m_size[0], m_size[1], m_size[2], static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		glTexSubImage3D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, 0, width, height, depth, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
 		break;
 	case Layout::CUBE_MAP:
-		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + _layer, _mipLevel, 0, 0, m_size[0], m_size[1], static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + _layer, _mipLevel, 0, 0, width, height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
 		break;
 	case Layout::TEX_2D_ARRAY:
 	case Layout::CUBE_MAP_ARRAY:
-		glTexSubImage3D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, _layer, m_size[0], m_size[1], 1, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		glTexSubImage3D(static_cast<GLenum>(m_layout), _mipLevel, 0, 0, _layer, width, height, 1, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
 		break;
 	}
 }
 
-void gpupro::Texture::bindAsTexture(GLuint _bindingIndex)
+void gpupro::Texture::setData(GLuint _mipLevel, GLint _x, GLint _y, GLint _z, GLsizei _width, GLsizei _height, GLsizei _depth,
+	SetDataFormat _format, SetDataType _type, const void* _data)
 {
-	glActiveTexture(GL_TEXTURE0 + _bindingIndex);
+	if(dsa::isAvailable())
+	{
+		// Without binding, cube maps are addressed like a 2D array with
+		// six layers, so several faces can be updated at once.
+		if(m_layout == Layout::TEX_1D)
+			dsa::textureSubImage1D(m_id, _mipLevel, _x, _width, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		else if(m_layout == Layout::TEX_2D)
+			dsa::textureSubImage2D(m_id, _mipLevel, _x, _y, _width, _height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		else
+			dsa::textureSubImage3D(m_id, _mipLevel, _x, _y, _z, _width, _height, _depth, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		return;
+	}
+
 	glBindTexture(static_cast<GLenum>(m_layout), m_id);
+	switch(m_layout)
+	{
+	case Layout::TEX_1D:
+		glTexSubImage1D(static_cast<GLenum>(m_layout), _mipLevel, _x, _width, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		break;
+	case Layout::TEX_2D:
+		glTexSubImage2D(static_cast<GLenum>(m_layout), _mipLevel, _x, _y, _width, _height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		break;
+	case Layout::CUBE_MAP:
+		// Faces are separate targets
+		if(_depth != 1)
+			std::cerr << "ERR: Sub-region updates of cube maps must be done face by face!\n";
+		else
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + _z, _mipLevel, _x, _y, _width, _height, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		break;
+	case Layout::TEX_3D:
+	case Layout::TEX_2D_ARRAY:
+	case Layout::CUBE_MAP_ARRAY:
+		glTexSubImage3D(static_cast<GLenum>(m_layout), _mipLevel, _x, _y, _z, _width, _height, _depth, static_cast<GLenum>(_format), static_cast<GLenum>(_type), _data);
+		break;
+	}
+}
+
+void gpupro::Texture::bindAsTexture(GLuint _bindingIndex)
+{
+	if(OGLContext::current())
+		OGLContext::current()->bindTexture(_bindingIndex, m_id);
+	else glBindTextures(_bindingIndex, 1, &m_id);
 }
 
 void gpupro::Texture::allocateMemory()
 {
+	if(dsa::isAvailable())
+	{
+		dsa::createTextures(static_cast<GLenum>(m_layout), 1, &m_id);
+		switch(m_layout)
+		{
+		case Layout::TEX_1D:
+			dsa::textureStorage1D(m_id, m_numMipLevels, static_cast<GLenum>(m_format), m_size[0]);
+			break;
+		case Layout::TEX_2D:
+		case Layout::CUBE_MAP:
+			dsa::textureStorage2D(m_id, m_numMipLevels, static_cast<GLenum>(m_format), m_size[0], m_size[1]);
+			break;
+		case Layout::TEX_3D:
+		case Layout::TEX_2D_ARRAY:
+			dsa::textureStorage3D(m_id, m_numMipLevels, static_cast<GLenum>(m_format), m_size[0], m_size[1], m_size[2]);
+			break;
+		case Layout::CUBE_MAP_ARRAY:
+			dsa::textureStorage3D(m_id, m_numMipLevels, static_cast<GLenum>(m_format), m_size[0], m_size[1], m_size[2] * 6);
+			break;
+		}
+		return;
+	}
+
+	// The edit unit of the context is active, so this does not disturb
+	// the cached bindings.
+	glGenTextures(1, &m_id);
 	glBindTexture(static_cast<GLenum>(m_layout), m_id);
 
 	switch(m_layout)
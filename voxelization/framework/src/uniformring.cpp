@@ -0,0 +1,101 @@
+#include "uniformring.hpp"
+#include "context.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+static GLsizeiptr alignUp(GLsizeiptr _offset, GLsizeiptr _alignment)
+{
+	return (_offset + _alignment - 1) / _alignment * _alignment;
+}
+
+static GLsizeiptr uniformAlignment()
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	return std::max(alignment, 1);
+}
+
+gpupro::UniformRing::UniformRing(GLsizeiptr _frameSize, int _numFramesInFlight) :
+	m_capacity(alignUp(_frameSize, uniformAlignment()) * std::max(_numFramesInFlight, 1)),
+	m_alignment(uniformAlignment()),
+	m_buffer(Buffer::Type::UNIFORM, GLuint(m_capacity), 1,
+		Buffer::Usage(Buffer::Usage::MAP_WRITE | Buffer::Usage::MAP_PERSISTENT | Buffer::Usage::MAP_COHERENT)),
+	m_head(0),
+	m_used(0),
+	m_frameBytes(0),
+	m_numStalls(0)
+{
+	m_data = static_cast<char*>(m_buffer.map(Buffer::MappingFlags(Buffer::MappingFlags::WRITE | Buffer::MappingFlags::PERSISTENT)));
+	if(!m_data)
+		std::cerr << "ERR: Cannot map the uniform ring persistently!\n";
+}
+
+gpupro::UniformRing::~UniformRing()
+{
+	if(m_data)
+		m_buffer.unmap();
+}
+
+gpupro::UniformRing::Block gpupro::UniformRing::allocate(GLsizeiptr _size)
+{
+	Block block = {nullptr, 0, _size};
+	if(!m_data)
+		return block;
+
+	// Blocks are contiguous. If the end of the buffer is too small the
+	// rest is skipped.
+	GLintptr offset = alignUp(m_head, m_alignment);
+	if(offset + _size > m_capacity)
+		offset = 0;
+	GLsizeiptr numBytes = offset >= m_head ? offset + _size - m_head : m_capacity - m_head + _size;
+
+	// The free bytes start at the head, wait for old frames until there
+	// are enough.
+	while(m_used + numBytes > m_capacity)
+	{
+		if(m_frames.empty())
+		{
+			std::cerr << "ERR: The uniform ring is too small for a single frame!\n";
+			return block;
+		}
+		retireFrame();
+	}
+
+	m_head = offset + _size;
+	if(m_head == m_capacity) m_head = 0;
+	m_used += numBytes;
+	m_frameBytes += numBytes;
+	block.data = m_data + offset;
+	block.offset = offset;
+	return block;
+}
+
+void gpupro::UniformRing::bindAsUniformBuffer(GLuint _bindingIndex, const Block& _block)
+{
+	m_buffer.bindAsUniformBuffer(_bindingIndex, _block.offset, _block.size);
+}
+
+void gpupro::UniformRing::endFrame()
+{
+	m_frames.emplace_back();
+	m_frames.back().fence.set();
+	m_frames.back().numBytes = m_frameBytes;
+	m_frameBytes = 0;
+
+	// Release finished frames without waiting to keep the list short
+	while(!m_frames.empty() && m_frames.front().fence.isSignaled())
+		retireFrame();
+}
+
+void gpupro::UniformRing::retireFrame()
+{
+	Frame& frame = m_frames.front();
+	if(!frame.fence.isSignaled())
+	{
+		++m_numStalls;
+		frame.fence.wait();
+	}
+	m_used -= frame.numBytes;
+	m_frames.pop_front();
+}
@@ -16,8 +16,15 @@ static bool isIntegerType(gpupro::VertexAttribute::Type _t)
 	}
 }
 
-gpupro::VertexFormat::VertexFormat(const std::vector<VertexAttribute>& _attributes)
+static unsigned s_numCreatedFormats = 0;
+
+gpupro::VertexFormat::VertexFormat(const std::vector<VertexAttribute>& _attributes) :
+	m_serial(++s_numCreatedFormats)
 {
+	// Restore the previous binding afterwards, the OGLContext keeps track
+	// of the bound vertex array.
+	GLint previousBinding;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousBinding);
 	glGenVertexArrays(1, &m_id);
 	glBindVertexArray(m_id);
 
@@ -35,6 +42,7 @@ gpupro::VertexFormat::VertexFormat(const std::vector<VertexAttribute>& _attribut
 		// Otherwise it is overwritten and expects attribIndex == vboIndex.
 		glVertexAttribBinding(attr.attributIndex, attr.vboBindingIndex);
 	}
+	glBindVertexArray(previousBinding);
 }
 
 gpupro::VertexFormat::~VertexFormat()
@@ -43,9 +51,11 @@ gpupro::VertexFormat::~VertexFormat()
 }
 
 gpupro::VertexFormat::VertexFormat(VertexFormat&& _rhs) :
-	m_id(_rhs.m_id)
+	m_id(_rhs.m_id),
+	m_serial(_rhs.m_serial)
 {
 	_rhs.m_id = 0;
+	_rhs.m_serial = 0;
 }
 
 gpupro::VertexFormat& gpupro::VertexFormat::operator=(VertexFormat&& _rhs)
@@ -53,7 +63,9 @@ gpupro::VertexFormat& gpupro::VertexFormat::operator=(VertexFormat&& _rhs)
 	glDeleteVertexArrays(1, &m_id);
 
 	m_id = _rhs.m_id;
+	m_serial = _rhs.m_serial;
 	_rhs.m_id = 0;
+	_rhs.m_serial = 0;
 
 	return *this;
 }
@@ -0,0 +1,43 @@
+#version 440 core
+
+// *** In and Outputs ***
+// Faces captured by voxel_capture.geom (see FeedbackFaceCache).
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in int in_voxelIndex;
+layout(location = 0) out vec3 out_position;
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec4 out_color;
+layout(location = 3) out float out_ambientOcclusion;
+
+// *** Textures ***
+#include "include/voxelatlas.glsl"
+// Precomputed visible fraction of the hemisphere (R8).
+layout(binding = 3) uniform sampler3D tex_ambientOcclusion;
+
+// *** Buffers and Uniforms ***
+#include "include/transform.glsl"
+
+// *** Entry point ***
+void main()
+{
+	ivec3 texSize = u_volumeSize;
+	ivec3 texCoord;
+	texCoord.z = in_voxelIndex / (texSize.x * texSize.y);
+	texCoord.y = (in_voxelIndex % (texSize.x * texSize.y)) / texSize.x;
+	texCoord.x = (in_voxelIndex % (texSize.x * texSize.y)) % texSize.x;
+
+	// Colors are fetched here because bricks are streamed independent of the
+	// capture. Faces of bricks which are not loaded collapse to a point.
+	uvec4 page = texelFetch(tex_pageTable, texCoord / BRICK_SIZE, 0);
+	if( page.w == 0u )
+	{
+		gl_Position = vec4(0.0);
+		return;
+	}
+	out_color = fetchVoxelColor(page, texCoord);
+	out_ambientOcclusion = texelFetch(tex_ambientOcclusion, texCoord, 0).r;
+	out_position = in_position;
+	out_normal = in_normal;
+	gl_Position = u_viewProjection * vec4(in_position, 1);
+}
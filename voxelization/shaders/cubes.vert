@@ -0,0 +1,71 @@
+#version 440 core
+
+// *** In and Outputs ***
+// Voxel index of the instance (see InstancedCubeRenderer).
+layout(location = 0) in uint in_voxelIndex;
+layout(location = 0) out vec3 out_position;
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec4 out_color;
+layout(location = 3) out float out_ambientOcclusion;
+
+// *** Textures ***
+#include "include/voxelatlas.glsl"
+// Precomputed visible fraction of the hemisphere (R8).
+layout(binding = 3) uniform sampler3D tex_ambientOcclusion;
+#include "include/occupancy.glsl"
+
+// *** Buffers and Uniforms ***
+#include "include/transform.glsl"
+
+#define POSITIVE_THRESHOLD 0.0001
+#define NEGATIVE_THRESHOLD -POSITIVE_THRESHOLD
+
+int getOppositeSign(float x)
+{
+	if(x > POSITIVE_THRESHOLD)
+		return -1;
+	else if(x < NEGATIVE_THRESHOLD)
+		return 1;
+	else
+		return 0;
+}
+
+// Corners of a quad in the triangle strip order of voxel.geom.
+const vec2 CORNERS[4] = {vec2(1.0, -1.0), vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)};
+
+// *** Entry point ***
+void main()
+{
+	ivec3 texSize = u_volumeSize;
+	int voxelIndex = int(in_voxelIndex);
+	ivec3 texCoord;
+	texCoord.z = voxelIndex / (texSize.x * texSize.y);
+	texCoord.y = (voxelIndex % (texSize.x * texSize.y)) / texSize.x;
+	texCoord.x = (voxelIndex % (texSize.x * texSize.y)) % texSize.x;
+
+	// Quad i of the instance is the face along axis i towards the camera.
+	int axis = gl_VertexID / 4;
+	vec2 corner = CORNERS[gl_VertexID % 4];
+	vec3 dir = vec3(0.0);
+	dir[axis] = 1.0;
+	vec3 a1 = dir.x == 0.0 ? vec3(1.0,0.0,0.0) : vec3(0.0,1.0,0.0);
+	vec3 a2 = vec3(1.0) - dir - a1;
+	vec3 center = vec3(texCoord);
+	int s = getOppositeSign(dot(center - u_cameraPosition, dir));
+
+	// Same culling as in voxel.geom, culled faces collapse to a single point.
+	bool visible = s != 0 && isOccupied(texCoord, texSize) && !isOccupied(texCoord + ivec3(dir) * s, texSize);
+	uvec4 page = texelFetch(tex_pageTable, texCoord / BRICK_SIZE, 0);
+	visible = visible && page.w != 0u;
+	if( !visible )
+	{
+		gl_Position = vec4(0.0);
+		return;
+	}
+
+	out_normal = dir * s + 0.1 * corner.x * a1 + 0.1 * corner.y * a2;
+	out_position = center + 0.5 * (dir * s + corner.x * a1 + corner.y * a2);
+	gl_Position = u_viewProjection * vec4(out_position, 1);
+	out_color = fetchVoxelColor(page, texCoord);
+	out_ambientOcclusion = texelFetch(tex_ambientOcclusion, texCoord, 0).r;
+}
@@ -0,0 +1,74 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) out vec3 out_position;
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec4 out_color;
+layout(location = 3) out float out_ambientOcclusion;
+
+// *** Textures ***
+#include "include/voxelatlas.glsl"
+// Precomputed visible fraction of the hemisphere (R8).
+layout(binding = 3) uniform sampler3D tex_ambientOcclusion;
+
+// *** Buffers and Uniforms ***
+#include "include/transform.glsl"
+
+// Potentially visible faces (see FaceIntervalCache): voxel index in x,
+// face (bits 0-2), lo (bits 3-11) and hi (bits 12-20) in y.
+layout(binding = 2, std430) readonly buffer ssbo_faces
+{
+	uvec2 faces[];
+};
+
+#define POSITIVE_THRESHOLD 0.0001
+
+// Corners of the two triangles of a face, same order as in voxel.geom.
+const vec2 CORNERS[6] = {vec2(1.0, -1.0), vec2(-1.0, -1.0), vec2(1.0, 1.0),
+	vec2(1.0, 1.0), vec2(-1.0, -1.0), vec2(-1.0, 1.0)};
+
+// *** Entry point ***
+void main()
+{
+	uvec2 face = faces[gl_VertexID / 6];
+	vec2 corner = CORNERS[gl_VertexID % 6];
+
+	ivec3 texSize = u_volumeSize;
+	int voxelIndex = int(face.x);
+	ivec3 texCoord;
+	texCoord.z = voxelIndex / (texSize.x * texSize.y);
+	texCoord.y = (voxelIndex % (texSize.x * texSize.y)) / texSize.x;
+	texCoord.x = (voxelIndex % (texSize.x * texSize.y)) % texSize.x;
+
+	int axis = int(face.y & 7u) >> 1;
+	float s = (face.y & 1u) == 0u ? 1.0 : -1.0;
+	vec3 dir = vec3(0.0);
+	dir[axis] = 1.0;
+	vec3 a1 = dir.x == 0.0 ? vec3(1.0,0.0,0.0) : vec3(0.0,1.0,0.0);
+	vec3 a2 = vec3(1.0) - dir - a1;
+
+	vec3 center = vec3(texCoord);
+	out_normal = dir * s + 0.1 * corner.x * a1 + 0.1 * corner.y * a2;
+	out_position = center + 0.5 * (dir * s + corner.x * a1 + corner.y * a2);
+	gl_Position = u_viewProjection * vec4(out_position, 1);
+
+	// The face is exposed iff lo <= q < hi for the quantized threshold (see
+	// Volume::quantizeThreshold). Culled faces collapse to a single point.
+	int threshold = int(clamp(ceil(u_discardThresh * 255.0), 0.0, 256.0));
+	int lo = int((face.y >> 3) & 511u);
+	int hi = int((face.y >> 12) & 511u);
+	bool visible = threshold >= lo && threshold < hi;
+	// Back faces, the same test as in voxel.geom
+	visible = visible && dot(center - u_cameraPosition, dir) * s < -POSITIVE_THRESHOLD;
+
+	// Voxels of bricks which are not loaded yet are skipped.
+	uvec4 page = texelFetch(tex_pageTable, texCoord / BRICK_SIZE, 0);
+	visible = visible && page.w != 0u;
+	if( !visible )
+	{
+		gl_Position = vec4(0.0);
+		return;
+	}
+	out_color = fetchVoxelColor(page, texCoord);
+	out_ambientOcclusion = texelFetch(tex_ambientOcclusion, texCoord, 0).r;
+}
@@ -0,0 +1,12 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) out vec2 out_ndc;
+
+// *** Entry point ***
+void main()
+{
+	// A single triangle which covers the entire screen (draw 3 vertices).
+	out_ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+	gl_Position = vec4(out_ndc, 0.0, 1.0);
+}
@@ -0,0 +1,13 @@
+#include "transform.glsl"
+
+// Quick and easy directional light: wrapped diffuse (x) and Blinn-Phong
+// specular (y) term.
+vec2 directionalLight(vec3 position, vec3 normal)
+{
+	float cosTheta = dot(u_lightDirection, normal);
+	vec3 viewDir = normalize(u_cameraPosition - position);
+	float diffuse = cosTheta * 0.5 + 0.5;
+	float HdotN = dot(normalize(viewDir + u_lightDirection), normal);
+	float specular = pow(max(0.0, HdotN), 6.0);
+	return vec2(diffuse, specular);
+}
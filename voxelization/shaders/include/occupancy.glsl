@@ -0,0 +1,10 @@
+// Occupancy bits of the current threshold, texel x holds voxels 32x..32x+31.
+layout(binding = 5) uniform usampler3D tex_occupancy;
+
+bool isOccupied(ivec3 c, ivec3 texSize)
+{
+	if(any(lessThan(c, ivec3(0))) || any(greaterThanEqual(c, texSize)))
+		return false;
+	uint bits = texelFetch(tex_occupancy, ivec3(c.x >> 5, c.y, c.z), 0).r;
+	return ((bits >> uint(c.x & 31)) & 1u) != 0u;
+}
@@ -0,0 +1,18 @@
+#include "lighting.glsl"
+
+// Fraction of the directional light which reaches a voxel.
+layout(binding = 4) uniform sampler3D tex_lightVisibility;
+
+// Directional light with the shadows of the light sweep and ambient
+// occlusion, to be multiplied with the luminance.
+float shadeVoxel(vec3 position, vec3 normal, float ambientOcclusion)
+{
+	vec2 light = directionalLight(position, normal);
+
+	// The ray in light direction was precomputed by the light sweep.
+	// Sampling at the face blends the voxel and its neighbor in front.
+	vec3 shadowCoord = (position + 0.5) / vec3(textureSize(tex_lightVisibility, 0));
+	float visibility = texture(tex_lightVisibility, shadowCoord).r;
+
+	return (0.2 + 0.7 * light.x * visibility) * ambientOcclusion + 0.5 * light.y * visibility;
+}
@@ -0,0 +1,10 @@
+// Per-frame camera and light, binding 0 of all voxel passes (see
+// TransformUniforms in voxel_main.cpp).
+layout(binding = 0, std140) uniform ubo_transform
+{
+	mat4 u_viewProjection;
+	vec3 u_cameraPosition;
+	float u_discardThresh;
+	vec3 u_lightDirection;
+	ivec3 u_volumeSize;
+};
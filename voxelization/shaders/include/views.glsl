@@ -0,0 +1,17 @@
+// Camera (w = 1) or direction towards the viewer (w = 0) and the slab of
+// voxels which are drawn in each view (see MultiViewRenderer).
+struct View
+{
+	mat4 viewProjection;
+	vec4 eye;
+	ivec4 slabMin;
+	ivec4 slabMax;
+};
+
+layout(binding = 2, std140) uniform ubo_views
+{
+	View u_views[4];
+	int u_firstView;
+	// View 0 draws voxel indices (VoxelDrawRanges) instead of sorted positions
+	int u_directIndices;
+};
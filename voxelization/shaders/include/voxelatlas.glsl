@@ -0,0 +1,48 @@
+// Resident bricks of the voxel colors (see BrickAtlas). The programs are
+// specialized for the format of the loaded texture (see
+// BrickAtlas::formatDefines()):
+// VOXEL_CHANNELS: number of channels (1-4)
+// VOXEL_INTEGER: 1 for unsigned integer formats, which are normalized by
+//		dividing through VOXEL_MAX.
+#ifndef VOXEL_CHANNELS
+#define VOXEL_CHANNELS 4
+#endif
+#ifndef VOXEL_INTEGER
+#define VOXEL_INTEGER 0
+#endif
+
+#if VOXEL_INTEGER
+layout(binding = 0) uniform usampler3D tex_voxelAtlas;
+#else
+layout(binding = 0) uniform sampler3D tex_voxelAtlas;
+#endif
+// Atlas slot of each brick (xyz), w is 0 if the brick is not resident.
+layout(binding = 6) uniform usampler3D tex_pageTable;
+
+#define BRICK_SIZE 8
+
+// Color of a voxel of a resident brick in [0,1], single channels are gray.
+vec4 fetchVoxelColor(uvec4 page, ivec3 voxel)
+{
+	ivec3 atlasCoord = ivec3(page.xyz) * BRICK_SIZE + voxel % BRICK_SIZE;
+#if VOXEL_INTEGER
+	vec4 color = vec4(texelFetch(tex_voxelAtlas, atlasCoord, 0)) / VOXEL_MAX;
+#else
+	vec4 color = texelFetch(tex_voxelAtlas, atlasCoord, 0);
+#endif
+#if VOXEL_CHANNELS == 1
+	return vec4(color.rrr, 1.0);
+#else
+	return color;
+#endif
+}
+
+// Luminance of a fetched color, same rules as in Volume.
+float voxelLuminance(vec4 color)
+{
+#if VOXEL_CHANNELS == 1
+	return color.r;
+#else
+	return dot(color.rgb, vec3(0.299, 0.587, 0.114));
+#endif
+}
@@ -0,0 +1,18 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec4 in_color;
+layout(location = 0) out vec3 out_fragColor;
+
+// *** Buffers and Uniforms ***
+#include "include/lighting.glsl"
+
+// *** Entry point ***
+// Lighting of shading.frag without the shadows and AO of the luminance.
+void main()
+{
+	vec2 light = directionalLight(in_position, normalize(in_normal));
+	out_fragColor = (0.2 + 0.7 * light.x) * in_color.rgb + 0.5 * light.y;
+}
@@ -0,0 +1,127 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) in vec2 in_ndc;
+layout(location = 0) out vec3 out_fragColor;
+
+// *** Textures ***
+#include "include/voxelatlas.glsl"
+
+// *** Buffers and Uniforms ***
+layout(binding = 1, std140) uniform ubo_octree
+{
+	mat4 u_invViewProjection;
+	ivec3 u_volumeSize;
+	int u_rootSize;
+	vec3 u_lightDirection;
+	int u_numLevels;
+	// Region of interest (see RegionOfInterest)
+	ivec3 u_roiMin;
+	int u_numClipPlanes;
+	ivec3 u_roiMax;
+	vec4 u_clipPlanes[6];
+};
+
+// Breadth first nodes of the sparse voxel octree (see octree.hpp).
+// Inner node: (child mask, first child), leaf: 4x4x4 voxel bits.
+layout(binding = 0, std430) readonly buffer ssbo_octree
+{
+	uvec2 nodes[];
+};
+
+#define LEAF_SIZE 4
+
+// Returns entry and exit distance of a ray through an axis aligned box.
+vec2 intersectBox(vec3 origin, vec3 invDir, vec3 boxMin, vec3 boxMax)
+{
+	vec3 t0 = (boxMin - origin) * invDir;
+	vec3 t1 = (boxMax - origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), tMin.z), min(min(tMax.x, tMax.y), tMax.z));
+}
+
+bool isInsideClipPlanes(ivec3 voxel)
+{
+	for(int i = 0; i < u_numClipPlanes; ++i)
+		if(dot(u_clipPlanes[i].xyz, vec3(voxel)) + u_clipPlanes[i].w < 0.0)
+			return false;
+	return true;
+}
+
+// Same hits as SparseVoxelOctree::raycast() (which uses a DDA within leaves).
+// Returns the distance to the first occupied voxel or -1.
+float raycast(vec3 origin, vec3 dir, vec3 invDir, out ivec3 hitVoxel)
+{
+	// Only the box of the region is traversed, clip planes are tested per voxel.
+	if(any(greaterThanEqual(u_roiMin, u_roiMax)))
+		return -1.0;
+	vec2 tRange = intersectBox(origin, invDir, vec3(u_roiMin) - 0.5, vec3(u_roiMax) - 0.5);
+	float t = max(tRange.x, 0.0);
+	while(t < tRange.y)
+	{
+		// Descend to the deepest node which contains the current position
+		ivec3 voxel = clamp(ivec3(floor(origin + (t + 1e-4) * dir + 0.5)), u_roiMin, u_roiMax - 1);
+		uint node = 0u;
+		ivec3 cellMin = ivec3(0);
+		int cellSize = u_rootSize;
+		bool empty = false;
+		for(int l = 0; l < u_numLevels - 1 && !empty; ++l)
+		{
+			cellSize /= 2;
+			ivec3 c = ivec3(greaterThanEqual(voxel - cellMin, ivec3(cellSize)));
+			uint child = uint(c.x + 2 * c.y + 4 * c.z);
+			uint mask = nodes[node].x;
+			cellMin += c * cellSize;
+			if((mask & (1u << child)) != 0u)
+				node = nodes[node].y + uint(bitCount(mask & ((1u << child) - 1u)));
+			else empty = true;
+		}
+		if(!empty)
+		{
+			ivec3 local = voxel - cellMin;
+			int bit = local.x + LEAF_SIZE * (local.y + LEAF_SIZE * local.z);
+			uint bits = bit < 32 ? nodes[node].x : nodes[node].y;
+			if((bits & (1u << uint(bit & 31))) != 0u && isInsideClipPlanes(voxel))
+			{
+				hitVoxel = voxel;
+				return t;
+			}
+			cellMin = voxel;
+			cellSize = 1;
+		}
+		// Skip the empty cell
+		t = max(intersectBox(origin, invDir, vec3(cellMin) - 0.5, vec3(cellMin + cellSize) - 0.5).y, t + 1e-4);
+	}
+	return -1.0;
+}
+
+// *** Entry point ***
+void main()
+{
+	// Reconstruct the view ray of this pixel
+	vec4 nearPoint = u_invViewProjection * vec4(in_ndc, -1.0, 1.0);
+	vec4 farPoint = u_invViewProjection * vec4(in_ndc, 1.0, 1.0);
+	vec3 origin = nearPoint.xyz / nearPoint.w;
+	vec3 dir = normalize(farPoint.xyz / farPoint.w - origin);
+	dir = mix(dir, vec3(1e-12), lessThan(abs(dir), vec3(1e-12)));
+	vec3 invDir = 1.0 / dir;
+
+	ivec3 voxel;
+	if(raycast(origin, dir, invDir, voxel) < 0.0)
+		discard;
+
+	// The normal is the face through which the ray entered the voxel.
+	vec3 t0 = (vec3(voxel) - 0.5 - origin) * invDir;
+	vec3 t1 = (vec3(voxel) + 0.5 - origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 normal = tMin.x >= tMin.y && tMin.x >= tMin.z ? vec3(-sign(dir.x), 0.0, 0.0)
+		: (tMin.y >= tMin.z ? vec3(0.0, -sign(dir.y), 0.0) : vec3(0.0, 0.0, -sign(dir.z)));
+
+	// Bricks which are not loaded yet are shown in gray.
+	uvec4 page = texelFetch(tex_pageTable, voxel / BRICK_SIZE, 0);
+	vec3 color = page.w == 0u ? vec3(0.5)
+		: fetchVoxelColor(page, voxel).rgb;
+	float diffuse = max(dot(normal, u_lightDirection), 0.0);
+	out_fragColor = color * (0.3 + 0.7 * diffuse);
+}
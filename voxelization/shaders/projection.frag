@@ -0,0 +1,118 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) in vec2 in_ndc;
+layout(location = 0) out vec3 out_fragColor;
+
+// *** Textures ***
+// One byte luminance per voxel.
+layout(binding = 1) uniform sampler3D tex_luminance;
+// Min (r) and max (g) luminance per brick. Coarser levels of the pyramid
+// are stored in the mip levels.
+layout(binding = 2) uniform sampler3D tex_brickMinMax;
+
+// *** Buffers and Uniforms ***
+layout(binding = 1, std140) uniform ubo_projection
+{
+	mat4 u_invViewProjection;
+	ivec3 u_volumeSize;
+	float u_stepSize;
+	int u_brickSize;
+	int u_numLevels;
+};
+
+// The program is specialized for PROJECTION_MODE (see ProjectionRenderer).
+#define MODE_MAXIMUM 0
+#define MODE_AVERAGE 1
+#ifndef PROJECTION_MODE
+#define PROJECTION_MODE MODE_MAXIMUM
+#endif
+
+// Returns entry and exit distance of a ray through an axis aligned box.
+vec2 intersectBox(vec3 origin, vec3 invDir, vec3 boxMin, vec3 boxMax)
+{
+	vec3 t0 = (boxMin - origin) * invDir;
+	vec3 t1 = (boxMax - origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), tMin.z), min(min(tMax.x, tMax.y), tMax.z));
+}
+
+// Search the coarsest node around the brick which cannot change the result
+// anymore and return the distance at which the ray leaves that node.
+// All luminance values are in [0,255].
+// Returns -1 if the brick must be sampled.
+float findSkipDistance(ivec3 brick, float acc, vec3 origin, vec3 invDir)
+{
+	for(int l = u_numLevels - 1; l >= 0; --l)
+	{
+		ivec3 levelSize = textureSize(tex_brickMinMax, l);
+		ivec3 node = min(brick >> l, levelSize - 1);
+		float nodeMax = round(texelFetch(tex_brickMinMax, node, l).g * 255.0);
+#if PROJECTION_MODE == MODE_MAXIMUM
+		bool skip = nodeMax <= acc;
+#else
+		bool skip = nodeMax == 0.0;
+#endif
+		if(skip)
+		{
+			// The last node in each dimension covers the rest of the volume.
+			ivec3 lo = (node << l) * u_brickSize;
+			ivec3 hi = min(((node + 1) << l) * u_brickSize, u_volumeSize);
+			hi.x = node.x == levelSize.x - 1 ? u_volumeSize.x : hi.x;
+			hi.y = node.y == levelSize.y - 1 ? u_volumeSize.y : hi.y;
+			hi.z = node.z == levelSize.z - 1 ? u_volumeSize.z : hi.z;
+			return intersectBox(origin, invDir, vec3(lo) - 0.5, vec3(hi) - 0.5).y;
+		}
+	}
+	return -1.0;
+}
+
+// *** Entry point ***
+void main()
+{
+	// Reconstruct the view ray of this pixel
+	vec4 nearPoint = u_invViewProjection * vec4(in_ndc, -1.0, 1.0);
+	vec4 farPoint = u_invViewProjection * vec4(in_ndc, 1.0, 1.0);
+	vec3 origin = nearPoint.xyz / nearPoint.w;
+	vec3 dir = normalize(farPoint.xyz / farPoint.w - origin);
+	vec3 invDir = 1.0 / mix(dir, vec3(1e-12), lessThan(abs(dir), vec3(1e-12)));
+
+	// Voxel centers are at integer positions
+	vec2 tRange = intersectBox(origin, invDir, vec3(-0.5), vec3(u_volumeSize) - 0.5);
+	float tEnter = max(tRange.x, 0.0);
+	float numSamples = max(0.0, ceil((tRange.y - tEnter) / u_stepSize - 0.5));
+
+	float acc = 0.0;
+	ivec3 lastBrick = ivec3(-1);
+	float i = 0.0;
+	while(i < numSamples)
+	{
+		vec3 pos = origin + (tEnter + (i + 0.5) * u_stepSize) * dir;
+		ivec3 voxel = clamp(ivec3(floor(pos + 0.5)), ivec3(0), u_volumeSize - 1);
+		ivec3 brick = voxel / u_brickSize;
+		if(brick != lastBrick)
+		{
+			lastBrick = brick;
+			float tSkip = findSkipDistance(brick, acc, origin, invDir);
+			if(tSkip >= 0.0)
+			{
+				i = max(i + 1.0, ceil((tSkip - tEnter) / u_stepSize - 0.5));
+				continue;
+			}
+		}
+
+		float lum = round(texelFetch(tex_luminance, voxel, 0).r * 255.0);
+#if PROJECTION_MODE == MODE_MAXIMUM
+		acc = max(acc, lum);
+#else
+		acc += lum;
+#endif
+		i += 1.0;
+	}
+
+#if PROJECTION_MODE == MODE_AVERAGE
+	acc = numSamples > 0.0 ? acc / numSamples : 0.0;
+#endif
+	out_fragColor = vec3(acc / 255.0);
+}
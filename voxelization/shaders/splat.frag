@@ -0,0 +1,54 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) flat in vec3 in_boxMin;
+layout(location = 1) flat in vec3 in_boxMax;
+layout(location = 2) flat in vec4 in_color;
+layout(location = 3) flat in float in_ambientOcclusion;
+layout(location = 0) out vec3 out_fragColor;
+
+// *** Textures and Uniforms ***
+#include "include/shadow.glsl"
+#include "include/voxelatlas.glsl"
+
+layout(binding = 1, std140) uniform ubo_splat
+{
+	mat4 u_invViewProjection;
+	vec2 u_viewportSize;
+	float u_cellSize;
+	int u_level;
+	ivec3 u_levelSize;
+};
+
+// *** Entry point ***
+void main()
+{
+	// Intersect the view ray of this pixel with the cell
+	vec2 ndc = gl_FragCoord.xy / u_viewportSize * 2.0 - 1.0;
+	vec4 nearPoint = u_invViewProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPoint = u_invViewProjection * vec4(ndc, 1.0, 1.0);
+	vec3 origin = nearPoint.xyz / nearPoint.w;
+	vec3 dir = normalize(farPoint.xyz / farPoint.w - origin);
+	dir = mix(dir, vec3(1e-12), lessThan(abs(dir), vec3(1e-12)));
+	vec3 invDir = 1.0 / dir;
+	vec3 t0 = (in_boxMin - origin) * invDir;
+	vec3 t1 = (in_boxMax - origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	float tEnter = max(max(tMin.x, tMin.y), tMin.z);
+	float tExit = min(min(tMax.x, tMax.y), tMax.z);
+	if(tEnter > tExit || tExit < 0.0)
+		discard;
+
+	// Depth of the entry point, the same as for rasterized faces
+	vec3 position = origin + max(tEnter, 0.0) * dir;
+	vec4 clipPosition = u_viewProjection * vec4(position, 1.0);
+	gl_FragDepth = (clipPosition.z / clipPosition.w) * 0.5 + 0.5;
+
+	// The normal is the face through which the ray entered the cell.
+	vec3 normal = tMin.x >= tMin.y && tMin.x >= tMin.z ? vec3(-sign(dir.x), 0.0, 0.0)
+		: (tMin.y >= tMin.z ? vec3(0.0, -sign(dir.y), 0.0) : vec3(0.0, 0.0, -sign(dir.z)));
+
+	// Same lighting as shading.frag
+	out_fragColor = vec3(shadeVoxel(position, normal, in_ambientOcclusion) * voxelLuminance(in_color));
+}
@@ -0,0 +1,120 @@
+#version 440 core
+
+// *** In and Outputs ***
+// Box of the cell in world space (voxel centers at integer positions).
+layout(location = 0) flat out vec3 out_boxMin;
+layout(location = 1) flat out vec3 out_boxMax;
+layout(location = 2) flat out vec4 out_color;
+layout(location = 3) flat out float out_ambientOcclusion;
+
+// *** Textures ***
+#include "include/voxelatlas.glsl"
+// Precomputed visible fraction of the hemisphere (R8).
+layout(binding = 3) uniform sampler3D tex_ambientOcclusion;
+
+// *** Buffers and Uniforms ***
+#include "include/transform.glsl"
+
+layout(binding = 1, std140) uniform ubo_splat
+{
+	mat4 u_invViewProjection;
+	vec2 u_viewportSize;
+	float u_cellSize;
+	int u_level;
+	ivec3 u_levelSize;
+	// Region of interest (see RegionOfInterest)
+	ivec3 u_roiMin;
+	int u_numClipPlanes;
+	ivec3 u_roiMax;
+	vec4 u_clipPlanes[6];
+};
+
+// Level 0: voxel indices sorted by luminance (see SortedVoxelIndex).
+layout(binding = 1, std430) readonly buffer ssbo_sortedVoxels
+{
+	uint sortedVoxels[];
+};
+
+// Coarser levels: (cell index, maximum luminance) sorted by luminance.
+layout(binding = 3, std430) readonly buffer ssbo_levelCells
+{
+	uvec2 levelCells[];
+};
+
+// Same conservative test as RegionOfInterest::intersects() for the voxels
+// [lo, hi) which are already clamped to the box.
+bool isInsideClipPlanes(ivec3 lo, ivec3 hi)
+{
+	for(int i = 0; i < u_numClipPlanes; ++i)
+	{
+		vec3 corner = mix(vec3(lo), vec3(hi - 1), greaterThanEqual(u_clipPlanes[i].xyz, vec3(0.0)));
+		if(dot(u_clipPlanes[i].xyz, corner) + u_clipPlanes[i].w < 0.0)
+			return false;
+	}
+	return true;
+}
+
+// *** Entry point ***
+void main()
+{
+	int cellIndex;
+	float luminance = 0.0;
+	if(u_level == 0)
+		cellIndex = int(sortedVoxels[gl_VertexID]);
+	else {
+		uvec2 entry = levelCells[gl_VertexID];
+		cellIndex = int(entry.x);
+		luminance = float(entry.y) / 255.0;
+	}
+	ivec3 cell;
+	cell.z = cellIndex / (u_levelSize.x * u_levelSize.y);
+	cell.y = (cellIndex % (u_levelSize.x * u_levelSize.y)) / u_levelSize.x;
+	cell.x = (cellIndex % (u_levelSize.x * u_levelSize.y)) % u_levelSize.x;
+
+	// Cells at the upper border may cover less voxels. Cells are cropped to
+	// the region of interest.
+	ivec3 firstVoxel = cell * int(u_cellSize);
+	ivec3 lo = max(firstVoxel, u_roiMin);
+	ivec3 hi = min(min(firstVoxel + int(u_cellSize), u_volumeSize), u_roiMax);
+	if(any(greaterThanEqual(lo, hi)) || !isInsideClipPlanes(lo, hi))
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+	out_boxMin = vec3(lo) - 0.5;
+	out_boxMax = vec3(hi) - 0.5;
+
+	if(u_level == 0)
+	{
+		// Voxels of bricks which are not loaded yet are skipped.
+		uvec4 page = texelFetch(tex_pageTable, firstVoxel / BRICK_SIZE, 0);
+		if( page.w == 0u )
+		{
+			gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+			return;
+		}
+		out_color = fetchVoxelColor(page, firstVoxel);
+	} else out_color = vec4(luminance);
+	out_ambientOcclusion = texelFetch(tex_ambientOcclusion, ivec3(0.5 * (out_boxMin + out_boxMax) + 0.5), 0).r;
+
+	// The sprite covers the projected bounding rectangle of the box. Cells
+	// which reach behind the camera are dropped.
+	vec2 rectMin = vec2(1e30);
+	vec2 rectMax = vec2(-1e30);
+	for(int i = 0; i < 8; ++i)
+	{
+		vec3 corner = mix(out_boxMin, out_boxMax, vec3(i & 1, (i >> 1) & 1, i >> 2));
+		vec4 p = u_viewProjection * vec4(corner, 1.0);
+		if(p.w <= 0.0)
+		{
+			gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+			return;
+		}
+		rectMin = min(rectMin, p.xy / p.w);
+		rectMax = max(rectMax, p.xy / p.w);
+	}
+	vec2 pixels = (rectMax - rectMin) * 0.5 * u_viewportSize;
+	gl_PointSize = max(pixels.x, pixels.y) + 1.0;
+	// The depth is written by the fragment shader.
+	gl_Position = vec4(0.5 * (rectMin + rectMax), 0.0, 1.0);
+}
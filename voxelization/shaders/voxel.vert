@@ -1,6 +1,12 @@
 #version 440 core
 
+// *** In and Outputs ***
+// The voxel renderer draws one point per voxel. Unlike gl_PrimitiveIDIn the
+// vertex id includes the first vertex of a (multi) draw.
+layout(location = 0) out int out_voxelIndex;
+
 // *** Entry point ***
 void main()
 {
+	out_voxelIndex = gl_VertexID;
 }
@@ -0,0 +1,42 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) out int out_voxelIndex;
+layout(location = 1) out int out_view;
+
+// *** Buffers and Uniforms ***
+// Voxel indices sorted by luminance (see SortedVoxelIndex).
+layout(binding = 1, std430) readonly buffer ssbo_sortedVoxels
+{
+	uint sortedVoxels[];
+};
+
+#include "include/transform.glsl"
+#include "include/views.glsl"
+
+// *** Entry point ***
+// Each instance renders the voxels into one view (see MultiViewRenderer).
+// View 0 reads the sorted voxels (or the voxel index directly for cropped
+// regions), the slices enumerate their slab and the
+// threshold is left to the occupancy test in voxel_multiview.geom.
+void main()
+{
+	out_view = u_firstView + gl_InstanceID;
+	if(out_view == 0)
+	{
+		out_voxelIndex = u_directIndices != 0 ? gl_VertexID : int(sortedVoxels[gl_VertexID]);
+		return;
+	}
+
+	View view = u_views[out_view];
+	ivec3 extent = view.slabMax.xyz - view.slabMin.xyz;
+	if(gl_VertexID >= extent.x * extent.y * extent.z)
+	{
+		// Beyond the slab of this view (the draw covers the largest slab)
+		out_view = -1;
+		return;
+	}
+	ivec3 c = view.slabMin.xyz + ivec3(gl_VertexID % extent.x,
+		(gl_VertexID / extent.x) % extent.y, gl_VertexID / (extent.x * extent.y));
+	out_voxelIndex = c.x + u_volumeSize.x * (c.y + u_volumeSize.y * c.z);
+}
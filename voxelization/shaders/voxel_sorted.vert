@@ -0,0 +1,18 @@
+#version 440 core
+
+// *** In and Outputs ***
+layout(location = 0) out int out_voxelIndex;
+
+// *** Buffers and Uniforms ***
+// Voxel indices sorted by luminance (see SortedVoxelIndex). The draw covers
+// the suffix of voxels which pass the threshold.
+layout(binding = 1, std430) readonly buffer ssbo_sortedVoxels
+{
+	uint sortedVoxels[];
+};
+
+// *** Entry point ***
+void main()
+{
+	out_voxelIndex = int(sortedVoxels[gl_VertexID]);
+}
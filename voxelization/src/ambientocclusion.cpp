@@ -0,0 +1,167 @@
+#include "ambientocclusion.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace gpupro;
+using namespace glm;
+
+// Van der Corput sequence for the second Hammersley dimension.
+static float radicalInverse(unsigned _i)
+{
+	_i = (_i << 16u) | (_i >> 16u);
+	_i = ((_i & 0x55555555u) << 1u) | ((_i & 0xAAAAAAAAu) >> 1u);
+	_i = ((_i & 0x33333333u) << 2u) | ((_i & 0xCCCCCCCCu) >> 2u);
+	_i = ((_i & 0x0F0F0F0Fu) << 4u) | ((_i & 0xF0F0F0F0u) >> 4u);
+	_i = ((_i & 0x00FF00FFu) << 8u) | ((_i & 0xFF00FF00u) >> 8u);
+	return float(_i) * 2.3283064365386963e-10f;
+}
+
+AmbientOcclusionVolume::AmbientOcclusionVolume(const Volume& _volume, const BrickPyramid& _pyramid, const OccupancyMask& _occupancy) :
+	m_volume(_volume),
+	m_pyramid(_pyramid),
+	m_occupancy(_occupancy),
+	m_visibility(_volume.numVoxels(), 0),
+	m_texture(Texture::Layout::TEX_3D, _volume.size().x, _volume.size().y, _volume.size().z, InternalFormat::R8, 1),
+	m_threshold(-1)
+{
+	// Cosine weighted Hammersley points on the hemisphere
+	for(int i = 0; i < NUM_DIRECTIONS; ++i)
+	{
+		float u = (i + 0.5f) / NUM_DIRECTIONS;
+		float phi = 2.0f * pi<float>() * radicalInverse(i);
+		float r = sqrt(u);
+		m_directions.push_back(vec3(r * cos(phi), r * sin(phi), sqrt(1.0f - u)));
+	}
+}
+
+void AmbientOcclusionVolume::computeBrick(const ivec3& _brick, int _threshold)
+{
+	ivec3 lo, hi;
+	m_pyramid.nodeBounds(0, _brick, lo, hi);
+	const u8vec2& minMax = m_pyramid.minMax(0, _brick);
+	bool empty = minMax.y < _threshold;
+
+	for(int z = lo.z; z < hi.z; ++z)
+		for(int y = lo.y; y < hi.y; ++y)
+			for(int x = lo.x; x < hi.x; ++x)
+			{
+				uint8_t& visibility = m_visibility[m_volume.index(x, y, z)];
+				visibility = 0;
+				ivec3 voxel(x, y, z);
+				if(empty || !isOccupied(voxel))
+					continue;
+
+				// The normal points towards the empty neighbors. Voxels without
+				// an empty face neighbor are invisible and can be skipped.
+				vec3 normal(0.0f);
+				bool exposed = false;
+				for(int dz = -1; dz <= 1; ++dz)
+					for(int dy = -1; dy <= 1; ++dy)
+						for(int dx = -1; dx <= 1; ++dx)
+						{
+							ivec3 offset(dx, dy, dz);
+							if(offset == ivec3(0) || isOccupied(voxel + offset))
+								continue;
+							normal += vec3(offset);
+							if(abs(dx) + abs(dy) + abs(dz) == 1)
+								exposed = true;
+						}
+				if(!exposed)
+					continue;
+				float len = length(normal);
+				normal = len > 1e-3f ? normal / len : vec3(0.0f, 1.0f, 0.0f);
+
+				vec3 tangent = normalize(cross(abs(normal.x) > 0.9f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f), normal));
+				vec3 bitangent = cross(normal, tangent);
+				int numVisible = 0;
+				for(const vec3& d : m_directions)
+				{
+					vec3 dir = d.x * tangent + d.y * bitangent + d.z * normal;
+					bool occluded = false;
+					for(int s = 1; s <= RADIUS && !occluded; ++s)
+					{
+						ivec3 sample = ivec3(floor(vec3(voxel) + dir * float(s) + 0.5f));
+						if(sample != voxel)
+							occluded = isOccupied(sample);
+					}
+					if(!occluded) ++numVisible;
+				}
+				visibility = uint8_t((numVisible * 255 + NUM_DIRECTIONS / 2) / NUM_DIRECTIONS);
+			}
+}
+
+void AmbientOcclusionVolume::update()
+{
+	int threshold = m_occupancy.threshold();
+	if(threshold == m_threshold)
+		return;
+
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	// Find bricks with voxels which switched occupancy: luminance in [lo, hi).
+	const ivec3& numBricks = m_pyramid.levelSize(0);
+	int lo = m_threshold < 0 ? 0 : min(threshold, m_threshold);
+	int hi = m_threshold < 0 ? 256 : max(threshold, m_threshold);
+	std::vector<char> changed(size_t(numBricks.x) * numBricks.y * numBricks.z, 0);
+	for(int z = 0; z < numBricks.z; ++z)
+		for(int y = 0; y < numBricks.y; ++y)
+			for(int x = 0; x < numBricks.x; ++x)
+			{
+				const u8vec2& minMax = m_pyramid.minMax(0, ivec3(x, y, z));
+				changed[x + size_t(numBricks.x) * (y + size_t(numBricks.y) * z)] = minMax.x < hi && minMax.y >= lo;
+			}
+
+	// A voxel depends on all voxels within the sample radius (+1 for the normal).
+	const int dilation = (RADIUS + 1 + BrickPyramid::BRICK_SIZE - 1) / BrickPyramid::BRICK_SIZE;
+	std::vector<ivec3> dirty;
+	ivec3 dirtyMin(numBricks), dirtyMax(-1);
+	for(int z = 0; z < numBricks.z; ++z)
+		for(int y = 0; y < numBricks.y; ++y)
+			for(int x = 0; x < numBricks.x; ++x)
+			{
+				ivec3 brick(x, y, z);
+				ivec3 nlo = max(brick - dilation, ivec3(0));
+				ivec3 nhi = min(brick + dilation, numBricks - 1);
+				bool isDirty = false;
+				for(int nz = nlo.z; nz <= nhi.z && !isDirty; ++nz)
+					for(int ny = nlo.y; ny <= nhi.y && !isDirty; ++ny)
+						for(int nx = nlo.x; nx <= nhi.x && !isDirty; ++nx)
+							isDirty = changed[nx + size_t(numBricks.x) * (ny + size_t(numBricks.y) * nz)] != 0;
+				if(isDirty)
+				{
+					dirty.push_back(brick);
+					dirtyMin = min(dirtyMin, brick);
+					dirtyMax = max(dirtyMax, brick);
+				}
+			}
+	m_threshold = threshold;
+	if(dirty.empty())
+		return;
+
+	parallelFor(0, int(dirty.size()), [&](int i) {
+		computeBrick(dirty[i], threshold);
+	});
+
+	// Upload the bounding box of all recomputed bricks directly from the
+	// CPU copy.
+	ivec3 boxMin, boxMax, dummy;
+	m_pyramid.nodeBounds(0, dirtyMin, boxMin, dummy);
+	m_pyramid.nodeBounds(0, dirtyMax, dummy, boxMax);
+	ivec3 boxSize = boxMax - boxMin;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, m_volume.size().x);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, m_volume.size().y);
+	m_texture.setData(0, boxMin.x, boxMin.y, boxMin.z, boxSize.x, boxSize.y, boxSize.z, SetDataFormat::R, SetDataType::UINT8,
+		&m_visibility[m_volume.index(boxMin.x, boxMin.y, boxMin.z)]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "\nINF: Updated ambient occlusion of " << dirty.size() << " bricks in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include "volume.hpp"
+#include "occupancy.hpp"
+
+// Per voxel ambient occlusion of the OccupancyMask.
+// For each exposed voxel a cosine weighted hemisphere around the occupancy
+// normal is sampled with NUM_DIRECTIONS rays of at most RADIUS voxels.
+// The visible fraction is kept on CPU and in a R8 3D texture for the shader.
+// When the threshold changes only the bricks whose neighborhood contains
+// voxels which switched occupancy are recomputed and uploaded.
+class AmbientOcclusionVolume
+{
+public:
+	static const int RADIUS = 8;
+	static const int NUM_DIRECTIONS = 16;
+
+	// The volume, pyramid and mask must outlive this object.
+	AmbientOcclusionVolume(const Volume& _volume, const BrickPyramid& _pyramid, const OccupancyMask& _occupancy);
+
+	// Recompute all bricks which are affected by the change of the mask's
+	// threshold since the last call. Call after OccupancyMask::update().
+	void update();
+
+	void bindAsTexture(GLuint _bindingIndex) { m_texture.bindAsTexture(_bindingIndex); }
+	gpupro::Texture& texture() { return m_texture; }
+private:
+	const Volume& m_volume;
+	const BrickPyramid& m_pyramid;
+	const OccupancyMask& m_occupancy;
+	std::vector<glm::vec3> m_directions;	///< Hemisphere around +z
+	std::vector<uint8_t> m_visibility;
+	gpupro::Texture m_texture;
+	int m_threshold;						///< Quantized threshold of the current data, -1 if nothing was computed
+
+	void computeBrick(const glm::ivec3& _brick, int _threshold);
+	bool isOccupied(const glm::ivec3& _voxel) const { return m_occupancy.isOccupied(_voxel.x, _voxel.y, _voxel.z); }
+};
@@ -0,0 +1,273 @@
+#include "brickatlas.hpp"
+
+#include <gli/gli.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+using namespace gpupro;
+using namespace glm;
+
+static const int BRICK_SIZE = BrickPyramid::BRICK_SIZE;
+
+// Choose an atlas layout with at most _numSlots slots and at most
+// _maxPerAxis slots in each direction.
+static ivec3 atlasLayout(int _numSlots, int _maxPerAxis)
+{
+	ivec3 slots;
+	slots.x = clamp(int(std::cbrt(double(_numSlots))), 1, _maxPerAxis);
+	slots.y = clamp(int(std::sqrt(double(_numSlots / slots.x))), 1, _maxPerAxis);
+	slots.z = clamp(_numSlots / (slots.x * slots.y), 1, _maxPerAxis);
+	return slots;
+}
+
+static ivec3 computeSlotsPerAxis(const gli::texture3d& _texture, const BrickPyramid& _pyramid, size_t _budget)
+{
+	const ivec3& numBricks = _pyramid.levelSize(0);
+	size_t brickBytes = size_t(BRICK_SIZE * BRICK_SIZE * BRICK_SIZE) * gli::block_size(_texture.format());
+	size_t numSlots = std::min(_budget / brickBytes, size_t(numBricks.x) * numBricks.y * numBricks.z);
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+	// Slot coordinates are stored as bytes in the page table.
+	return atlasLayout(int(std::min(numSlots, size_t(INT_MAX))), std::min(maxTextureSize / BRICK_SIZE, 256));
+}
+
+BrickAtlas::BrickAtlas(const gli::texture3d& _texture, const BrickPyramid& _pyramid, size_t _budget) :
+	m_texture(_texture),
+	m_pyramid(_pyramid),
+	m_volumeSize(_texture.extent(0)),
+	m_numBricks(_pyramid.levelSize(0)),
+	m_slotsPerAxis(computeSlotsPerAxis(_texture, _pyramid, _budget)),
+	m_bytesPerVoxel(gli::block_size(_texture.format())),
+	m_atlas(Texture::Layout::TEX_3D, m_slotsPerAxis.x * BRICK_SIZE, m_slotsPerAxis.y * BRICK_SIZE, m_slotsPerAxis.z * BRICK_SIZE,
+		static_cast<InternalFormat>(gli::gl(gli::gl::PROFILE_GL33).translate(_texture.format(), _texture.swizzles()).Internal), 1),
+	m_pageTable(Texture::Layout::TEX_3D, m_numBricks.x, m_numBricks.y, m_numBricks.z, InternalFormat::RGBA8UI, 1),
+	m_pageTableData(size_t(m_numBricks.x) * m_numBricks.y * m_numBricks.z, u8vec4(0)),
+	m_brickSlot(m_pageTableData.size(), -1),
+	m_slotBrick(m_slotsPerAxis.x * m_slotsPerAxis.y * m_slotsPerAxis.z, -1),
+	m_lruPosition(m_slotBrick.size()),
+	m_slotFrame(m_slotBrick.size(), 0),
+	m_frame(0),
+	m_numResident(0),
+	m_staging(MAX_UPLOADS_PER_FRAME * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE * GLsizeiptr(m_bytesPerVoxel), 3)
+{
+	auto format = gli::gl(gli::gl::PROFILE_GL33).translate(_texture.format(), _texture.swizzles());
+	m_dataFormat = SetDataFormat(format.External);
+	m_dataType = SetDataType(format.Type);
+
+	// Nothing is resident at the beginning
+	m_pageTable.setData(0, 0, SetDataFormat::RGBA_INTEGER, SetDataType::UINT8, m_pageTableData.data());
+
+	std::cerr << "INF: Brick atlas with " << numSlots() << " of " << m_pageTableData.size() << " bricks ("
+		<< memoryUsage() / (1024 * 1024) << " MB vs. "
+		<< size_t(m_volumeSize.x) * m_volumeSize.y * m_volumeSize.z * m_bytesPerVoxel / (1024 * 1024) << " MB dense colors)\n";
+}
+
+Shader::Defines BrickAtlas::formatDefines(const gli::texture3d& _texture)
+{
+	Shader::Defines defines;
+	defines["VOXEL_CHANNELS"] = std::to_string(gli::component_count(_texture.format()));
+	int channelBits = Volume::integerChannelBits(_texture);
+	if(channelBits > 0)
+	{
+		defines["VOXEL_INTEGER"] = "1";
+		defines["VOXEL_MAX"] = std::to_string((1ull << channelBits) - 1) + ".0";
+	} else defines["VOXEL_INTEGER"] = "0";
+	return defines;
+}
+
+size_t BrickAtlas::memoryUsage() const
+{
+	return m_slotBrick.size() * BRICK_SIZE * BRICK_SIZE * BRICK_SIZE * m_bytesPerVoxel
+		+ m_pageTableData.size() * sizeof(u8vec4);
+}
+
+void BrickAtlas::bindAsTexture(GLuint _atlasBinding, GLuint _pageTableBinding)
+{
+	m_atlas.bindAsTexture(_atlasBinding);
+	m_pageTable.bindAsTexture(_pageTableBinding);
+}
+
+void BrickAtlas::upload(int _brick, int _slot)
+{
+	ivec3 brick(_brick % m_numBricks.x, (_brick / m_numBricks.x) % m_numBricks.y, _brick / (m_numBricks.x * m_numBricks.y));
+	ivec3 slot(_slot % m_slotsPerAxis.x, (_slot / m_slotsPerAxis.x) % m_slotsPerAxis.y, _slot / (m_slotsPerAxis.x * m_slotsPerAxis.y));
+	ivec3 lo, hi;
+	m_pyramid.nodeBounds(0, brick, lo, hi);
+	// The last brick of each dimension may be smaller.
+	ivec3 size = hi - lo;
+	const uint8_t* source = static_cast<const uint8_t*>(m_texture.data());
+	ivec3 volumeSize = m_volumeSize;
+	size_t bytesPerVoxel = m_bytesPerVoxel;
+	m_staging.upload(m_atlas, 0, slot.x * BRICK_SIZE, slot.y * BRICK_SIZE, slot.z * BRICK_SIZE, size.x, size.y, size.z,
+		m_dataFormat, m_dataType, GLsizeiptr(size.x) * size.y * size.z * bytesPerVoxel,
+		[=](void* _destination) {
+			// Gather the rows of the brick
+			uint8_t* destination = static_cast<uint8_t*>(_destination);
+			size_t rowBytes = size.x * bytesPerVoxel;
+			for(int z = lo.z; z < hi.z; ++z)
+				for(int y = lo.y; y < hi.y; ++y)
+				{
+					memcpy(destination, source + (lo.x + size_t(volumeSize.x) * (y + size_t(volumeSize.y) * z)) * bytesPerVoxel, rowBytes);
+					destination += rowBytes;
+				}
+		},
+		[this, _brick, _slot, slot]() {
+			// The slot could have been evicted in the meantime
+			if(m_brickSlot[_brick] != _slot)
+				return;
+			m_pageTableData[_brick] = u8vec4(slot, 1);
+			markDirty(_brick);
+		});
+}
+
+void BrickAtlas::markDirty(int _brick)
+{
+	ivec3 b(_brick % m_numBricks.x, (_brick / m_numBricks.x) % m_numBricks.y, _brick / (m_numBricks.x * m_numBricks.y));
+	m_dirtyMin = min(m_dirtyMin, b);
+	m_dirtyMax = max(m_dirtyMax, b);
+}
+
+void BrickAtlas::update(const mat4& _viewProjection, const vec3& _cameraPosition, int _threshold,
+	const RegionOfInterest& _roi)
+{
+	++m_frame;
+
+	// Frustum planes (inside is dot(plane, p) >= 0)
+	vec4 planes[6];
+	vec4 rows[4];
+	for(int i = 0; i < 4; ++i)
+		rows[i] = vec4(_viewProjection[0][i], _viewProjection[1][i], _viewProjection[2][i], _viewProjection[3][i]);
+	for(int i = 0; i < 3; ++i)
+	{
+		planes[i * 2] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+
+	// Collect the visible non-empty bricks. The pyramid is descended from
+	// the root, so empty, cropped and invisible regions are culled as a
+	// whole and only the bricks of visible nodes are tested.
+	std::vector<std::pair<float, int>> requests;
+	std::vector<std::pair<int, ivec3>> stack;
+	const int rootLevel = m_pyramid.numLevels() - 1;
+	const ivec3& rootSize = m_pyramid.levelSize(rootLevel);
+	for(int z = 0; z < rootSize.z; ++z)
+		for(int y = 0; y < rootSize.y; ++y)
+			for(int x = 0; x < rootSize.x; ++x)
+				stack.push_back(std::make_pair(rootLevel, ivec3(x, y, z)));
+	while(!stack.empty())
+	{
+		int level = stack.back().first;
+		ivec3 node = stack.back().second;
+		stack.pop_back();
+		if(m_pyramid.minMax(level, node).y < _threshold)
+			continue;
+		ivec3 lo, hi;
+		m_pyramid.nodeBounds(level, node, lo, hi);
+		if(!_roi.intersects(lo, hi))
+			continue;
+		vec3 boxMin = vec3(lo) - 0.5f;
+		vec3 boxMax = vec3(hi) - 0.5f;
+		bool inside = true;
+		for(int p = 0; p < 6 && inside; ++p)
+		{
+			// Test the corner which is furthest in direction of the normal
+			vec3 corner = mix(boxMin, boxMax, greaterThanEqual(vec3(planes[p]), vec3(0.0f)));
+			inside = dot(vec3(planes[p]), corner) + planes[p].w >= 0.0f;
+		}
+		if(!inside)
+			continue;
+
+		if(level == 0)
+		{
+			float dist = length((boxMin + boxMax) * 0.5f - _cameraPosition);
+			requests.push_back(std::make_pair(dist, node.x + m_numBricks.x * (node.y + m_numBricks.y * node.z)));
+			continue;
+		}
+		// The last node of a dimension also covers the rest of the finer level.
+		const ivec3& childSize = m_pyramid.levelSize(level - 1);
+		ivec3 childLo = node * 2;
+		ivec3 childHi = min(childLo + 2, childSize);
+		for(int i = 0; i < 3; ++i)
+			if(node[i] == m_pyramid.levelSize(level)[i] - 1) childHi[i] = childSize[i];
+		for(int cz = childLo.z; cz < childHi.z; ++cz)
+			for(int cy = childLo.y; cy < childHi.y; ++cy)
+				for(int cx = childLo.x; cx < childHi.x; ++cx)
+					stack.push_back(std::make_pair(level - 1, ivec3(cx, cy, cz)));
+	}
+	// More requests than slots would evict the bricks of the same frame.
+	if(requests.size() > m_slotBrick.size())
+	{
+		std::nth_element(requests.begin(), requests.begin() + m_slotBrick.size(), requests.end());
+		requests.resize(m_slotBrick.size());
+	}
+	std::sort(requests.begin(), requests.end());
+
+	// Touch resident bricks first, so they cannot be evicted by the loads.
+	for(const auto& request : requests)
+	{
+		int slot = m_brickSlot[request.second];
+		if(slot >= 0)
+		{
+			m_lru.splice(m_lru.begin(), m_lru, m_lruPosition[slot]);
+			m_slotFrame[slot] = m_frame;
+		}
+	}
+
+	int numUploads = 0;
+	const GLsizeiptr brickBytes = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE * GLsizeiptr(m_bytesPerVoxel);
+	m_dirtyMin = m_numBricks;
+	m_dirtyMax = ivec3(-1);
+	for(const auto& request : requests)
+	{
+		int brick = request.second;
+		if(m_brickSlot[brick] >= 0)
+			continue;
+		// Without free staging memory the remaining bricks are loaded
+		// in later frames.
+		if(numUploads == MAX_UPLOADS_PER_FRAME || !m_staging.hasSpace(brickBytes))
+			break;
+
+		int slot;
+		if(m_numResident < numSlots())
+		{
+			slot = m_numResident++;
+			m_lru.push_front(slot);
+		} else {
+			slot = m_lru.back();
+			if(m_slotFrame[slot] == m_frame)
+				break;
+			int evicted = m_slotBrick[slot];
+			m_brickSlot[evicted] = -1;
+			m_pageTableData[evicted] = u8vec4(0);
+			markDirty(evicted);
+			m_lru.splice(m_lru.begin(), m_lru, m_lruPosition[slot]);
+		}
+		m_lruPosition[slot] = m_lru.begin();
+		m_slotFrame[slot] = m_frame;
+		m_slotBrick[slot] = brick;
+		m_brickSlot[brick] = slot;
+		upload(brick, slot);
+		++numUploads;
+	}
+
+	// Copy the bricks which the workers finished, this marks them resident
+	m_staging.update();
+
+	// Upload the changed part of the page table
+	if(m_dirtyMax.x >= 0)
+	{
+		ivec3 dirtyMin = m_dirtyMin;
+		ivec3 size = m_dirtyMax - dirtyMin + 1;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, m_numBricks.x);
+		glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, m_numBricks.y);
+		m_pageTable.setData(0, dirtyMin.x, dirtyMin.y, dirtyMin.z, size.x, size.y, size.z, SetDataFormat::RGBA_INTEGER, SetDataType::UINT8,
+			&m_pageTableData[dirtyMin.x + size_t(m_numBricks.x) * (dirtyMin.y + size_t(m_numBricks.y) * dirtyMin.z)]);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/mat4x4.hpp>
+#include <list>
+#include "volume.hpp"
+#include "roi.hpp"
+
+// Virtual texture for the voxel colors. Bricks of BrickPyramid::BRICK_SIZE^3
+// voxels are streamed on demand into slots of a fixed size 3D atlas. The
+// page table (RGBA8UI, one texel per brick) contains the slot coordinates in
+// xyz and 1 in w for resident bricks, 0 otherwise.
+// The GPU memory of the colors only depends on the budget, the CPU keeps
+// the loaded texture. The budget does not cover the textures which are
+// derived from the luminance (projection, ambient occlusion, shadows and
+// occupancy), they are dense at full resolution.
+// Bricks are copied into staging buffers by worker threads and become
+// resident (page table entry set) in the frame the texture copy is issued.
+class BrickAtlas
+{
+public:
+	// Maximum number of bricks uploaded in a single update().
+	static const int MAX_UPLOADS_PER_FRAME = 256;
+
+	// The texture and the pyramid must outlive this object.
+	// _budget: memory of the atlas in bytes. It is also limited by
+	//		GL_MAX_3D_TEXTURE_SIZE.
+	BrickAtlas(const gli::texture3d& _texture, const BrickPyramid& _pyramid, size_t _budget);
+
+	// Defines which specialize the programs that fetch from the atlas for
+	// the format of the texture, see shaders/include/voxelatlas.glsl.
+	// Throws for signed and packed integer formats.
+	static gpupro::Shader::Defines formatDefines(const gli::texture3d& _texture);
+
+	// Request all bricks which are inside the view frustum and the region of
+	// interest and contain voxels with luminance >= _threshold (quantized).
+	// The closest bricks are loaded first. If the atlas is full the least
+	// recently used bricks are evicted.
+	void update(const glm::mat4& _viewProjection, const glm::vec3& _cameraPosition, int _threshold,
+		const RegionOfInterest& _roi);
+
+	int numSlots() const { return int(m_slotBrick.size()); }
+	int numResident() const { return m_numResident; }
+	// Bricks which have a slot but are not uploaded yet
+	int numLoading() const { return int(m_staging.numPending()); }
+	// Bytes of the atlas and the page table on GPU.
+	size_t memoryUsage() const;
+
+	void bindAsTexture(GLuint _atlasBinding, GLuint _pageTableBinding);
+	// For ResourceBindings of a RenderQueue
+	gpupro::Texture& atlasTexture() { return m_atlas; }
+	gpupro::Texture& pageTableTexture() { return m_pageTable; }
+private:
+	const gli::texture3d& m_texture;
+	const BrickPyramid& m_pyramid;
+	glm::ivec3 m_volumeSize;
+	glm::ivec3 m_numBricks;
+	glm::ivec3 m_slotsPerAxis;
+	size_t m_bytesPerVoxel;
+	gpupro::SetDataFormat m_dataFormat;
+	gpupro::SetDataType m_dataType;
+	gpupro::Texture m_atlas;
+	gpupro::Texture m_pageTable;
+	std::vector<glm::u8vec4> m_pageTableData;
+	std::vector<int> m_brickSlot;		///< Slot of each brick or -1
+	std::vector<int> m_slotBrick;		///< Brick index of each slot or -1
+	std::list<int> m_lru;				///< Resident slots, most recently used first
+	std::vector<std::list<int>::iterator> m_lruPosition;
+	std::vector<uint64_t> m_slotFrame;	///< Frame in which a slot was used last
+	uint64_t m_frame;
+	int m_numResident;
+	glm::ivec3 m_dirtyMin, m_dirtyMax;	///< Changed bricks of the page table
+	// Last member: the worker threads read m_texture until it is destroyed
+	gpupro::StagingRing m_staging;
+
+	void upload(int _brick, int _slot);
+	void markDirty(int _brick);
+};
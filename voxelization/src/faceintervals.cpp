@@ -0,0 +1,92 @@
+#include "faceintervals.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace gpupro;
+using namespace glm;
+
+// Call _func(voxelIndex, face, lo, hi) for all potentially visible faces of
+// the slice _z in the order x, y, face. The faces are numbered like Face
+// in occupancy.hpp.
+template<typename Func>
+static void forEachFace(const Volume& _volume, int _z, Func _func)
+{
+	const ivec3& size = _volume.size();
+	const ivec3 dir[6] = {ivec3(1,0,0), ivec3(-1,0,0), ivec3(0,1,0), ivec3(0,-1,0), ivec3(0,0,1), ivec3(0,0,-1)};
+	for(int y = 0; y < size.y; ++y)
+		for(int x = 0; x < size.x; ++x)
+		{
+			int lum = _volume.at(x, y, _z);
+			for(int f = 0; f < 6; ++f)
+			{
+				ivec3 n = ivec3(x, y, _z) + dir[f];
+				int neighbor = (any(lessThan(n, ivec3(0))) || any(greaterThanEqual(n, size)))
+					? -1 : _volume.at(n.x, n.y, n.z);
+				if(lum > neighbor)
+					_func(uint32_t(_volume.index(x, y, _z)), uint32_t(f), uint32_t(neighbor + 1), uint32_t(lum + 1));
+			}
+		}
+}
+
+FaceIntervalCache::FaceIntervalCache(const Volume& _volume)
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+	const int numSlices = _volume.size().z;
+
+	// Count the faces of each slice per lo, the prefix over (lo, slice) gives
+	// every slice a private output range like in the SortedVoxelIndex.
+	std::vector<size_t> histograms(size_t(numSlices) * 257, 0);
+	parallelFor(0, numSlices, [&](int z) {
+		size_t* histogram = &histograms[size_t(z) * 257];
+		forEachFace(_volume, z, [&](uint32_t, uint32_t, uint32_t _lo, uint32_t) { ++histogram[_lo]; });
+	});
+
+	m_offsets.assign(258, 0);
+	size_t sum = 0;
+	for(int lo = 0; lo < 257; ++lo)
+	{
+		m_offsets[lo] = sum;
+		for(int z = 0; z < numSlices; ++z)
+		{
+			size_t count = histograms[size_t(z) * 257 + lo];
+			histograms[size_t(z) * 257 + lo] = sum;
+			sum += count;
+		}
+	}
+	m_offsets[257] = sum;
+	if(sum > MAX_FACES)
+	{
+		std::cerr << "ERR: The volume has " << sum << " potentially visible faces, the face cache supports at most "
+			<< MAX_FACES << ".\n";
+		return;
+	}
+
+	std::vector<uvec2> faces(sum);
+	parallelFor(0, numSlices, [&](int z) {
+		size_t* position = &histograms[size_t(z) * 257];
+		forEachFace(_volume, z, [&](uint32_t _index, uint32_t _face, uint32_t _lo, uint32_t _hi) {
+			faces[position[_lo]++] = uvec2(_index, _face | (_lo << 3) | (_hi << 12));
+		});
+	});
+	m_buffer.reset(new Buffer(Buffer::Type::SHADER_STORAGE, sizeof(uvec2), GLuint(sum), Buffer::Usage(), faces.data()));
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "INF: Built face interval cache with " << sum << " faces (" << memoryUsage() / (1024 * 1024) << " MB) in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+}
+
+void FaceIntervalCache::draw(int _threshold) const
+{
+	size_t count = isValid() ? numCandidateFaces(_threshold) : 0;
+	if(count > 0)
+		glDrawArrays(GL_TRIANGLES, 0, GLsizei(count * 6));
+}
+
+void FaceIntervalCache::bindAsShaderStorageBuffer(GLuint _bindingIndex) const
+{
+	if(isValid())
+		m_buffer->bindAsShaderStorageBuffer(_bindingIndex);
+}
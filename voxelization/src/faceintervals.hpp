@@ -0,0 +1,45 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <memory>
+#include <algorithm>
+#include "volume.hpp"
+
+// Static geometry of all faces which are visible for any threshold.
+// The face of voxel v towards its neighbor n is exposed iff v is occupied and
+// n is not: lum(n) < q <= lum(v) for the quantized threshold q. So each pair
+// of voxels has at most one potentially visible face, tagged with the interval
+// [lo, hi) = [lum(n) + 1, lum(v) + 1) of thresholds in which it is exposed.
+// Neighbors outside the volume count as never occupied (lo = 0).
+// faces.vert culls the faces outside the interval, so threshold changes need
+// no rebuild. Faces are sorted by lo, the faces with lo <= q are a prefix.
+//
+// Each face is a uvec2 in a shader storage buffer:
+//	x: voxel index
+//	y: bits 0-2 Face, bits 3-11 lo, bits 12-20 hi
+class FaceIntervalCache
+{
+public:
+	// Faces are drawn as two triangles by glDrawArrays, so the vertex count
+	// must fit into a GLsizei.
+	static const size_t MAX_FACES = 0x7fffffff / 6;
+
+	FaceIntervalCache(const Volume& _volume);
+
+	// False if the volume has more than MAX_FACES potentially visible faces.
+	bool isValid() const { return m_buffer != nullptr; }
+	size_t numFaces() const { return m_offsets.back(); }
+	// Number of faces with lo <= _threshold. Only these must be drawn.
+	size_t numCandidateFaces(int _threshold) const { return m_offsets[std::min(std::max(_threshold, 0), 256) + 1]; }
+
+	// Draw the candidate faces of the threshold with faces.vert.
+	void draw(int _threshold) const;
+
+	size_t memoryUsage() const { return isValid() ? numFaces() * sizeof(glm::uvec2) : 0; }
+	void bindAsShaderStorageBuffer(GLuint _bindingIndex) const;
+	// nullptr if not valid
+	gpupro::Buffer* buffer() const { return m_buffer.get(); }
+private:
+	std::vector<size_t> m_offsets;	///< First face of each lo (258 entries, the last is the number of faces)
+	std::unique_ptr<gpupro::Buffer> m_buffer;
+};
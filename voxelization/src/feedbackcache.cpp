@@ -0,0 +1,125 @@
+#include "feedbackcache.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace gpupro;
+using namespace glm;
+
+// Interleaved output of voxel_capture.geom
+struct CapturedVertex
+{
+	vec3 position;
+	vec3 normal;
+	int voxelIndex;
+};
+
+FeedbackFaceCache::FeedbackFaceCache(const OccupancyMask& _occupancy, ProgramCache& _programs, const Shader::Defines& _atlasFormat) :
+	m_occupancy(_occupancy),
+	m_linearSampler(SamplerState::Filter::LINEAR, SamplerState::Filter::LINEAR, SamplerState::Filter::NONE,
+		1.0f, SamplerState::DepthCompareFunc::DISABLE, SamplerState::BorderHandling::CLAMP),
+	m_vertexFormat({
+		{0, 0, 3, VertexAttribute::Type::FLOAT, GL_FALSE, 0, 0},	// Position
+		{1, 0, 3, VertexAttribute::Type::FLOAT, GL_FALSE, 12, 0},	// Normal
+		{2, 0, 1, VertexAttribute::Type::INT32, GL_FALSE, 24, 0}	// Voxel index
+	}),
+	m_numFaces(0),
+	m_threshold(-1),
+	m_roiVersion(0),
+	m_valid(false)
+{
+	m_captureSortedProgram = _programs.load({
+		{Shader::Type::VERTEX, "shaders/voxel_sorted.vert"},
+		{Shader::Type::GEOMETRY, "shaders/voxel_capture.geom"}
+	}, Program::INTERLEAVED, {"out_position", "out_normal", "out_voxelIndex"});
+	m_captureRangesProgram = _programs.load({
+		{Shader::Type::VERTEX, "shaders/voxel.vert"},
+		{Shader::Type::GEOMETRY, "shaders/voxel_capture.geom"}
+	}, Program::INTERLEAVED, {"out_position", "out_normal", "out_voxelIndex"});
+	m_drawProgram = _programs.load({
+		{Shader::Type::VERTEX, "shaders/captured.vert"},
+		{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+	}, _atlasFormat);
+
+	m_captureSortedPipe.shader = &m_captureSortedProgram;
+	m_captureSortedPipe.rasterizer.discard = true;
+	m_captureRangesPipe.shader = &m_captureRangesProgram;
+	m_captureRangesPipe.rasterizer.discard = true;
+	m_drawPipe.shader = &m_drawProgram;
+	m_drawPipe.vertexFormat = &m_vertexFormat;
+	m_drawPipe.depthStencil.depthTest = true;
+	m_drawPipe.rasterizer.cullMode = RasterizerState::CullMode::BACK;
+	m_drawPipe.samplerState[4] = &m_linearSampler;
+
+	glGenTransformFeedbacks(1, &m_feedback);
+}
+
+FeedbackFaceCache::~FeedbackFaceCache()
+{
+	glDeleteTransformFeedbacks(1, &m_feedback);
+}
+
+void FeedbackFaceCache::update(OGLContext& _context, SortedVoxelIndex& _sortedVoxels, VoxelDrawRanges& _drawRanges,
+	const RegionOfInterest& _roi)
+{
+	int threshold = m_occupancy.threshold();
+	if(threshold == m_threshold && _roi.version() == m_roiVersion)
+		return;
+	m_threshold = threshold;
+	m_roiVersion = _roi.version();
+
+	auto time_start = std::chrono::high_resolution_clock::now();
+	// Cropping only removes faces, so the faces of the entire volume are an
+	// upper bound of the vertices.
+	m_numFaces = m_occupancy.countExposedFaces();
+	size_t numVertices = m_numFaces * 6;
+	if(numVertices * sizeof(CapturedVertex) > MAX_MEMORY)
+	{
+		std::cerr << "\nERR: " << m_numFaces << " faces do not fit into the transform feedback cache.\n";
+		m_valid = false;
+		m_buffer.reset();
+		return;
+	}
+	// Grow with some slack to avoid reallocations for small threshold changes.
+	if(!m_buffer || m_buffer->numElements() < numVertices)
+		m_buffer.reset(new Buffer(Buffer::Type::TRANSFORM_FEEDBACK, sizeof(CapturedVertex),
+			GLuint(std::min(numVertices + numVertices / 4, MAX_MEMORY / sizeof(CapturedVertex))) + 6));
+
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedback);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_buffer->glID());
+	if(_roi.isEntireVolume())
+	{
+		_sortedVoxels.bindAsShaderStorageBuffer(1);
+		_context.setState(m_captureSortedPipe);
+		glBeginTransformFeedback(GL_TRIANGLES);
+		_sortedVoxels.draw(threshold);
+		glEndTransformFeedback();
+	} else {
+		_drawRanges.update(_roi, threshold);
+		_context.setState(m_captureRangesPipe);
+		glBeginTransformFeedback(GL_TRIANGLES);
+		_drawRanges.draw();
+		glEndTransformFeedback();
+	}
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+	m_valid = true;
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "\nINF: Captured up to " << m_numFaces << " faces (" << memoryUsage() / (1024 * 1024) << " MB) in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+}
+
+size_t FeedbackFaceCache::memoryUsage() const
+{
+	return m_buffer ? size_t(m_buffer->numElements()) * sizeof(CapturedVertex) : 0;
+}
+
+void FeedbackFaceCache::draw(OGLContext& _context)
+{
+	if(!m_valid)
+		return;
+	_context.setState(m_drawPipe);
+	m_buffer->bindAsVertexBuffer(0);
+	glDrawTransformFeedback(GL_TRIANGLES, m_feedback);
+}
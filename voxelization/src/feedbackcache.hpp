@@ -0,0 +1,61 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <memory>
+#include "occupancy.hpp"
+#include "sortedindex.hpp"
+#include "roi.hpp"
+
+// Caches the faces of voxel.geom with transform feedback. voxel_capture.geom
+// expands all exposed faces of the drawn voxels once, independent of the
+// view, into a buffer (position, normal, voxel index per vertex). Each frame
+// the buffer is drawn with glDrawTransformFeedback and the rasterizer culls
+// the back faces. A new capture is only necessary if the threshold or the
+// region of interest changes, the colors are fetched while drawing.
+class FeedbackFaceCache
+{
+public:
+	// Captures which would need more memory fall back to voxel.geom.
+	static const size_t MAX_MEMORY = size_t(1024) * 1024 * 1024;
+
+	// The mask must outlive this object.
+	// _atlasFormat: see BrickAtlas::formatDefines()
+	FeedbackFaceCache(const OccupancyMask& _occupancy, gpupro::ProgramCache& _programs, const gpupro::Shader::Defines& _atlasFormat);
+	~FeedbackFaceCache();
+	FeedbackFaceCache(const FeedbackFaceCache&) = delete;
+	FeedbackFaceCache& operator = (const FeedbackFaceCache&) = delete;
+
+	// Capture again if the threshold of the mask or the region changed.
+	// The occupancy texture (5) and the transform UBO (0) must be bound.
+	// The entire volume is drawn from _sortedVoxels, a cropped one from
+	// _drawRanges (which is updated here).
+	void update(gpupro::OGLContext& _context, SortedVoxelIndex& _sortedVoxels, VoxelDrawRanges& _drawRanges,
+		const RegionOfInterest& _roi);
+
+	// False if the last capture did not fit into MAX_MEMORY.
+	bool isValid() const { return m_valid; }
+	// Upper bound of the captured faces (exposed faces of the entire volume).
+	size_t numFaces() const { return m_numFaces; }
+	// Bytes of the feedback buffer.
+	size_t memoryUsage() const;
+
+	// Draw the captured faces. The same textures as for voxel.geom must be
+	// bound.
+	void draw(gpupro::OGLContext& _context);
+private:
+	const OccupancyMask& m_occupancy;
+	gpupro::Program m_captureSortedProgram;	///< voxel_sorted.vert + voxel_capture.geom
+	gpupro::Program m_captureRangesProgram;	///< voxel.vert + voxel_capture.geom
+	gpupro::Program m_drawProgram;			///< captured.vert + shading.frag
+	gpupro::Pipeline m_captureSortedPipe;
+	gpupro::Pipeline m_captureRangesPipe;
+	gpupro::Pipeline m_drawPipe;
+	gpupro::SamplerState m_linearSampler;
+	gpupro::VertexFormat m_vertexFormat;
+	std::unique_ptr<gpupro::Buffer> m_buffer;
+	GLuint m_feedback;						///< Transform feedback object which stores the vertex count
+	size_t m_numFaces;
+	int m_threshold;
+	unsigned m_roiVersion;
+	bool m_valid;
+};
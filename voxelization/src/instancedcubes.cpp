@@ -0,0 +1,80 @@
+#include "instancedcubes.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+
+using namespace gpupro;
+using namespace glm;
+
+// Two triangles for each of the three quads, the corners of a quad are in
+// the triangle strip order of voxel.geom.
+static const uint32_t CUBE_INDICES[18] = {
+	0, 1, 2, 2, 1, 3,
+	4, 5, 6, 6, 5, 7,
+	8, 9, 10, 10, 9, 11
+};
+
+InstancedCubeRenderer::InstancedCubeRenderer() :
+	m_vertexFormat({
+		{0, 0, 1, VertexAttribute::Type::UINT32, GL_FALSE, 0, 1}	// Voxel index per instance
+	}),
+	m_indices(Buffer::Type::INDEX, sizeof(uint32_t), 18, Buffer::Usage(), CUBE_INDICES)
+{
+}
+
+void InstancedCubeRenderer::draw(GLuint _first, GLsizei _count)
+{
+	if(_count <= 0)
+		return;
+	// The index buffer binding is part of the vertex array object.
+	m_indices.bindAsIndexBuffer();
+	glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 18, GL_UNSIGNED_INT, nullptr, _count, _first);
+}
+
+void InstancedCubeRenderer::benchmark(OGLContext& _context, Pipeline& _geometryPipe, Pipeline& _instancedPipe,
+	const Volume& _volume, int _threshold)
+{
+	const int NUM_DRAWS = 10;
+	const ivec3& size = _volume.size();
+	Query timer(Query::Type::TIME_ELAPSED);
+	std::cerr << "\nINF: Geometry shader vs. instanced cubes (GPU time per draw):\n";
+	for(int fraction : {8, 4, 2, 1})
+	{
+		ivec3 boxSize = max(size / fraction, ivec3(1));
+		ivec3 lo = (size - boxSize) / 2;
+		ivec3 hi = lo + boxSize;
+		std::vector<uint32_t> voxels;
+		for(int z = lo.z; z < hi.z; ++z)
+			for(int y = lo.y; y < hi.y; ++y)
+				for(int x = lo.x; x < hi.x; ++x)
+					if(_volume.at(x, y, z) >= _threshold)
+						voxels.push_back(uint32_t(_volume.index(x, y, z)));
+		if(voxels.empty())
+			continue;
+		Buffer list(Buffer::Type::SHADER_STORAGE, sizeof(uint32_t), GLuint(voxels.size()), Buffer::Usage(), voxels.data());
+		list.bindAsShaderStorageBuffer(1);
+
+		double time[2];
+		for(int path = 0; path < 2; ++path)
+		{
+			_context.setState(path == 0 ? _geometryPipe : _instancedPipe);
+			if(path == 1)
+				list.bindAsVertexBuffer(0);
+			double sum = 0.0;
+			for(int i = 0; i < NUM_DRAWS; ++i)
+			{
+				glClear(GL_DEPTH_BUFFER_BIT);
+				timer.begin();
+				if(path == 0) glDrawArrays(GL_POINTS, 0, GLsizei(voxels.size()));
+				else draw(0, GLsizei(voxels.size()));
+				timer.end();
+				timer.receive();
+				sum += timer.latest();
+			}
+			time[path] = sum / NUM_DRAWS;
+		}
+		std::cerr << "     " << boxSize.x << 'x' << boxSize.y << 'x' << boxSize.z << " (" << voxels.size()
+			<< " voxels): geometry shader " << time[0] << " ms, instanced " << time[1] << " ms\n";
+	}
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include "volume.hpp"
+
+// Voxel renderer without a geometry shader. Each voxel is one instance of a
+// fixed index buffer with three quads (12 vertices, 18 indices). cubes.vert
+// gets the voxel index as per instance attribute, picks the three faces
+// towards the camera and collapses faces with an occupied neighbor, which
+// gives the same output as voxel.geom.
+class InstancedCubeRenderer
+{
+public:
+	InstancedCubeRenderer();
+
+	// Voxel index (uint) of each instance at attribute 0 from vertex buffer
+	// binding 0. Must be set in the pipeline of cubes.vert.
+	gpupro::VertexFormat& vertexFormat() { return m_vertexFormat; }
+
+	// Draw the instances [_first, _first + _count) of the voxel index buffer
+	// at vertex buffer binding 0. The pipeline must be set before.
+	void draw(GLuint _first, GLsizei _count);
+
+	// Draw the voxels above the threshold inside centered boxes of several
+	// sizes with both paths and print the GPU times. The geometry path uses
+	// voxel_sorted.vert + voxel.geom. Both read the same index list (bound at
+	// shader storage binding 1 and vertex buffer binding 0), so the output
+	// is equal. All textures and uniform buffers must be bound, the previous
+	// buffer bindings are lost.
+	void benchmark(gpupro::OGLContext& _context, gpupro::Pipeline& _geometryPipe, gpupro::Pipeline& _instancedPipe,
+		const Volume& _volume, int _threshold);
+private:
+	gpupro::VertexFormat m_vertexFormat;
+	gpupro::Buffer m_indices;
+};
@@ -0,0 +1,168 @@
+#include "labels.hpp"
+#include "parallel.hpp"
+
+#include <gli/gli.hpp>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace gpupro;
+using namespace glm;
+
+static const int BRICK_SIZE = BrickPyramid::BRICK_SIZE;
+
+bool LabelVolume::isLabelTexture(const gli::texture3d& _texture)
+{
+	return _texture.format() == gli::FORMAT_R8_UINT_PACK8 || _texture.format() == gli::FORMAT_R16_UINT_PACK16;
+}
+
+// Well distributed colors for consecutive labels (golden ratio hue steps).
+static vec3 labelColor(int _label)
+{
+	float hue = fract(_label * 0.618034f) * 6.0f;
+	vec3 rgb = clamp(vec3(abs(hue - 3.0f) - 1.0f, 2.0f - abs(hue - 2.0f), 2.0f - abs(hue - 4.0f)), 0.0f, 1.0f);
+	return mix(vec3(1.0f), rgb, 0.7f);
+}
+
+LabelVolume::LabelVolume(const gli::texture3d& _texture) :
+	m_size(_texture.extent(0)),
+	m_numBricks((m_size + BRICK_SIZE - 1) / BRICK_SIZE),
+	m_labels(size_t(m_size.x) * m_size.y * m_size.z),
+	m_brickPresence(size_t(m_numBricks.x) * m_numBricks.y * m_numBricks.z, 0),
+	m_visibleBits(0),
+	m_texture(Texture::Layout::TEX_3D, m_size.x, m_size.y, m_size.z, InternalFormat::R16UI, 1),
+	m_numDrawnVoxels(0),
+	m_rangesDirty(true)
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+	if(_texture.format() == gli::FORMAT_R8_UINT_PACK8)
+	{
+		const uint8_t* data = static_cast<const uint8_t*>(_texture.data());
+		std::copy(data, data + m_labels.size(), m_labels.begin());
+	} else {
+		const uint16_t* data = static_cast<const uint16_t*>(_texture.data());
+		std::copy(data, data + m_labels.size(), m_labels.begin());
+	}
+
+	// Presence bits per brick, one slab of bricks per task.
+	std::vector<uint16_t> slabMaxLabel(m_numBricks.z, 0);
+	parallelFor(0, m_numBricks.z, [&](int bz) {
+		for(int by = 0; by < m_numBricks.y; ++by)
+			for(int bx = 0; bx < m_numBricks.x; ++bx)
+			{
+				ivec3 lo = ivec3(bx, by, bz) * BRICK_SIZE;
+				ivec3 hi = min(lo + BRICK_SIZE, m_size);
+				uint64_t presence = 0;
+				for(int z = lo.z; z < hi.z; ++z)
+					for(int y = lo.y; y < hi.y; ++y)
+						for(int x = lo.x; x < hi.x; ++x)
+						{
+							uint16_t label = at(x, y, z);
+							if(label == 0) continue;
+							presence |= uint64_t(1) << (label % 64);
+							slabMaxLabel[bz] = std::max(slabMaxLabel[bz], label);
+						}
+				m_brickPresence[bx + size_t(m_numBricks.x) * (by + size_t(m_numBricks.y) * bz)] = presence;
+			}
+	});
+	int maxLabel = 0;
+	for(uint16_t label : slabMaxLabel)
+		maxLabel = std::max(maxLabel, int(label));
+
+	m_table.resize(maxLabel + 1);
+	for(int label = 0; label <= maxLabel; ++label)
+		m_table[label] = vec4(labelColor(label), label == 0 ? 0.0f : 1.0f);
+	m_tableBuffer.reset(new Buffer(Buffer::Type::SHADER_STORAGE, sizeof(vec4), GLuint(m_table.size()),
+		Buffer::Usage::SUB_DATA_UPDATE, m_table.data()));
+	updateVisibleBits();
+
+	m_texture.setData(0, 0, SetDataFormat::R_INTEGER, SetDataType::UINT16, m_labels.data());
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "INF: Loaded label volume with " << maxLabel << " labels (" << memoryUsage() / (1024 * 1024) << " MB) in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+}
+
+void LabelVolume::setVisible(int _label, bool _visible)
+{
+	if(_label <= 0 || _label >= numLabels() || isVisible(_label) == _visible)
+		return;
+	m_table[_label].w = _visible ? 1.0f : 0.0f;
+	m_tableBuffer->subDataUpdate(_label * sizeof(vec4), sizeof(vec4), &m_table[_label]);
+	updateVisibleBits();
+}
+
+void LabelVolume::showAll()
+{
+	for(int label = 1; label < numLabels(); ++label)
+		m_table[label].w = 1.0f;
+	m_tableBuffer->subDataUpdate(0, GLsizei(m_table.size() * sizeof(vec4)), m_table.data());
+	updateVisibleBits();
+}
+
+void LabelVolume::updateVisibleBits()
+{
+	uint64_t bits = 0;
+	for(int label = 1; label < numLabels(); ++label)
+		if(isVisible(label))
+			bits |= uint64_t(1) << (label % 64);
+	if(bits != m_visibleBits)
+		m_rangesDirty = true;
+	m_visibleBits = bits;
+}
+
+void LabelVolume::buildRanges()
+{
+	// Runs of consecutive drawn bricks along x are shared by all voxel rows
+	// of a brick row.
+	m_first.clear();
+	m_count.clear();
+	m_numDrawnVoxels = 0;
+	std::vector<ivec2> runs;
+	for(int bz = 0; bz < m_numBricks.z; ++bz)
+		for(int by = 0; by < m_numBricks.y; ++by)
+		{
+			runs.clear();
+			const uint64_t* presence = &m_brickPresence[size_t(m_numBricks.x) * (by + size_t(m_numBricks.y) * bz)];
+			for(int bx = 0; bx < m_numBricks.x; ++bx)
+			{
+				if(!(presence[bx] & m_visibleBits))
+					continue;
+				int x0 = bx * BRICK_SIZE;
+				int x1 = std::min(x0 + BRICK_SIZE, m_size.x);
+				if(!runs.empty() && runs.back().y == x0)
+					runs.back().y = x1;
+				else runs.push_back(ivec2(x0, x1));
+			}
+			if(runs.empty())
+				continue;
+			for(int z = bz * BRICK_SIZE; z < std::min((bz + 1) * BRICK_SIZE, m_size.z); ++z)
+				for(int y = by * BRICK_SIZE; y < std::min((by + 1) * BRICK_SIZE, m_size.y); ++y)
+					for(const ivec2& run : runs)
+					{
+						m_first.push_back(GLint(run.x + size_t(m_size.x) * (y + size_t(m_size.y) * z)));
+						m_count.push_back(run.y - run.x);
+						m_numDrawnVoxels += run.y - run.x;
+					}
+		}
+	m_rangesDirty = false;
+}
+
+void LabelVolume::draw()
+{
+	if(m_rangesDirty)
+		buildRanges();
+	if(!m_first.empty())
+		glMultiDrawArrays(GL_POINTS, m_first.data(), m_count.data(), GLsizei(m_first.size()));
+}
+
+size_t LabelVolume::memoryUsage() const
+{
+	return m_labels.size() * sizeof(uint16_t) + m_table.size() * sizeof(vec4);
+}
+
+void LabelVolume::bind(GLuint _labelBinding, GLuint _tableBinding)
+{
+	m_texture.bindAsTexture(_labelBinding);
+	m_tableBuffer->bindAsShaderStorageBuffer(_tableBinding);
+}
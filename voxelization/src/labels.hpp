@@ -0,0 +1,67 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+#include <memory>
+#include "volume.hpp"
+
+// Segmentation volume with an integer label per voxel (0 is background).
+// The labels are uploaded once as R16UI texture. A table of (color, visible)
+// per label lives in a shader storage buffer, so hiding a label is a single
+// subDataUpdate of one entry and labels.geom treats voxels of hidden labels
+// as empty.
+// The shadows and AO of the luminance do not apply, labels.frag only uses
+// the local lighting.
+// Each brick of BrickPyramid::BRICK_SIZE^3 voxels has a presence bitset with
+// bit (label % 64) for all its labels. Bricks without a bit of any visible
+// label are not drawn at all.
+class LabelVolume
+{
+public:
+	// True for single channel unsigned integer formats (8 and 16 bit).
+	static bool isLabelTexture(const gli::texture3d& _texture);
+
+	// The texture must have a label format.
+	LabelVolume(const gli::texture3d& _texture);
+
+	const glm::ivec3& size() const { return m_size; }
+	uint16_t at(int _x, int _y, int _z) const { return m_labels[_x + size_t(m_size.x) * (_y + size_t(m_size.y) * _z)]; }
+	// Largest label + 1
+	int numLabels() const { return int(m_table.size()); }
+
+	bool isVisible(int _label) const { return m_table[_label].w != 0.0f; }
+	// Background (label 0) is always hidden.
+	void setVisible(int _label, bool _visible);
+	void showAll();
+	const glm::vec4& color(int _label) const { return m_table[_label]; }
+
+	// Draw one point per voxel (for voxel.vert + labels.geom) in all bricks
+	// which may contain a visible label. The ranges are rebuilt after a
+	// visibility change.
+	void draw();
+	size_t numDrawnVoxels() const { return m_numDrawnVoxels; }
+
+	// Bytes on GPU (label texture and table).
+	size_t memoryUsage() const;
+
+	// Labels (usampler3D) and label table (SSBO)
+	void bind(GLuint _labelBinding, GLuint _tableBinding);
+private:
+	glm::ivec3 m_size;
+	glm::ivec3 m_numBricks;
+	std::vector<uint16_t> m_labels;
+	std::vector<uint64_t> m_brickPresence;	///< Bit (label % 64) of each label in the brick
+	std::vector<glm::vec4> m_table;			///< Color (rgb) and visibility (a) of each label
+	uint64_t m_visibleBits;					///< Presence bits of all visible labels
+	gpupro::Texture m_texture;
+	std::unique_ptr<gpupro::Buffer> m_tableBuffer;
+	std::vector<GLint> m_first;
+	std::vector<GLsizei> m_count;
+	size_t m_numDrawnVoxels;
+	bool m_rangesDirty;
+
+	void updateVisibleBits();
+	void buildRanges();
+};
@@ -0,0 +1,187 @@
+#include "multiview.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <chrono>
+#include <cstddef>
+#include <algorithm>
+
+using namespace gpupro;
+using namespace glm;
+
+MultiViewRenderer::MultiViewRenderer(const ivec3& _volumeSize, ProgramCache& _programs, const Shader::Defines& _atlasFormat) :
+	m_volumeSize(_volumeSize),
+	m_uniformBuffer(Buffer::Type::UNIFORM, sizeof(MultiViewUniforms), 1, Buffer::Usage::SUB_DATA_UPDATE),
+	m_linearSampler(SamplerState::Filter::LINEAR, SamplerState::Filter::LINEAR, SamplerState::Filter::NONE,
+		1.0f, SamplerState::DepthCompareFunc::DISABLE, SamplerState::BorderHandling::CLAMP)
+{
+	m_program = _programs.load({
+		{Shader::Type::VERTEX, "shaders/voxel_multiview.vert"},
+		{Shader::Type::GEOMETRY, "shaders/voxel_multiview.geom"},
+		{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+	}, _atlasFormat);
+	m_pipeline.shader = &m_program;
+	m_pipeline.depthStencil.depthTest = true;
+	m_pipeline.samplerState[4] = &m_linearSampler;
+
+	m_uniforms.firstView = 0;
+	m_uniforms.directIndices = 0;
+	setViews(mat4(), vec3(0.0f), RegionOfInterest(_volumeSize));
+}
+
+void MultiViewRenderer::setViews(const mat4& _viewProjection, const vec3& _cameraPosition, const RegionOfInterest& _roi)
+{
+	ivec3 slice = (_roi.boxMin() + _roi.boxMax()) / 2;
+	m_uniforms.views[0].viewProjection = _viewProjection;
+	m_uniforms.views[0].eye = vec4(_cameraPosition, 1.0f);
+	m_uniforms.views[0].slabMin = ivec4(0);
+	m_uniforms.views[0].slabMax = ivec4(m_volumeSize, 0);
+
+	// Axial (look along -z), coronal (along -y) and sagittal (along -x)
+	vec3 center = vec3(m_volumeSize - 1) * 0.5f;
+	float radius = length(vec3(m_volumeSize)) * 0.5f;
+	const vec3 towardsViewer[3] = {vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f)};
+	const vec3 up[3] = {vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f)};
+	for(int i = 0; i < 3; ++i)
+	{
+		ViewUniforms& view = m_uniforms.views[i + 1];
+		view.viewProjection = ortho(-radius, radius, -radius, radius, 0.0f, 4.0f * radius)
+			* lookAt(center + towardsViewer[i] * 2.0f * radius, center, up[i]);
+		view.eye = vec4(towardsViewer[i], 0.0f);
+		int axis = 2 - i;
+		view.slabMin = ivec4(_roi.boxMin(), 0);
+		view.slabMax = ivec4(_roi.boxMax(), 0);
+		view.slabMin[axis] = clamp(slice[axis], 0, m_volumeSize[axis] - 1);
+		view.slabMax[axis] = view.slabMin[axis] + 1;
+	}
+}
+
+mat4 MultiViewRenderer::volumeViewProjection() const
+{
+	// The axial view without the slab
+	return m_uniforms.views[1].viewProjection;
+}
+
+void MultiViewRenderer::viewport(int _view, GLfloat* _rect) const
+{
+	// 3D view top left, then row major
+	GLfloat width = m_viewport[2] * 0.5f;
+	GLfloat height = m_viewport[3] * 0.5f;
+	_rect[0] = m_viewport[0] + (_view % 2) * width;
+	_rect[1] = m_viewport[1] + (1 - _view / 2) * height;
+	_rect[2] = width;
+	_rect[3] = height;
+}
+
+void MultiViewRenderer::uploadUniforms(int _firstView)
+{
+	m_uniforms.firstView = _firstView;
+	m_uniformBuffer.subDataUpdate(0, sizeof(MultiViewUniforms), &m_uniforms);
+}
+
+void MultiViewRenderer::setFirstView(int _firstView)
+{
+	m_uniforms.firstView = _firstView;
+	m_uniformBuffer.subDataUpdate(offsetof(MultiViewUniforms, firstView), sizeof(int), &m_uniforms.firstView);
+}
+
+GLsizei MultiViewRenderer::numSlabVoxels(int _view) const
+{
+	ivec3 extent = max(ivec3(m_uniforms.views[_view].slabMax - m_uniforms.views[_view].slabMin), ivec3(0));
+	return GLsizei(extent.x * extent.y * extent.z);
+}
+
+void MultiViewRenderer::drawView0(const SortedVoxelIndex& _sortedVoxels, int _threshold, const VoxelDrawRanges* _ranges)
+{
+	if(_ranges)
+	{
+		_ranges->draw();
+		return;
+	}
+	GLint first;
+	GLsizei count;
+	_sortedVoxels.visibleRange(_threshold, first, count);
+	if(count > 0)
+		glDrawArrays(GL_POINTS, first, count);
+}
+
+void MultiViewRenderer::draw(OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+	const VoxelDrawRanges* _ranges)
+{
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+	GLfloat rects[NUM_VIEWS * 4];
+	for(int i = 0; i < NUM_VIEWS; ++i)
+		viewport(i, rects + i * 4);
+	glViewportArrayv(0, NUM_VIEWS, rects);
+
+	// 3D view: the visible suffix of the sorted voxels or the ranges of the
+	// region.
+	m_uniforms.directIndices = _ranges ? 1 : 0;
+	uploadUniforms(0);
+	m_uniformBuffer.bindAsUniformBuffer(2);
+	_context.setState(m_pipeline);
+	drawView0(_sortedVoxels, _threshold, _ranges);
+
+	// Slices: one instance per view over the voxels of its slab only. The
+	// slabs differ in size, vertices beyond the slab of a view are culled in
+	// voxel_multiview.vert.
+	GLsizei maxSlabVoxels = 0;
+	for(int i = 1; i < NUM_VIEWS; ++i)
+		maxSlabVoxels = std::max(maxSlabVoxels, numSlabVoxels(i));
+	setFirstView(1);
+	glDrawArraysInstanced(GL_POINTS, 0, maxSlabVoxels, NUM_VIEWS - 1);
+
+	// glViewport sets all viewports of the array
+	glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+}
+
+void MultiViewRenderer::drawSequential(OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+	const VoxelDrawRanges* _ranges)
+{
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+	m_uniforms.directIndices = _ranges ? 1 : 0;
+	for(int i = 0; i < NUM_VIEWS; ++i)
+	{
+		GLfloat rect[4];
+		viewport(i, rect);
+		glViewport(GLint(rect[0]), GLint(rect[1]), GLsizei(rect[2]), GLsizei(rect[3]));
+		uploadUniforms(i);
+		m_uniformBuffer.bindAsUniformBuffer(2);
+		_context.setState(m_pipeline);
+		if(i == 0)
+			drawView0(_sortedVoxels, _threshold, _ranges);
+		else glDrawArrays(GL_POINTS, 0, numSlabVoxels(i));
+	}
+	glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+}
+
+void MultiViewRenderer::benchmark(OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+	const VoxelDrawRanges* _ranges)
+{
+	const int NUM_DRAWS = 20;
+	Query timer(Query::Type::TIME_ELAPSED);
+	double gpuTime[2], cpuTime[2];
+	for(int variant = 0; variant < 2; ++variant)
+	{
+		double gpuSum = 0.0, cpuSum = 0.0;
+		for(int i = 0; i < NUM_DRAWS; ++i)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+			timer.begin();
+			auto time_start = std::chrono::high_resolution_clock::now();
+			if(variant == 0) draw(_context, _sortedVoxels, _threshold, _ranges);
+			else drawSequential(_context, _sortedVoxels, _threshold, _ranges);
+			auto time_end = std::chrono::high_resolution_clock::now();
+			timer.end();
+			timer.receive();
+			gpuSum += timer.latest();
+			cpuSum += std::chrono::duration<double, std::milli>(time_end - time_start).count();
+		}
+		gpuTime[variant] = gpuSum / NUM_DRAWS;
+		cpuTime[variant] = cpuSum / NUM_DRAWS;
+	}
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	std::cerr << "\nINF: " << NUM_VIEWS << " views in two draws: GPU " << gpuTime[0] << " ms, CPU " << cpuTime[0]
+		<< " ms; " << NUM_VIEWS << " sequential passes: GPU " << gpuTime[1] << " ms, CPU " << cpuTime[1] << " ms\n";
+}
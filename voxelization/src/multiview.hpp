@@ -0,0 +1,77 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/mat4x4.hpp>
+#include "sortedindex.hpp"
+#include "roi.hpp"
+
+// Renders the voxels into four viewports: the 3D view and orthographic
+// axial (z), coronal (y) and sagittal (x) slices of one voxel thickness.
+// The 3D view draws the visible sorted voxels, the three slices are one
+// instanced draw over the voxels of their slabs only (the instance is the
+// view). voxel_multiview.geom routes the faces with gl_ViewportIndex. The
+// view parameters are an array in one uniform buffer (binding 2).
+// In the slices only voxels of the slice count as occupied, so the cut
+// surface is visible. A cropped region of interest restricts the 3D view to
+// the VoxelDrawRanges and the slabs to the box of the region.
+class MultiViewRenderer
+{
+public:
+	static const int NUM_VIEWS = 4;
+
+	// _atlasFormat: see BrickAtlas::formatDefines()
+	MultiViewRenderer(const glm::ivec3& _volumeSize, gpupro::ProgramCache& _programs, const gpupro::Shader::Defines& _atlasFormat);
+
+	// View 0 uses the camera, the slices go through the center of the box of
+	// _roi and are limited to the box.
+	void setViews(const glm::mat4& _viewProjection, const glm::vec3& _cameraPosition, const RegionOfInterest& _roi);
+	// Orthographic view of the entire volume, e.g. to request all bricks.
+	glm::mat4 volumeViewProjection() const;
+
+	// Draw all views with two draws into the quadrants of the current viewport.
+	// The same textures and buffers as for voxel_sorted.vert + voxel.geom
+	// must be bound.
+	// _ranges: if set, the 3D view draws these ranges (cropped region)
+	//		instead of the sorted voxels.
+	void draw(gpupro::OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+		const VoxelDrawRanges* _ranges = nullptr);
+	// Same output with one pass per view.
+	void drawSequential(gpupro::OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+		const VoxelDrawRanges* _ranges = nullptr);
+
+	// Measure both variants and print CPU and GPU times.
+	void benchmark(gpupro::OGLContext& _context, const SortedVoxelIndex& _sortedVoxels, int _threshold,
+		const VoxelDrawRanges* _ranges = nullptr);
+private:
+	struct ViewUniforms
+	{
+		glm::mat4 viewProjection;
+		glm::vec4 eye;			///< Camera position (w = 1) or direction towards the viewer (w = 0)
+		glm::ivec4 slabMin;		///< Voxels outside [slabMin, slabMax) are empty in this view
+		glm::ivec4 slabMax;
+	};
+	struct MultiViewUniforms
+	{
+		ViewUniforms views[NUM_VIEWS];
+		int firstView;			///< View of instance 0, views > 0 draw their slab
+		int directIndices;		///< 1 if view 0 draws voxel indices (VoxelDrawRanges)
+		int padding[2];
+	};
+
+	glm::ivec3 m_volumeSize;
+	MultiViewUniforms m_uniforms;
+	gpupro::Buffer m_uniformBuffer;
+	gpupro::SamplerState m_linearSampler;
+	gpupro::Program m_program;
+	gpupro::Pipeline m_pipeline;
+	GLint m_viewport[4];		///< Viewport of the last draw
+
+	// Get the quadrant of a view in the current viewport.
+	void viewport(int _view, GLfloat* _rect) const;
+	void uploadUniforms(int _firstView);
+	// Draw view 0 from the ranges or the visible sorted voxels.
+	void drawView0(const SortedVoxelIndex& _sortedVoxels, int _threshold, const VoxelDrawRanges* _ranges);
+	// Update only firstView of the uploaded uniforms.
+	void setFirstView(int _firstView);
+	GLsizei numSlabVoxels(int _view) const;
+};
@@ -0,0 +1,119 @@
+#include "occupancy.hpp"
+#include "parallel.hpp"
+
+#include <emmintrin.h>
+#include <iostream>
+#include <chrono>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace gpupro;
+using namespace glm;
+
+static int popcount64(uint64_t _x)
+{
+#ifdef _MSC_VER
+	return int(__popcnt64(_x));
+#else
+	return __builtin_popcountll(_x);
+#endif
+}
+
+OccupancyMask::OccupancyMask(const Volume& _volume) :
+	m_volume(_volume),
+	m_size(_volume.size()),
+	m_wordsPerRow((_volume.size().x + 63) / 64),
+	m_words(size_t(m_wordsPerRow) * _volume.size().y * _volume.size().z, 0),
+	m_texture(Texture::Layout::TEX_3D, m_wordsPerRow * 2, _volume.size().y, _volume.size().z, InternalFormat::R32UI, 1),
+	m_threshold(-1)
+{
+}
+
+bool OccupancyMask::update(float _threshold)
+{
+	int threshold = Volume::quantizeThreshold(_threshold);
+	if(threshold == m_threshold)
+		return false;
+	m_threshold = threshold;
+
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	// v >= t for unsigned bytes is max(v, t) == v.
+	const __m128i thresholdV = _mm_set1_epi8(char(std::min(threshold, 255)));
+	const int numRows = m_size.y * m_size.z;
+	parallelFor(0, numRows, [&](int row) {
+		const uint8_t* lum = m_volume.data() + size_t(row) * m_size.x;
+		uint64_t* words = &m_words[size_t(row) * m_wordsPerRow];
+		for(int w = 0; w < m_wordsPerRow; ++w)
+		{
+			uint64_t bits = 0;
+			if(threshold <= 255)
+			{
+				for(int c = 0; c < 4; ++c)
+				{
+					int x0 = w * 64 + c * 16;
+					uint64_t chunk = 0;
+					if(x0 + 16 <= m_size.x)
+					{
+						__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lum + x0));
+						chunk = uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, thresholdV), v)));
+					} else {
+						for(int x = x0; x < m_size.x; ++x)
+							chunk |= uint64_t(lum[x] >= threshold) << (x - x0);
+					}
+					bits |= chunk << (c * 16);
+				}
+			}
+			words[w] = bits;
+		}
+	}, 64);
+
+	// Little endian: each 64 bit word is the pair of 32 bit texels (low, high).
+	m_texture.setData(0, 0, SetDataFormat::R_INTEGER, SetDataType::UINT32, m_words.data());
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "\nINF: Built occupancy mask (" << memoryUsage() / (1024 * 1024) << " MB vs. "
+		<< m_volume.numVoxels() * 4 / (1024 * 1024) << " MB RGBA8) in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+	return true;
+}
+
+uint64_t OccupancyMask::exposedFaces(Face _face, int _w, int _y, int _z) const
+{
+	uint64_t self = word(_w, _y, _z);
+	uint64_t neighbors = 0;
+	switch(_face)
+	{
+	case Face::POS_X: neighbors = (self >> 1) | (word(_w + 1, _y, _z) << 63); break;
+	case Face::NEG_X: neighbors = (self << 1) | (word(_w - 1, _y, _z) >> 63); break;
+	case Face::POS_Y: neighbors = word(_w, _y + 1, _z); break;
+	case Face::NEG_Y: neighbors = word(_w, _y - 1, _z); break;
+	case Face::POS_Z: neighbors = word(_w, _y, _z + 1); break;
+	case Face::NEG_Z: neighbors = word(_w, _y, _z - 1); break;
+	}
+	return self & ~neighbors;
+}
+
+size_t OccupancyMask::countOccupied() const
+{
+	size_t count = 0;
+	for(uint64_t w : m_words)
+		count += popcount64(w);
+	return count;
+}
+
+size_t OccupancyMask::countExposedFaces() const
+{
+	std::vector<size_t> sliceCount(m_size.z, 0);
+	parallelFor(0, m_size.z, [&](int z) {
+		for(int y = 0; y < m_size.y; ++y)
+			for(int w = 0; w < m_wordsPerRow; ++w)
+				for(int face = 0; face < 6; ++face)
+					sliceCount[z] += popcount64(exposedFaces(Face(face), w, y, z));
+	});
+	size_t count = 0;
+	for(size_t c : sliceCount)
+		count += c;
+	return count;
+}
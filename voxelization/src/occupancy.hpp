@@ -0,0 +1,65 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include "volume.hpp"
+
+// Neighbor directions of a voxel.
+enum class Face
+{
+	POS_X, NEG_X,
+	POS_Y, NEG_Y,
+	POS_Z, NEG_Z
+};
+
+// Bit packed occupancy (luminance >= threshold) of the volume. Rows along X
+// are stored in 64 bit words, bit i of word w is the voxel x = 64 * w + i.
+// Bits behind the end of a row are always zero.
+// The same bits are mirrored on GPU in a R32UI 3D texture with two 32 bit
+// words per 64 bit word (texel x covers the voxels 32 * x to 32 * x + 31).
+class OccupancyMask
+{
+public:
+	// The volume must outlive this object.
+	OccupancyMask(const Volume& _volume);
+
+	// Rebuild the mask (CPU and GPU) if the quantized threshold changed.
+	// Returns true if the mask changed.
+	bool update(float _threshold);
+	// Quantized threshold (see Volume::quantizeThreshold) of the current
+	// mask, -1 before the first update.
+	int threshold() const { return m_threshold; }
+
+	const glm::ivec3& size() const { return m_size; }
+	int wordsPerRow() const { return m_wordsPerRow; }
+	// Get a word of the mask. Words outside of the volume are 0.
+	uint64_t word(int _w, int _y, int _z) const
+	{
+		if(_w < 0 || _y < 0 || _z < 0 || _w >= m_wordsPerRow || _y >= m_size.y || _z >= m_size.z)
+			return 0;
+		return m_words[_w + size_t(m_wordsPerRow) * (_y + size_t(m_size.y) * _z)];
+	}
+	// Voxels outside of the volume are empty.
+	bool isOccupied(int _x, int _y, int _z) const
+	{
+		if(_x < 0 || _x >= m_size.x) return false;
+		return (word(_x >> 6, _y, _z) >> (_x & 63)) & 1;
+	}
+	// Occupied voxels of a word whose neighbor in direction _face is empty.
+	uint64_t exposedFaces(Face _face, int _w, int _y, int _z) const;
+
+	size_t countOccupied() const;
+	// Number of faces between an occupied voxel and an empty one or the border.
+	size_t countExposedFaces() const;
+	// CPU memory of the mask in bytes.
+	size_t memoryUsage() const { return m_words.size() * sizeof(uint64_t); }
+
+	void bindAsTexture(GLuint _bindingIndex) { m_texture.bindAsTexture(_bindingIndex); }
+	gpupro::Texture& texture() { return m_texture; }
+private:
+	const Volume& m_volume;
+	glm::ivec3 m_size;
+	int m_wordsPerRow;
+	std::vector<uint64_t> m_words;
+	gpupro::Texture m_texture;
+	int m_threshold;
+};
@@ -0,0 +1,278 @@
+#include "octree.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace gpupro;
+using namespace glm;
+
+static int popcount32(uint32_t _x)
+{
+#ifdef _MSC_VER
+	return int(__popcnt(_x));
+#else
+	return __builtin_popcount(_x);
+#endif
+}
+
+SparseVoxelOctree::SparseVoxelOctree(const OccupancyMask& _occupancy) :
+	m_occupancy(_occupancy),
+	m_size(_occupancy.size()),
+	m_rootSize(LEAF_SIZE * 2),
+	m_threshold(-1)
+{
+	// The root is always an inner node
+	int maxSize = max(m_size.x, max(m_size.y, m_size.z));
+	m_numLevels = 2;
+	while(m_rootSize < maxSize)
+	{
+		m_rootSize *= 2;
+		++m_numLevels;
+	}
+}
+
+bool SparseVoxelOctree::update()
+{
+	int threshold = m_occupancy.threshold();
+	if(threshold == m_threshold)
+		return false;
+	m_threshold = threshold;
+	build();
+	return true;
+}
+
+void SparseVoxelOctree::build()
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	// Dense grids of all levels, restricted to the nodes which touch the
+	// volume. Level l has cells of m_rootSize >> l voxels.
+	int leafLevel = m_numLevels - 1;
+	std::vector<ivec3> levelSize(m_numLevels);
+	for(int l = 0; l < m_numLevels; ++l)
+	{
+		int cellSize = m_rootSize >> l;
+		levelSize[l] = (m_size + cellSize - 1) / cellSize;
+	}
+	auto denseIndex = [&](int _l, const ivec3& _node) {
+		return _node.x + size_t(levelSize[_l].x) * (_node.y + size_t(levelSize[_l].y) * _node.z);
+	};
+
+	// Leaf masks: the 4 bits of a brick row are always inside one 64 bit word.
+	const ivec3& leafSize = levelSize[leafLevel];
+	std::vector<uint64_t> leafBits(size_t(leafSize.x) * leafSize.y * leafSize.z);
+	parallelFor(0, leafSize.y * leafSize.z, [&](int row) {
+		int by = row % leafSize.y;
+		int bz = row / leafSize.y;
+		for(int bx = 0; bx < leafSize.x; ++bx)
+		{
+			int x = bx * LEAF_SIZE;
+			uint64_t bits = 0;
+			for(int z = 0; z < LEAF_SIZE; ++z)
+				for(int y = 0; y < LEAF_SIZE; ++y)
+				{
+					uint64_t word = m_occupancy.word(x >> 6, by * LEAF_SIZE + y, bz * LEAF_SIZE + z);
+					bits |= ((word >> (x & 63)) & 0xF) << (LEAF_SIZE * (y + LEAF_SIZE * z));
+				}
+			leafBits[denseIndex(leafLevel, ivec3(bx, by, bz))] = bits;
+		}
+	});
+
+	// Child masks of the inner levels, bottom up.
+	std::vector<std::vector<uint8_t>> childMasks(leafLevel);
+	for(int l = leafLevel - 1; l >= 0; --l)
+	{
+		const ivec3& size = levelSize[l];
+		const ivec3& childSize = levelSize[l + 1];
+		childMasks[l].resize(size_t(size.x) * size.y * size.z);
+		parallelFor(0, size.y * size.z, [&](int row) {
+			int y = row % size.y;
+			int z = row / size.y;
+			for(int x = 0; x < size.x; ++x)
+			{
+				uint8_t mask = 0;
+				for(int i = 0; i < 8; ++i)
+				{
+					ivec3 child = ivec3(x, y, z) * 2 + ivec3(i & 1, (i >> 1) & 1, i >> 2);
+					if(any(greaterThanEqual(child, childSize)))
+						continue;
+					size_t idx = denseIndex(l + 1, child);
+					bool nonEmpty = l + 1 == leafLevel ? leafBits[idx] != 0 : childMasks[l + 1][idx] != 0;
+					if(nonEmpty) mask |= uint8_t(1 << i);
+				}
+				childMasks[l][denseIndex(l, ivec3(x, y, z))] = mask;
+			}
+		}, 16);
+	}
+
+	// Breadth first layout, top down. The children of a level are placed
+	// with a prefix sum over the child counts of their parents.
+	m_nodes.clear();
+	std::vector<ivec3> level(1, ivec3(0));
+	for(int l = 0; l < leafLevel; ++l)
+	{
+		size_t levelStart = m_nodes.size();
+		std::vector<uint32_t> firstChild(level.size() + 1);
+		firstChild[0] = uint32_t(levelStart + level.size());
+		for(size_t i = 0; i < level.size(); ++i)
+			firstChild[i + 1] = firstChild[i] + popcount32(childMasks[l][denseIndex(l, level[i])]);
+
+		m_nodes.resize(levelStart + level.size());
+		std::vector<ivec3> children(firstChild.back() - firstChild[0]);
+		parallelFor(0, int(level.size()), [&](int i) {
+			uint32_t mask = childMasks[l][denseIndex(l, level[i])];
+			m_nodes[levelStart + i] = uvec2(mask, firstChild[i]);
+			uint32_t next = firstChild[i] - firstChild[0];
+			for(int c = 0; c < 8; ++c)
+				if(mask & (1u << c))
+					children[next++] = level[i] * 2 + ivec3(c & 1, (c >> 1) & 1, c >> 2);
+		}, 256);
+		level.swap(children);
+	}
+	size_t leafStart = m_nodes.size();
+	m_nodes.resize(leafStart + level.size());
+	parallelFor(0, int(level.size()), [&](int i) {
+		uint64_t bits = leafBits[denseIndex(leafLevel, level[i])];
+		m_nodes[leafStart + i] = uvec2(uint32_t(bits), uint32_t(bits >> 32));
+	}, 256);
+
+	m_buffer.reset(new Buffer(Buffer::Type::SHADER_STORAGE, sizeof(uvec2), GLuint(m_nodes.size()), Buffer::Usage(), m_nodes.data()));
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	size_t denseSize = size_t(m_size.x) * m_size.y * m_size.z;
+	std::cerr << "\nINF: Built sparse voxel octree with " << leafStart << " inner nodes and " << level.size()
+		<< " leaves in " << std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms ("
+		<< memoryUsage() / 1024 << " KB vs. " << denseSize * 4 / 1024 << " KB RGBA8, "
+		<< m_occupancy.memoryUsage() / 1024 << " KB occupancy mask)\n";
+}
+
+static vec2 intersectBox(const vec3& _origin, const vec3& _invDir, const vec3& _boxMin, const vec3& _boxMax)
+{
+	vec3 t0 = (_boxMin - _origin) * _invDir;
+	vec3 t1 = (_boxMax - _origin) * _invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), tMin.z), min(min(tMax.x, tMax.y), tMax.z));
+}
+
+// Same hits as octree.frag, which restarts the descent for every voxel
+// instead of the DDA within the leaves.
+bool SparseVoxelOctree::raycast(const vec3& _origin, const vec3& _dir, ivec3& _voxel, float& _distance,
+	const RegionOfInterest* _roi) const
+{
+	// Only the box of the region is traversed, clip planes are tested per voxel.
+	ivec3 boxMin = _roi ? _roi->boxMin() : ivec3(0);
+	ivec3 boxMax = _roi ? _roi->boxMax() : m_size;
+	if(any(greaterThanEqual(boxMin, boxMax)))
+		return false;
+	vec3 dir = mix(_dir, vec3(1e-12f), lessThan(abs(_dir), vec3(1e-12f)));
+	vec3 invDir = 1.0f / dir;
+	vec2 tRange = intersectBox(_origin, invDir, vec3(boxMin) - 0.5f, vec3(boxMax) - 0.5f);
+	float t = max(tRange.x, 0.0f);
+	while(t < tRange.y)
+	{
+		// Descend to the deepest node which contains the current position
+		ivec3 voxel = clamp(ivec3(floor(_origin + (t + 1e-4f) * _dir + 0.5f)), boxMin, boxMax - 1);
+		uint32_t node = 0;
+		ivec3 cellMin(0);
+		int cellSize = m_rootSize;
+		bool empty = false;
+		for(int l = 0; l < m_numLevels - 1 && !empty; ++l)
+		{
+			cellSize /= 2;
+			ivec3 c = ivec3(greaterThanEqual(voxel - cellMin, ivec3(cellSize)));
+			int child = c.x + 2 * c.y + 4 * c.z;
+			uint32_t mask = m_nodes[node].x;
+			cellMin += c * cellSize;
+			if(mask & (1u << child))
+				node = m_nodes[node].y + popcount32(mask & ((1u << child) - 1));
+			else empty = true;
+		}
+		if(empty)
+		{
+			// Skip the empty cell
+			t = max(intersectBox(_origin, invDir, vec3(cellMin) - 0.5f, vec3(cellMin + cellSize) - 0.5f).y, t + 1e-4f);
+			continue;
+		}
+
+		// 3D DDA through the voxels of the leaf (within the region box)
+		uint64_t leaf = uint64_t(m_nodes[node].x) | (uint64_t(m_nodes[node].y) << 32);
+		ivec3 leafMin = max(cellMin, boxMin);
+		ivec3 leafMax = min(cellMin + LEAF_SIZE, boxMax);
+		ivec3 step(dir.x > 0.0f ? 1 : -1, dir.y > 0.0f ? 1 : -1, dir.z > 0.0f ? 1 : -1);
+		vec3 tMax = (vec3(voxel) + 0.5f * vec3(step) - _origin) * invDir;
+		vec3 tDelta = abs(invDir);
+		float tVoxel = t;
+		while(true)
+		{
+			ivec3 local = voxel - cellMin;
+			if(((leaf >> (local.x + LEAF_SIZE * (local.y + LEAF_SIZE * local.z))) & 1) && (!_roi || _roi->containsVoxel(voxel)))
+			{
+				_voxel = voxel;
+				_distance = tVoxel;
+				return true;
+			}
+			int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+			tVoxel = tMax[axis];
+			voxel[axis] += step[axis];
+			tMax[axis] += tDelta[axis];
+			if(voxel[axis] < leafMin[axis] || voxel[axis] >= leafMax[axis])
+				break;
+		}
+		t = max(tVoxel, t + 1e-4f);
+	}
+	return false;
+}
+
+
+// ************************************************************************* //
+struct OctreeUniforms
+{
+	mat4 invViewProjection;
+	ivec3 volumeSize;
+	int rootSize;
+	vec3 lightDirection;
+	int numLevels;
+	ivec3 roiMin;
+	int numClipPlanes;
+	ivec3 roiMax;
+	int padding;
+	vec4 clipPlanes[RegionOfInterest::MAX_CLIP_PLANES];
+};
+
+OctreeRenderer::OctreeRenderer(ProgramCache& _programs, const Shader::Defines& _atlasFormat) :
+	m_uniforms(Buffer::Type::UNIFORM, sizeof(OctreeUniforms), 1, Buffer::Usage::SUB_DATA_UPDATE)
+{
+	m_program = _programs.load({
+		{Shader::Type::VERTEX, "shaders/fullscreen.vert"},
+		{Shader::Type::FRAGMENT, "shaders/octree.frag"}
+	}, _atlasFormat);
+	m_pipeline.shader = &m_program;
+}
+
+void OctreeRenderer::draw(OGLContext& _context, const SparseVoxelOctree& _octree, const mat4& _viewProjection,
+	const vec3& _lightDir, const RegionOfInterest& _roi)
+{
+	OctreeUniforms uniforms;
+	uniforms.invViewProjection = inverse(_viewProjection);
+	uniforms.volumeSize = _octree.volumeSize();
+	uniforms.rootSize = _octree.rootSize();
+	uniforms.lightDirection = _lightDir;
+	uniforms.numLevels = _octree.numLevels();
+	uniforms.roiMin = _roi.boxMin();
+	uniforms.roiMax = _roi.boxMax();
+	uniforms.numClipPlanes = _roi.numClipPlanes();
+	for(int i = 0; i < _roi.numClipPlanes(); ++i)
+		uniforms.clipPlanes[i] = _roi.clipPlane(i);
+	m_uniforms.subDataUpdate(0, sizeof(OctreeUniforms), &uniforms);
+
+	_octree.bindAsShaderStorageBuffer(0);
+	m_uniforms.bindAsUniformBuffer(1);
+	_context.setState(m_pipeline);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
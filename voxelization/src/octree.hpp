@@ -0,0 +1,79 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include "occupancy.hpp"
+#include "roi.hpp"
+
+// Sparse voxel octree of the OccupancyMask.
+// The root covers a cube of 2^n voxels with the volume in its lower corner.
+// The leaves are bricks of LEAF_SIZE^3 voxels stored as 64 bit masks with
+// the bit x + 4 * (y + 4 * z).
+// All nodes are stored breadth first in a single array of uvec2 without
+// pointers:
+//	inner node: (child mask, index of the first child). Only non-empty children
+//		exist and they are consecutive in the order of their bits. The child
+//		i = x + 2 * y + 4 * z is at firstChild + bitCount(childMask & ((1 << i) - 1)).
+//	leaf: (low, high) 32 bits of the voxel mask.
+// The depth of a node tells if it is a leaf. An empty volume is a root with
+// mask 0.
+class SparseVoxelOctree
+{
+public:
+	static const int LEAF_SIZE = 4;
+
+	// The mask must outlive this object.
+	SparseVoxelOctree(const OccupancyMask& _occupancy);
+
+	// Rebuild the tree (CPU and GPU) if the mask's threshold changed.
+	// Call after OccupancyMask::update(). Returns true if the tree changed.
+	bool update();
+
+	// Find the first occupied voxel along a ray. Voxel centers are at integer
+	// positions. _dir must be normalized. Empty nodes are skipped as a whole,
+	// inside of leaves a 3D DDA steps from voxel to voxel.
+	// _distance: distance along the ray to the entry point into the voxel.
+	// _roi: optional region of interest, voxels outside are ignored.
+	bool raycast(const glm::vec3& _origin, const glm::vec3& _dir, glm::ivec3& _voxel, float& _distance,
+		const RegionOfInterest* _roi = nullptr) const;
+
+	// Number of levels including the root and the leaves.
+	int numLevels() const { return m_numLevels; }
+	// Edge length of the root node in voxels.
+	int rootSize() const { return m_rootSize; }
+	const glm::ivec3& volumeSize() const { return m_size; }
+	size_t numNodes() const { return m_nodes.size(); }
+	// Size of the node array in bytes.
+	size_t memoryUsage() const { return m_nodes.size() * sizeof(glm::uvec2); }
+
+	void bindAsShaderStorageBuffer(GLuint _bindingIndex) const { m_buffer->bindAsShaderStorageBuffer(_bindingIndex); }
+private:
+	const OccupancyMask& m_occupancy;
+	glm::ivec3 m_size;
+	int m_rootSize;
+	int m_numLevels;
+	std::vector<glm::uvec2> m_nodes;
+	std::unique_ptr<gpupro::Buffer> m_buffer;
+	int m_threshold;
+
+	void build();
+};
+
+// Ray casts the SparseVoxelOctree in a full screen pass and shades the first
+// occupied voxel with its color from the BrickAtlas (bindings 0 and 6).
+class OctreeRenderer
+{
+public:
+	// _atlasFormat: see BrickAtlas::formatDefines()
+	OctreeRenderer(gpupro::ProgramCache& _programs, const gpupro::Shader::Defines& _atlasFormat);
+
+	// Draw into the current framebuffer.
+	// _lightDir: normalized direction towards the light.
+	void draw(gpupro::OGLContext& _context, const SparseVoxelOctree& _octree, const glm::mat4& _viewProjection,
+		const glm::vec3& _lightDir, const RegionOfInterest& _roi);
+private:
+	gpupro::Buffer m_uniforms;
+	gpupro::Program m_program;
+	gpupro::Pipeline m_pipeline;
+};
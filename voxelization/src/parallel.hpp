@@ -0,0 +1,108 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Number of worker threads used by the CPU side volume kernels.
+inline unsigned numWorkerThreads()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run _func(i) for all i in [_begin, _end) on all cores. The indices are
+// handed out dynamically in chunks of _grain, so work items of different
+// cost (e.g. rays which hit empty space vs. dense regions) are balanced.
+// Blocks until all items are processed.
+template<typename Func>
+void parallelFor(int _begin, int _end, Func _func, int _grain = 1)
+{
+	if(_end <= _begin)
+		return;
+
+	std::atomic<int> next(_begin);
+	auto worker = [&]() {
+		int first;
+		while((first = next.fetch_add(_grain)) < _end)
+		{
+			int last = std::min(first + _grain, _end);
+			for(int i = first; i < last; ++i)
+				_func(i);
+		}
+	};
+
+	unsigned numThreads = std::min(numWorkerThreads(), unsigned((_end - _begin + _grain - 1) / _grain));
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for(unsigned t = 1; t < numThreads; ++t)
+		threads.emplace_back(worker);
+	// The calling thread takes part too.
+	worker();
+	for(auto& t : threads)
+		t.join();
+}
+
+// Blocks until _numThreads threads called wait(). Can be reused for
+// consecutive phases.
+class ThreadBarrier
+{
+public:
+	explicit ThreadBarrier(unsigned _numThreads) : m_numThreads(_numThreads), m_numWaiting(0), m_phase(0) {}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		unsigned phase = m_phase;
+		if(++m_numWaiting == m_numThreads)
+		{
+			m_numWaiting = 0;
+			++m_phase;
+			m_condition.notify_all();
+		} else
+			m_condition.wait(lock, [&]() { return m_phase != phase; });
+	}
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	unsigned m_numThreads;
+	unsigned m_numWaiting;
+	unsigned m_phase;
+};
+
+// Run _func(step, i) for all steps in [0, _numSteps) one after another
+// and for all i in [_begin, _end) in parallel within a step. A step may
+// read everything the previous steps wrote (e.g. the slices of a sweep).
+// The threads are created once and each one processes the same fixed
+// range of i in every step, so the items should have similar cost.
+template<typename Func>
+void parallelSteps(int _numSteps, int _begin, int _end, Func _func)
+{
+	if(_end <= _begin || _numSteps <= 0)
+		return;
+
+	unsigned numThreads = std::min(numWorkerThreads(), unsigned(_end - _begin));
+	ThreadBarrier barrier(numThreads);
+	auto worker = [&](unsigned _thread) {
+		int first = _begin + int(int64_t(_end - _begin) * _thread / numThreads);
+		int last = _begin + int(int64_t(_end - _begin) * (_thread + 1) / numThreads);
+		for(int step = 0; step < _numSteps; ++step)
+		{
+			for(int i = first; i < last; ++i)
+				_func(step, i);
+			barrier.wait();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for(unsigned t = 1; t < numThreads; ++t)
+		threads.emplace_back(worker, t);
+	// The calling thread takes part too.
+	worker(0);
+	for(auto& t : threads)
+		t.join();
+}
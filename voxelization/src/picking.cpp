@@ -0,0 +1,132 @@
+#include "picking.hpp"
+
+#include <gli/gli.hpp>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+#include <random>
+
+using namespace glm;
+
+VoxelPicker::VoxelPicker(const SparseVoxelOctree& _octree, const OccupancyMask& _occupancy, const Volume& _volume,
+	const gli::texture3d& _texture) :
+	m_octree(_octree),
+	m_occupancy(_occupancy),
+	m_volume(_volume),
+	m_texture(_texture)
+{
+}
+
+bool VoxelPicker::pick(const mat4& _viewProjection, const vec2& _cursor, const ivec2& _viewportSize,
+	const RegionOfInterest* _roi, PickResult& _result, const OccupancyTest& _isOccupied) const
+{
+	vec2 ndc = vec2(_cursor.x / _viewportSize.x, 1.0f - _cursor.y / _viewportSize.y) * 2.0f - 1.0f;
+	mat4 invViewProjection = inverse(_viewProjection);
+	vec4 nearPoint = invViewProjection * vec4(ndc, -1.0f, 1.0f);
+	vec4 farPoint = invViewProjection * vec4(ndc, 1.0f, 1.0f);
+	vec3 origin = vec3(nearPoint) / nearPoint.w;
+	vec3 dir = normalize(vec3(farPoint) / farPoint.w - origin);
+	return pickRay(origin, dir, _roi, _result, _isOccupied);
+}
+
+bool VoxelPicker::pickRay(const vec3& _origin, const vec3& _dir, const RegionOfInterest* _roi, PickResult& _result,
+	const OccupancyTest& _isOccupied) const
+{
+	bool hit = _isOccupied ? raycastDDA(_origin, _dir, _isOccupied, _roi, _result.voxel, _result.distance)
+		: m_octree.raycast(_origin, _dir, _result.voxel, _result.distance, _roi);
+	if(!hit)
+		return false;
+	gli::fsampler3D sampler(m_texture, gli::WRAP_CLAMP_TO_EDGE);
+	_result.color = sampler.texel_fetch(_result.voxel, 0);
+	_result.luminance = m_volume.at(_result.voxel.x, _result.voxel.y, _result.voxel.z);
+	return true;
+}
+
+template<typename IsOccupied>
+bool VoxelPicker::raycastDDA(const vec3& _origin, const vec3& _dir, IsOccupied _isOccupied, const RegionOfInterest* _roi,
+	ivec3& _voxel, float& _distance) const
+{
+	ivec3 boxMin = _roi ? _roi->boxMin() : ivec3(0);
+	ivec3 boxMax = _roi ? _roi->boxMax() : m_volume.size();
+	if(any(greaterThanEqual(boxMin, boxMax)))
+		return false;
+	vec3 dir = mix(_dir, vec3(1e-12f), lessThan(abs(_dir), vec3(1e-12f)));
+	vec3 invDir = 1.0f / dir;
+	vec3 t0 = (vec3(boxMin) - 0.5f - _origin) * invDir;
+	vec3 t1 = (vec3(boxMax) - 0.5f - _origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMaxBox = max(t0, t1);
+	float tEnter = max(max(max(tMin.x, tMin.y), tMin.z), 0.0f);
+	float tExit = min(min(tMaxBox.x, tMaxBox.y), tMaxBox.z);
+	if(tEnter >= tExit)
+		return false;
+
+	ivec3 voxel = clamp(ivec3(floor(_origin + (tEnter + 1e-4f) * dir + 0.5f)), boxMin, boxMax - 1);
+	ivec3 step(dir.x > 0.0f ? 1 : -1, dir.y > 0.0f ? 1 : -1, dir.z > 0.0f ? 1 : -1);
+	vec3 tMax = (vec3(voxel) + 0.5f * vec3(step) - _origin) * invDir;
+	vec3 tDelta = abs(invDir);
+	float tVoxel = tEnter;
+	while(true)
+	{
+		if(_isOccupied(voxel) && (!_roi || _roi->containsVoxel(voxel)))
+		{
+			_voxel = voxel;
+			_distance = tVoxel;
+			return true;
+		}
+		int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+		tVoxel = tMax[axis];
+		voxel[axis] += step[axis];
+		tMax[axis] += tDelta[axis];
+		if(voxel[axis] < boxMin[axis] || voxel[axis] >= boxMax[axis])
+			return false;
+	}
+}
+
+void VoxelPicker::benchmark(int _numRays) const
+{
+	// Rays from a sphere around the volume towards random voxels
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	vec3 size(m_volume.size());
+	vec3 center = size * 0.5f - 0.5f;
+	float radius = length(size);
+	std::vector<vec3> origins(_numRays);
+	std::vector<vec3> dirs(_numRays);
+	for(int i = 0; i < _numRays; ++i)
+	{
+		float z = uniform(rng) * 2.0f - 1.0f;
+		float phi = uniform(rng) * 6.2831853f;
+		float r = sqrt(1.0f - z * z);
+		origins[i] = center + radius * vec3(r * cos(phi), r * sin(phi), z);
+		vec3 target = vec3(uniform(rng), uniform(rng), uniform(rng)) * size - 0.5f;
+		dirs[i] = normalize(target - origins[i]);
+	}
+
+	std::vector<ivec3> octreeHits(_numRays, ivec3(-1));
+	auto time_start = std::chrono::high_resolution_clock::now();
+	int numHits = 0;
+	for(int i = 0; i < _numRays; ++i)
+	{
+		float distance;
+		if(m_octree.raycast(origins[i], dirs[i], octreeHits[i], distance))
+			++numHits;
+	}
+	auto time_octree = std::chrono::high_resolution_clock::now();
+	int numMismatches = 0;
+	for(int i = 0; i < _numRays; ++i)
+	{
+		ivec3 voxel(-1);
+		float distance;
+		raycastDDA(origins[i], dirs[i], [this](const ivec3& _voxel) {
+			return m_occupancy.isOccupied(_voxel.x, _voxel.y, _voxel.z);
+		}, nullptr, voxel, distance);
+		if(voxel != octreeHits[i]) ++numMismatches;
+	}
+	auto time_dda = std::chrono::high_resolution_clock::now();
+
+	double octreeUs = std::chrono::duration<double, std::micro>(time_octree - time_start).count() / _numRays;
+	double ddaUs = std::chrono::duration<double, std::micro>(time_dda - time_octree).count() / _numRays;
+	std::cerr << "\nINF: Picking benchmark with " << _numRays << " random rays (" << numHits << " hits): octree "
+		<< octreeUs << " us/ray, plain DDA " << ddaUs << " us/ray, " << numMismatches << " different hits\n";
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <functional>
+#include "octree.hpp"
+
+struct PickResult
+{
+	glm::ivec3 voxel;
+	float distance;		///< Distance from the ray origin in voxels
+	glm::vec4 color;	///< Value of the loaded texture
+	uint8_t luminance;
+};
+
+// Finds the voxel under the cursor on the CPU. The view ray is traversed in
+// the SparseVoxelOctree (hierarchical skipping of empty nodes + 3D DDA in
+// the leaves), so no GPU readback is necessary.
+// Modes whose occupancy does not come from the OccupancyMask (e.g. the
+// label visibility) pass their own test, which is traversed by a plain DDA.
+class VoxelPicker
+{
+public:
+	typedef std::function<bool(const glm::ivec3&)> OccupancyTest;
+
+	// All objects must outlive the picker.
+	VoxelPicker(const SparseVoxelOctree& _octree, const OccupancyMask& _occupancy, const Volume& _volume,
+		const gli::texture3d& _texture);
+
+	// Unproject a cursor position (in pixels, origin at the top left like
+	// GLFW) and find the first occupied voxel inside the region of interest.
+	// _isOccupied: replaces the OccupancyMask if set.
+	bool pick(const glm::mat4& _viewProjection, const glm::vec2& _cursor, const glm::ivec2& _viewportSize,
+		const RegionOfInterest* _roi, PickResult& _result, const OccupancyTest& _isOccupied = nullptr) const;
+	// Find the first occupied voxel along a ray. _dir must be normalized.
+	bool pickRay(const glm::vec3& _origin, const glm::vec3& _dir, const RegionOfInterest* _roi, PickResult& _result,
+		const OccupancyTest& _isOccupied = nullptr) const;
+
+	// Measure random rays through the volume and compare the octree with a
+	// plain voxel by voxel DDA over the occupancy mask. Prints the results.
+	void benchmark(int _numRays) const;
+private:
+	const SparseVoxelOctree& m_octree;
+	const OccupancyMask& m_occupancy;
+	const Volume& m_volume;
+	const gli::texture3d& m_texture;
+
+	// Traversal voxel by voxel without any skipping, also the reference for
+	// the benchmark. Only the box of the region is traversed.
+	template<typename IsOccupied>
+	bool raycastDDA(const glm::vec3& _origin, const glm::vec3& _dir, IsOccupied _isOccupied, const RegionOfInterest* _roi,
+		glm::ivec3& _voxel, float& _distance) const;
+};
@@ -0,0 +1,235 @@
+#include "projection.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <emmintrin.h>
+
+using namespace gpupro;
+using namespace glm;
+
+struct ProjectionUniforms
+{
+	mat4 invViewProjection;
+	ivec3 volumeSize;
+	float stepSize;
+	int brickSize;
+	int numLevels;
+};
+
+// The accumulation of projection.frag is selected by the preprocessor.
+static Shader::Defines modeDefines(ProjectionMode _mode)
+{
+	Shader::Defines defines;
+	defines["PROJECTION_MODE"] = std::to_string(int(_mode));
+	return defines;
+}
+
+ProjectionRenderer::ProjectionRenderer(const Volume& _volume, const BrickPyramid& _pyramid, ProgramCache& _programs) :
+	m_luminance(Texture::Layout::TEX_3D, _volume.size().x, _volume.size().y, _volume.size().z, InternalFormat::R8, 1),
+	m_brickMinMax(Texture::Layout::TEX_3D, _pyramid.levelSize(0).x, _pyramid.levelSize(0).y, _pyramid.levelSize(0).z,
+		InternalFormat::RG8, _pyramid.numLevels()),
+	m_uniforms(Buffer::Type::UNIFORM, sizeof(ProjectionUniforms), 1, Buffer::Usage::SUB_DATA_UPDATE),
+	m_programs(_programs, {
+		{Shader::Type::VERTEX, "shaders/fullscreen.vert"},
+		{Shader::Type::FRAGMENT, "shaders/projection.frag"}
+	}),
+	m_volumeSize(_volume.size()),
+	m_numLevels(_pyramid.numLevels()),
+	m_stepSize(0.5f)
+{
+	// Rows of the single/two channel data are not 4 byte aligned.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	m_luminance.setData(0, 0, SetDataFormat::R, SetDataType::UINT8, _volume.data());
+	for(int l = 0; l < _pyramid.numLevels(); ++l)
+		m_brickMinMax.setData(l, 0, SetDataFormat::RG, SetDataType::UINT8, _pyramid.levelData(l));
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// The mode is switched at runtime, both variants are compiled now.
+	m_programs.prepare(modeDefines(ProjectionMode::MAXIMUM));
+	m_programs.prepare(modeDefines(ProjectionMode::AVERAGE));
+}
+
+void ProjectionRenderer::draw(OGLContext& _context, ProjectionMode _mode, const mat4& _viewProjection)
+{
+	ProjectionUniforms uniforms;
+	uniforms.invViewProjection = inverse(_viewProjection);
+	uniforms.volumeSize = m_volumeSize;
+	uniforms.stepSize = m_stepSize;
+	uniforms.brickSize = BrickPyramid::BRICK_SIZE;
+	uniforms.numLevels = m_numLevels;
+	m_uniforms.subDataUpdate(0, sizeof(ProjectionUniforms), &uniforms);
+
+	m_luminance.bindAsTexture(1);
+	m_brickMinMax.bindAsTexture(2);
+	m_uniforms.bindAsUniformBuffer(1);
+	m_pipeline.shader = &m_programs.get(modeDefines(_mode));
+	_context.setState(m_pipeline);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+
+// ************************************************************************* //
+// CPU implementation. Must stay in sync with projection.frag.
+
+static vec2 intersectBox(const vec3& _origin, const vec3& _invDir, const vec3& _boxMin, const vec3& _boxMax)
+{
+	vec3 t0 = (_boxMin - _origin) * _invDir;
+	vec3 t1 = (_boxMax - _origin) * _invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), tMin.z), min(min(tMax.x, tMax.y), tMax.z));
+}
+
+static float findSkipDistance(const BrickPyramid& _pyramid, ProjectionMode _mode, const ivec3& _brick, float _acc,
+	const vec3& _origin, const vec3& _invDir)
+{
+	for(int l = _pyramid.numLevels() - 1; l >= 0; --l)
+	{
+		ivec3 node = _pyramid.nodeOf(_brick, l);
+		float nodeMax = float(_pyramid.minMax(l, node).y);
+		bool skip = (_mode == ProjectionMode::MAXIMUM) ? (nodeMax <= _acc) : (nodeMax == 0.0f);
+		if(skip)
+		{
+			ivec3 lo, hi;
+			_pyramid.nodeBounds(l, node, lo, hi);
+			return intersectBox(_origin, _invDir, vec3(lo) - 0.5f, vec3(hi) - 0.5f).y;
+		}
+	}
+	return -1.0f;
+}
+
+// Structure of arrays for 4 rays which are marched together.
+struct RayPacket
+{
+	alignas(16) float origin[3][4];
+	alignas(16) float dir[3][4];
+	alignas(16) float tEnter[4];
+	alignas(16) float numSamples[4];
+	vec3 invDir[4];
+};
+
+static void setupRay(RayPacket& _packet, int _lane, const mat4& _invViewProjection, const ivec3& _volumeSize,
+	float _stepSize, float _ndcX, float _ndcY)
+{
+	vec4 nearPoint = _invViewProjection * vec4(_ndcX, _ndcY, -1.0f, 1.0f);
+	vec4 farPoint = _invViewProjection * vec4(_ndcX, _ndcY, 1.0f, 1.0f);
+	vec3 origin = vec3(nearPoint) / nearPoint.w;
+	vec3 dir = normalize(vec3(farPoint) / farPoint.w - origin);
+	vec3 invDir;
+	for(int i = 0; i < 3; ++i)
+		invDir[i] = 1.0f / (abs(dir[i]) < 1e-12f ? 1e-12f : dir[i]);
+
+	vec2 tRange = intersectBox(origin, invDir, vec3(-0.5f), vec3(_volumeSize) - 0.5f);
+	float tEnter = max(tRange.x, 0.0f);
+	for(int i = 0; i < 3; ++i)
+	{
+		_packet.origin[i][_lane] = origin[i];
+		_packet.dir[i][_lane] = dir[i];
+	}
+	_packet.invDir[_lane] = invDir;
+	_packet.tEnter[_lane] = tEnter;
+	_packet.numSamples[_lane] = max(0.0f, ceil((tRange.y - tEnter) / _stepSize - 0.5f));
+}
+
+static void marchPacket(const Volume& _volume, const BrickPyramid& _pyramid, ProjectionMode _mode,
+	float _stepSize, const RayPacket& _packet, float* _out, int _numLanes)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 step = _mm_set1_ps(_stepSize);
+	const __m128 tEnter = _mm_load_ps(_packet.tEnter);
+	const __m128 numSamples = _mm_load_ps(_packet.numSamples);
+	__m128 origin[3], dir[3], maxCoord[3];
+	for(int i = 0; i < 3; ++i)
+	{
+		origin[i] = _mm_load_ps(_packet.origin[i]);
+		dir[i] = _mm_load_ps(_packet.dir[i]);
+		maxCoord[i] = _mm_set1_ps(float(_volume.size()[i] - 1));
+	}
+
+	alignas(16) float index[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	alignas(16) float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	alignas(16) float lum[4];
+	alignas(16) int voxel[3][4];
+	ivec3 lastBrick[4] = {ivec3(-1), ivec3(-1), ivec3(-1), ivec3(-1)};
+	__m128 accV = zero;
+
+	while(true)
+	{
+		__m128 i = _mm_load_ps(index);
+		int activeMask = _mm_movemask_ps(_mm_cmplt_ps(i, numSamples));
+		if(!activeMask)
+			break;
+
+		// voxel = clamp(floor(origin + t * dir + 0.5), 0, size - 1) for all lanes
+		__m128 t = _mm_add_ps(tEnter, _mm_mul_ps(_mm_add_ps(i, half), step));
+		for(int c = 0; c < 3; ++c)
+		{
+			__m128 p = _mm_add_ps(_mm_add_ps(origin[c], _mm_mul_ps(t, dir[c])), half);
+			p = _mm_min_ps(_mm_max_ps(p, zero), maxCoord[c]);
+			_mm_store_si128(reinterpret_cast<__m128i*>(voxel[c]), _mm_cvttps_epi32(p));
+		}
+
+		// Scalar part: empty space skipping and the gather of the samples.
+		for(int l = 0; l < 4; ++l)
+		{
+			lum[l] = 0.0f;
+			if(!(activeMask & (1 << l)))
+				continue;
+			ivec3 v(voxel[0][l], voxel[1][l], voxel[2][l]);
+			ivec3 brick = v / BrickPyramid::BRICK_SIZE;
+			if(brick != lastBrick[l])
+			{
+				lastBrick[l] = brick;
+				vec3 o(_packet.origin[0][l], _packet.origin[1][l], _packet.origin[2][l]);
+				float tSkip = findSkipDistance(_pyramid, _mode, brick, acc[l], o, _packet.invDir[l]);
+				if(tSkip >= 0.0f)
+				{
+					index[l] = max(index[l] + 1.0f, ceil((tSkip - _packet.tEnter[l]) / _stepSize - 0.5f));
+					continue;
+				}
+			}
+			lum[l] = float(_volume.at(v.x, v.y, v.z));
+			index[l] += 1.0f;
+		}
+
+		// Skipped and finished lanes add 0 which is neutral for max and sum.
+		__m128 samples = _mm_load_ps(lum);
+		if(_mode == ProjectionMode::MAXIMUM)
+			accV = _mm_max_ps(accV, samples);
+		else
+			accV = _mm_add_ps(accV, samples);
+		_mm_store_ps(acc, accV);
+	}
+
+	if(_mode == ProjectionMode::AVERAGE)
+	{
+		__m128 valid = _mm_cmpgt_ps(numSamples, zero);
+		accV = _mm_and_ps(valid, _mm_div_ps(accV, _mm_max_ps(numSamples, _mm_set1_ps(1.0f))));
+	}
+	_mm_store_ps(acc, _mm_mul_ps(accV, _mm_set1_ps(1.0f / 255.0f)));
+	for(int l = 0; l < _numLanes; ++l)
+		_out[l] = acc[l];
+}
+
+void renderProjectionCPU(const Volume& _volume, const BrickPyramid& _pyramid, ProjectionMode _mode,
+	const mat4& _viewProjection, float _stepSize, int _width, int _height, float* _out)
+{
+	mat4 invViewProjection = inverse(_viewProjection);
+	parallelFor(0, _height, [&](int y) {
+		float ndcY = (y + 0.5f) / _height * 2.0f - 1.0f;
+		for(int x = 0; x < _width; x += 4)
+		{
+			RayPacket packet;
+			int numLanes = min(4, _width - x);
+			for(int l = 0; l < 4; ++l)
+			{
+				// Lanes outside the image get a ray which misses the volume.
+				float ndcX = (min(x + l, _width - 1) + 0.5f) / _width * 2.0f - 1.0f;
+				setupRay(packet, l, invViewProjection, _volume.size(), _stepSize, ndcX, ndcY);
+				if(l >= numLanes) packet.numSamples[l] = 0.0f;
+			}
+			marchPacket(_volume, _pyramid, _mode, _stepSize, packet, _out + size_t(y) * _width + x, numLanes);
+		}
+	});
+}
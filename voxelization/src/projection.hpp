@@ -0,0 +1,44 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/mat4x4.hpp>
+#include "volume.hpp"
+
+enum class ProjectionMode
+{
+	MAXIMUM = 0,	///< Maximum intensity projection (MIP)
+	AVERAGE = 1		///< Average intensity projection (AIP)
+};
+
+// Ray marches the luminance volume and accumulates the maximum or the mean
+// along each view ray. Bricks which cannot change the result (max not
+// larger than the current ray maximum, or empty for the average) are
+// skipped with the help of the BrickPyramid.
+class ProjectionRenderer
+{
+public:
+	ProjectionRenderer(const Volume& _volume, const BrickPyramid& _pyramid, gpupro::ProgramCache& _programs);
+
+	// Draw a full screen pass into the current framebuffer.
+	void draw(gpupro::OGLContext& _context, ProjectionMode _mode, const glm::mat4& _viewProjection);
+
+	// Distance between two samples along a ray in voxels.
+	float stepSize() const { return m_stepSize; }
+private:
+	gpupro::Texture m_luminance;
+	gpupro::Texture m_brickMinMax;
+	gpupro::Buffer m_uniforms;
+	gpupro::ProgramVariants m_programs;	///< One program per ProjectionMode
+	gpupro::Pipeline m_pipeline;
+	glm::ivec3 m_volumeSize;
+	int m_numLevels;
+	float m_stepSize;
+};
+
+// CPU implementation of the same kernel as projection.frag for headless use
+// and for validation of the GPU results. Packets of 4 rays are marched with
+// SSE and rows are distributed over all cores.
+// _out: _width * _height values in [0,1]. Rows are stored bottom to top like
+//		in glReadPixels.
+void renderProjectionCPU(const Volume& _volume, const BrickPyramid& _pyramid, ProjectionMode _mode,
+	const glm::mat4& _viewProjection, float _stepSize, int _width, int _height, float* _out);
@@ -0,0 +1,176 @@
+#include "roi.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <cmath>
+
+using namespace gpupro;
+using namespace glm;
+
+RegionOfInterest::RegionOfInterest(const ivec3& _volumeSize) :
+	m_volumeSize(_volumeSize),
+	m_version(0)
+{
+	reset();
+}
+
+void RegionOfInterest::setBox(const ivec3& _min, const ivec3& _max)
+{
+	m_boxMin = clamp(_min, ivec3(0), m_volumeSize);
+	m_boxMax = clamp(_max, m_boxMin, m_volumeSize);
+	++m_version;
+}
+
+bool RegionOfInterest::addClipPlane(const vec4& _plane)
+{
+	if(m_numClipPlanes == MAX_CLIP_PLANES)
+		return false;
+	m_clipPlanes[m_numClipPlanes++] = _plane;
+	++m_version;
+	return true;
+}
+
+void RegionOfInterest::setClipPlane(int _index, const vec4& _plane)
+{
+	m_clipPlanes[_index] = _plane;
+	++m_version;
+}
+
+void RegionOfInterest::removeClipPlane()
+{
+	if(m_numClipPlanes > 0)
+	{
+		--m_numClipPlanes;
+		++m_version;
+	}
+}
+
+void RegionOfInterest::reset()
+{
+	m_boxMin = ivec3(0);
+	m_boxMax = m_volumeSize;
+	m_numClipPlanes = 0;
+	++m_version;
+}
+
+bool RegionOfInterest::containsVoxel(const ivec3& _voxel) const
+{
+	if(any(lessThan(_voxel, m_boxMin)) || any(greaterThanEqual(_voxel, m_boxMax)))
+		return false;
+	for(int i = 0; i < m_numClipPlanes; ++i)
+		if(dot(vec3(m_clipPlanes[i]), vec3(_voxel)) + m_clipPlanes[i].w < 0.0f)
+			return false;
+	return true;
+}
+
+bool RegionOfInterest::intersects(const ivec3& _lo, const ivec3& _hi) const
+{
+	ivec3 lo = max(_lo, m_boxMin);
+	ivec3 hi = min(_hi, m_boxMax);
+	if(any(greaterThanEqual(lo, hi)))
+		return false;
+	// Test the voxel center which is furthest in direction of the normal
+	for(int i = 0; i < m_numClipPlanes; ++i)
+	{
+		vec3 corner = mix(vec3(lo), vec3(hi - 1), greaterThanEqual(vec3(m_clipPlanes[i]), vec3(0.0f)));
+		if(dot(vec3(m_clipPlanes[i]), corner) + m_clipPlanes[i].w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+void RegionOfInterest::rowRange(int _y, int _z, int& _x0, int& _x1) const
+{
+	_x0 = m_boxMin.x;
+	_x1 = m_boxMax.x;
+	if(_y < m_boxMin.y || _y >= m_boxMax.y || _z < m_boxMin.z || _z >= m_boxMax.z)
+	{
+		_x1 = _x0;
+		return;
+	}
+	// Each plane is a half line along the row: a * x + c >= 0. The rounded
+	// bounds are corrected with the same test as in containsVoxel().
+	for(int i = 0; i < m_numClipPlanes && _x0 < _x1; ++i)
+	{
+		const vec4& plane = m_clipPlanes[i];
+		auto inside = [&](int _x) { return dot(vec3(plane), vec3(float(_x), float(_y), float(_z))) + plane.w >= 0.0f; };
+		float a = plane.x;
+		float c = plane.y * _y + plane.z * _z + plane.w;
+		if(a > 0.0f)
+		{
+			int x = int(std::ceil(clamp(-c / a, -1.0f, float(m_volumeSize.x))));
+			if(inside(x - 1)) --x;
+			else if(!inside(x)) ++x;
+			_x0 = max(_x0, x);
+		} else if(a < 0.0f) {
+			int x = int(std::floor(clamp(-c / a, -1.0f, float(m_volumeSize.x))));
+			if(inside(x + 1)) ++x;
+			else if(!inside(x)) --x;
+			_x1 = min(_x1, x + 1);
+		} else if(!inside(_x0))
+			_x1 = _x0;
+	}
+}
+
+
+// ************************************************************************* //
+VoxelDrawRanges::VoxelDrawRanges(const BrickPyramid& _pyramid, const ivec3& _volumeSize) :
+	m_pyramid(_pyramid),
+	m_volumeSize(_volumeSize),
+	m_numDrawnVoxels(0),
+	m_roiVersion(0),
+	m_threshold(-1)
+{
+}
+
+void VoxelDrawRanges::update(const RegionOfInterest& _roi, int _threshold)
+{
+	if(_roi.version() == m_roiVersion && _threshold == m_threshold)
+		return;
+	m_roiVersion = _roi.version();
+	m_threshold = _threshold;
+
+	// Extent of the non-empty bricks for each row of bricks.
+	const int BRICK_SIZE = BrickPyramid::BRICK_SIZE;
+	const ivec3& numBricks = m_pyramid.levelSize(0);
+	std::vector<ivec2> brickRowExtent(size_t(numBricks.y) * numBricks.z);
+	parallelFor(0, numBricks.y * numBricks.z, [&](int row) {
+		ivec3 brick(0, row % numBricks.y, row / numBricks.y);
+		ivec2 extent(numBricks.x, 0);
+		for(brick.x = 0; brick.x < numBricks.x; ++brick.x)
+			if(m_pyramid.minMax(0, brick).y >= _threshold)
+				extent = ivec2(min(extent.x, brick.x), brick.x + 1);
+		brickRowExtent[row] = extent * BRICK_SIZE;
+	}, 64);
+
+	// Voxel range of each row, then compact the non-empty ones in order.
+	int numRows = m_volumeSize.y * m_volumeSize.z;
+	std::vector<ivec2> rowRange(numRows);
+	parallelFor(0, numRows, [&](int row) {
+		int y = row % m_volumeSize.y;
+		int z = row / m_volumeSize.y;
+		ivec2 range;
+		_roi.rowRange(y, z, range.x, range.y);
+		const ivec2& extent = brickRowExtent[y / BRICK_SIZE + size_t(numBricks.y) * (z / BRICK_SIZE)];
+		rowRange[row] = ivec2(max(range.x, extent.x), min(range.y, extent.y));
+	}, 256);
+
+	m_first.clear();
+	m_count.clear();
+	m_numDrawnVoxels = 0;
+	for(int row = 0; row < numRows; ++row)
+	{
+		const ivec2& range = rowRange[row];
+		if(range.x >= range.y)
+			continue;
+		m_first.push_back(GLint(range.x + size_t(m_volumeSize.x) * row));
+		m_count.push_back(range.y - range.x);
+		m_numDrawnVoxels += range.y - range.x;
+	}
+}
+
+void VoxelDrawRanges::draw() const
+{
+	if(!m_first.empty())
+		glMultiDrawArrays(GL_POINTS, m_first.data(), m_count.data(), GLsizei(m_first.size()));
+}
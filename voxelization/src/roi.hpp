@@ -0,0 +1,81 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "volume.hpp"
+
+// Region of interest: an axis aligned voxel box [boxMin, boxMax) and up to
+// MAX_CLIP_PLANES clip planes. A voxel is inside if it is inside the box and
+// its center p satisfies dot(plane.xyz, p) + plane.w >= 0 for all planes.
+class RegionOfInterest
+{
+public:
+	static const int MAX_CLIP_PLANES = 6;
+
+	// Initially the region is the entire volume.
+	RegionOfInterest(const glm::ivec3& _volumeSize);
+
+	// Set the box (clamped to the volume).
+	void setBox(const glm::ivec3& _min, const glm::ivec3& _max);
+	const glm::ivec3& boxMin() const { return m_boxMin; }
+	const glm::ivec3& boxMax() const { return m_boxMax; }
+
+	// Returns false if all planes are in use.
+	bool addClipPlane(const glm::vec4& _plane);
+	void setClipPlane(int _index, const glm::vec4& _plane);
+	// Remove the plane which was added last.
+	void removeClipPlane();
+	int numClipPlanes() const { return m_numClipPlanes; }
+	const glm::vec4& clipPlane(int _index) const { return m_clipPlanes[_index]; }
+	const glm::vec4* clipPlanes() const { return m_clipPlanes; }
+
+	// Reset to the entire volume without clip planes.
+	void reset();
+	// True if nothing is cropped.
+	bool isEntireVolume() const { return m_boxMin == glm::ivec3(0) && m_boxMax == m_volumeSize && m_numClipPlanes == 0; }
+	// Counter which changes on every modification.
+	unsigned version() const { return m_version; }
+
+	bool containsVoxel(const glm::ivec3& _voxel) const;
+	// Conservative test if any voxel of the range [_lo, _hi) is inside.
+	bool intersects(const glm::ivec3& _lo, const glm::ivec3& _hi) const;
+	// Get the voxels [_x0, _x1) of a row which are inside. _x0 >= _x1 if
+	// the row is outside.
+	void rowRange(int _y, int _z, int& _x0, int& _x1) const;
+private:
+	glm::ivec3 m_volumeSize;
+	glm::ivec3 m_boxMin;
+	glm::ivec3 m_boxMax;
+	glm::vec4 m_clipPlanes[MAX_CLIP_PLANES];
+	int m_numClipPlanes;
+	unsigned m_version;
+};
+
+// Draw calls of the voxel renderer (one point per voxel, the vertex id is
+// the voxel index). Only rows inside the region of interest are drawn and
+// each row is trimmed to its first and last non-empty brick, so the work
+// shrinks with the region instead of discarding voxels in the shader.
+class VoxelDrawRanges
+{
+public:
+	// The pyramid must outlive this object.
+	VoxelDrawRanges(const BrickPyramid& _pyramid, const glm::ivec3& _volumeSize);
+
+	// Rebuild the ranges if the region or the (quantized) threshold changed.
+	void update(const RegionOfInterest& _roi, int _threshold);
+
+	// Issue a single multi draw of all ranges.
+	void draw() const;
+
+	size_t numDrawnVoxels() const { return m_numDrawnVoxels; }
+	size_t numRanges() const { return m_first.size(); }
+private:
+	const BrickPyramid& m_pyramid;
+	glm::ivec3 m_volumeSize;
+	std::vector<GLint> m_first;
+	std::vector<GLsizei> m_count;
+	size_t m_numDrawnVoxels;
+	unsigned m_roiVersion;
+	int m_threshold;
+};
@@ -0,0 +1,93 @@
+#include "shadowvolume.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+#include <chrono>
+
+using namespace gpupro;
+using namespace glm;
+
+ShadowVolume::ShadowVolume(const Volume& _volume, const OccupancyMask& _occupancy) :
+	m_volume(_volume),
+	m_occupancy(_occupancy),
+	m_visibility(_volume.numVoxels(), 255),
+	m_texture(Texture::Layout::TEX_3D, _volume.size().x, _volume.size().y, _volume.size().z, InternalFormat::R8, 1),
+	m_lightDir(0.0f),
+	m_threshold(-1)
+{
+}
+
+void ShadowVolume::update(const vec3& _lightDir)
+{
+	int threshold = m_occupancy.threshold();
+	if(threshold == m_threshold && _lightDir == m_lightDir)
+		return;
+	m_threshold = threshold;
+	m_lightDir = _lightDir;
+
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	// Slices are perpendicular to the major axis a. u and v are the
+	// coordinates within a slice.
+	const ivec3& size = m_volume.size();
+	vec3 absDir = abs(_lightDir);
+	int a = (absDir.x >= absDir.y && absDir.x >= absDir.z) ? 0 : (absDir.y >= absDir.z ? 1 : 2);
+	int u = (a + 1) % 3;
+	int v = (a + 2) % 3;
+	// Direction of the previous slice (towards the light) and the offset of
+	// the light ray within the previous slice.
+	int step = _lightDir[a] > 0.0f ? 1 : -1;
+	float du = _lightDir[u] / absDir[a];
+	float dv = _lightDir[v] / absDir[a];
+	int first = step > 0 ? size[a] - 1 : 0;
+
+	// Transmittance behind the previous and the current slice, they swap
+	// roles with every slice. Everything outside of the volume is lit.
+	std::vector<float> transmittances[2] = {
+		std::vector<float>(size_t(size[u]) * size[v], 1.0f),
+		std::vector<float>(size_t(size[u]) * size[v])
+	};
+
+	// One set of threads for the entire sweep, the rows of a slice are
+	// distributed and the threads wait for each other between slices.
+	parallelSteps(size[a], 0, size[v], [&](int n, int j) {
+		const std::vector<float>& prev = transmittances[n & 1];
+		std::vector<float>& cur = transmittances[(n + 1) & 1];
+		auto transmittance = [&](int _i, int _j) {
+			if(_i < 0 || _j < 0 || _i >= size[u] || _j >= size[v])
+				return 1.0f;
+			return prev[_i + size_t(size[u]) * _j];
+		};
+
+		int s = first - n * step;
+		float qv = j + dv;
+		int j0 = int(floor(qv));
+		float fv = qv - j0;
+		for(int i = 0; i < size[u]; ++i)
+		{
+			// Bilinear lookup where the light ray intersects the previous slice
+			float qu = i + du;
+			int i0 = int(floor(qu));
+			float fu = qu - i0;
+			float vis = mix(mix(transmittance(i0, j0), transmittance(i0 + 1, j0), fu),
+				mix(transmittance(i0, j0 + 1), transmittance(i0 + 1, j0 + 1), fu), fv);
+
+			ivec3 voxel;
+			voxel[a] = s;
+			voxel[u] = i;
+			voxel[v] = j;
+			size_t idx = m_volume.index(voxel.x, voxel.y, voxel.z);
+			m_visibility[idx] = uint8_t(vis * 255.0f + 0.5f);
+			cur[i + size_t(size[u]) * j] = m_occupancy.isOccupied(voxel.x, voxel.y, voxel.z) ? 0.0f : vis;
+		}
+	});
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	m_texture.setData(0, 0, SetDataFormat::R, SetDataType::UINT8, m_visibility.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "\nINF: Light sweep took "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms\n";
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include "volume.hpp"
+#include "occupancy.hpp"
+
+// Fraction of the directional light which reaches each voxel (R8 3D texture).
+// The volume is swept slice by slice along the major axis of the light
+// direction, starting at the side facing the light. Each slice only depends
+// on the previous one (bilinear lookup of its transmittance), so the voxels
+// within a slice are processed in parallel.
+class ShadowVolume
+{
+public:
+	// The volume and mask must outlive this object.
+	ShadowVolume(const Volume& _volume, const OccupancyMask& _occupancy);
+
+	// Redo the sweep if the light direction or the mask's threshold changed.
+	// Call after OccupancyMask::update().
+	// _lightDir: normalized direction towards the light.
+	void update(const glm::vec3& _lightDir);
+
+	void bindAsTexture(GLuint _bindingIndex) { m_texture.bindAsTexture(_bindingIndex); }
+	gpupro::Texture& texture() { return m_texture; }
+private:
+	const Volume& m_volume;
+	const OccupancyMask& m_occupancy;
+	std::vector<uint8_t> m_visibility;
+	gpupro::Texture m_texture;
+	glm::vec3 m_lightDir;
+	int m_threshold;				///< Quantized threshold of the current data, -1 if nothing was computed
+};
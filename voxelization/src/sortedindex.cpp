@@ -0,0 +1,97 @@
+#include "sortedindex.hpp"
+#include "parallel.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <limits>
+
+using namespace gpupro;
+
+// Counting sort by the single byte key. Each chunk of voxels builds its own
+// histogram, the exclusive prefix sum over (key, chunk) gives every chunk a
+// private output range per key, so the scatter needs no synchronization and
+// keeps the index order within a key.
+std::vector<uint32_t> sortByLuminance(const uint8_t* _luminance, size_t _numVoxels, std::vector<uint32_t>& _offsets)
+{
+	auto time_start = std::chrono::high_resolution_clock::now();
+	const int numChunks = int(numWorkerThreads()) * 4;
+	const size_t chunkSize = (_numVoxels + numChunks - 1) / numChunks;
+
+	std::vector<uint32_t> histograms(size_t(numChunks) * 256, 0);
+	parallelFor(0, numChunks, [&](int c) {
+		uint32_t* histogram = &histograms[size_t(c) * 256];
+		size_t end = std::min(_numVoxels, (c + 1) * chunkSize);
+		for(size_t i = c * chunkSize; i < end; ++i)
+			++histogram[_luminance[i]];
+	});
+
+	_offsets.assign(257, 0);
+	uint32_t sum = 0;
+	for(int key = 0; key < 256; ++key)
+	{
+		_offsets[key] = sum;
+		for(int c = 0; c < numChunks; ++c)
+		{
+			uint32_t count = histograms[size_t(c) * 256 + key];
+			histograms[size_t(c) * 256 + key] = sum;
+			sum += count;
+		}
+	}
+	_offsets[256] = sum;
+
+	std::vector<uint32_t> sorted(_numVoxels);
+	parallelFor(0, numChunks, [&](int c) {
+		uint32_t* position = &histograms[size_t(c) * 256];
+		size_t end = std::min(_numVoxels, (c + 1) * chunkSize);
+		for(size_t i = c * chunkSize; i < end; ++i)
+			sorted[position[_luminance[i]]++] = uint32_t(i);
+	});
+
+	auto time_end = std::chrono::high_resolution_clock::now();
+	std::cerr << "INF: Sorted " << _numVoxels << " voxels by luminance in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms ("
+		<< _numVoxels * sizeof(uint32_t) / (1024 * 1024) << " MB index buffer)\n";
+	return sorted;
+}
+
+// The index must fit into one shader storage block (voxel_sorted.vert reads
+// it as an unsized array). If it does not, drop the darkest voxels: they are
+// the prefix of the list and the first to be culled by any threshold.
+static size_t clampToStorageBlock(size_t _numVoxels)
+{
+	GLint64 maxBlockSize = 0;
+	glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+	size_t maxVoxels = std::min(size_t(maxBlockSize) / sizeof(uint32_t), size_t(std::numeric_limits<GLint>::max()));
+	if(_numVoxels <= maxVoxels)
+		return 0;
+	std::cerr << "WAR: The sorted voxel index (" << GLsizeiptr(_numVoxels) * sizeof(uint32_t) / (1024 * 1024)
+		<< " MB) exceeds GL_MAX_SHADER_STORAGE_BLOCK_SIZE (" << maxBlockSize / (1024 * 1024)
+		<< " MB). The " << _numVoxels - maxVoxels << " darkest voxels are never drawn by the sorted path.\n";
+	return _numVoxels - maxVoxels;
+}
+
+SortedVoxelIndex::SortedVoxelIndex(const Volume& _volume)
+{
+	std::vector<uint32_t> sorted = sortByLuminance(_volume.data(), _volume.numVoxels(), m_offsets);
+	m_firstStored = uint32_t(clampToStorageBlock(sorted.size()));
+	m_buffer = std::make_unique<Buffer>(Buffer::Type::SHADER_STORAGE, GLuint(sizeof(uint32_t)),
+		GLuint(sorted.size() - m_firstStored), Buffer::Usage(), sorted.data() + m_firstStored);
+}
+
+void SortedVoxelIndex::visibleRange(int _threshold, GLint& _first, GLsizei& _count) const
+{
+	// The offset table replaces a binary search over the sorted keys.
+	// Positions are relative to the stored (possibly clamped) part of the list.
+	uint32_t first = std::max(m_offsets[std::min(std::max(_threshold, 0), 256)], m_firstStored);
+	_first = GLint(first - m_firstStored);
+	_count = GLsizei(m_offsets[256] - first);
+}
+
+void SortedVoxelIndex::draw(int _threshold) const
+{
+	GLint first;
+	GLsizei count;
+	visibleRange(_threshold, first, count);
+	if(count > 0)
+		glDrawArrays(GL_POINTS, first, count);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include "volume.hpp"
+
+// Sort the indices of _numVoxels luminance values (ascending, stable).
+// _offsets: first sorted position of each luminance (257 entries).
+std::vector<uint32_t> sortByLuminance(const uint8_t* _luminance, size_t _numVoxels, std::vector<uint32_t>& _offsets);
+
+// All voxel indices sorted by their 8-bit luminance (ascending, stable). The
+// voxels which pass a threshold are a suffix of this list, so a threshold
+// change costs nothing and a draw only touches the visible voxels.
+// The list is stored in a shader storage buffer for voxel_sorted.vert.
+// It is dense: 4 bytes per voxel of the whole volume, independent of the
+// brick budget and of the occupancy. Lists larger than
+// GL_MAX_SHADER_STORAGE_BLOCK_SIZE lose their darkest voxels.
+class SortedVoxelIndex
+{
+public:
+	// Sort the voxels once with a parallel radix (counting) sort.
+	SortedVoxelIndex(const Volume& _volume);
+
+	// Get the range [_first, _first + _count) of the voxels with luminance
+	// >= _threshold (quantized, see Volume::quantizeThreshold).
+	void visibleRange(int _threshold, GLint& _first, GLsizei& _count) const;
+	// Draw one point per visible voxel.
+	void draw(int _threshold) const;
+
+	size_t memoryUsage() const { return size_t(m_buffer->size()); }
+	void bindAsShaderStorageBuffer(GLuint _bindingIndex) { m_buffer->bindAsShaderStorageBuffer(_bindingIndex); }
+	// Per instance voxel indices for the InstancedCubeRenderer.
+	void bindAsVertexBuffer(GLuint _bindingIndex) { m_buffer->bindAsVertexBuffer(_bindingIndex); }
+	gpupro::Buffer& buffer() { return *m_buffer; }
+private:
+	std::vector<uint32_t> m_offsets;	///< First sorted position of each luminance (257 entries)
+	uint32_t m_firstStored;				///< Sorted position of the first voxel in m_buffer
+	std::unique_ptr<gpupro::Buffer> m_buffer;
+};
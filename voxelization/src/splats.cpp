@@ -0,0 +1,136 @@
+#include "splats.hpp"
+#include "parallel.hpp"
+
+#include <glm/glm.hpp>
+#include <iostream>
+
+using namespace gpupro;
+using namespace glm;
+
+struct SplatUniforms
+{
+	mat4 invViewProjection;
+	vec2 viewportSize;
+	float cellSize;
+	int level;
+	ivec3 levelSize;
+	int padding;
+	ivec3 roiMin;
+	int numClipPlanes;
+	ivec3 roiMax;
+	int padding2;
+	vec4 clipPlanes[RegionOfInterest::MAX_CLIP_PLANES];
+};
+
+PointSplatRenderer::PointSplatRenderer(const Volume& _volume, SortedVoxelIndex& _sortedVoxels, ProgramCache& _programs,
+	const Shader::Defines& _atlasFormat) :
+	m_volumeSize(_volume.size()),
+	m_sortedVoxels(_sortedVoxels),
+	m_uniforms(Buffer::Type::UNIFORM, sizeof(SplatUniforms), 1, Buffer::Usage::SUB_DATA_UPDATE),
+	m_linearSampler(SamplerState::Filter::LINEAR, SamplerState::Filter::LINEAR, SamplerState::Filter::NONE,
+		1.0f, SamplerState::DepthCompareFunc::DISABLE, SamplerState::BorderHandling::CLAMP)
+{
+	// Maximum of 2x2x2 cells of the previous level
+	std::vector<uint8_t> previous(_volume.data(), _volume.data() + _volume.numVoxels());
+	ivec3 previousSize = m_volumeSize;
+	while(int(m_levels.size()) + 1 < MAX_LEVELS && any(greaterThan(previousSize, ivec3(1))))
+	{
+		Level level;
+		level.size = (previousSize + 1) / 2;
+		std::vector<uint8_t> luminance(size_t(level.size.x) * level.size.y * level.size.z);
+		parallelFor(0, level.size.z, [&](int z) {
+			for(int y = 0; y < level.size.y; ++y)
+				for(int x = 0; x < level.size.x; ++x)
+				{
+					uint8_t maximum = 0;
+					for(int c = 0; c < 8; ++c)
+					{
+						ivec3 p = ivec3(x, y, z) * 2 + ivec3(c & 1, (c >> 1) & 1, c >> 2);
+						if(all(lessThan(p, previousSize)))
+							maximum = std::max(maximum, previous[p.x + size_t(previousSize.x) * (p.y + size_t(previousSize.y) * p.z)]);
+					}
+					luminance[x + size_t(level.size.x) * (y + size_t(level.size.y) * z)] = maximum;
+				}
+		});
+
+		std::vector<uint32_t> sorted = sortByLuminance(luminance.data(), luminance.size(), level.offsets);
+		std::vector<uvec2> cells(sorted.size());
+		for(size_t i = 0; i < sorted.size(); ++i)
+			cells[i] = uvec2(sorted[i], luminance[sorted[i]]);
+		level.cells.reset(new Buffer(Buffer::Type::SHADER_STORAGE, sizeof(uvec2), GLuint(cells.size()), Buffer::Usage(), cells.data()));
+		m_levels.push_back(std::move(level));
+
+		previous.swap(luminance);
+		previousSize = m_levels.back().size;
+	}
+	std::cerr << "INF: Built " << m_levels.size() << " coarse splat levels (" << memoryUsage() / (1024 * 1024) << " MB)\n";
+
+	m_program = _programs.load({
+		{Shader::Type::VERTEX, "shaders/splat.vert"},
+		{Shader::Type::FRAGMENT, "shaders/splat.frag"}
+	}, _atlasFormat);
+	m_pipeline.shader = &m_program;
+	m_pipeline.depthStencil.depthTest = true;
+	m_pipeline.samplerState[4] = &m_linearSampler;
+}
+
+GLsizei PointSplatRenderer::numVisible(int _level, int _threshold) const
+{
+	GLint first;
+	GLsizei count;
+	if(_level == 0)
+	{
+		m_sortedVoxels.visibleRange(_threshold, first, count);
+		return count;
+	}
+	const std::vector<uint32_t>& offsets = m_levels[_level - 1].offsets;
+	return GLsizei(offsets[256] - offsets[std::min(std::max(_threshold, 0), 256)]);
+}
+
+size_t PointSplatRenderer::memoryUsage() const
+{
+	size_t bytes = 0;
+	for(auto& level : m_levels)
+		bytes += level.offsets[256] * sizeof(uvec2);
+	return bytes;
+}
+
+void PointSplatRenderer::draw(OGLContext& _context, int _level, int _threshold, const mat4& _viewProjection,
+	const RegionOfInterest& _roi)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	SplatUniforms uniforms;
+	uniforms.invViewProjection = inverse(_viewProjection);
+	uniforms.viewportSize = vec2(float(viewport[2]), float(viewport[3]));
+	uniforms.cellSize = float(1 << _level);
+	uniforms.level = _level;
+	uniforms.levelSize = _level == 0 ? m_volumeSize : m_levels[_level - 1].size;
+	uniforms.roiMin = _roi.boxMin();
+	uniforms.roiMax = _roi.boxMax();
+	uniforms.numClipPlanes = _roi.numClipPlanes();
+	for(int i = 0; i < _roi.numClipPlanes(); ++i)
+		uniforms.clipPlanes[i] = _roi.clipPlane(i);
+	m_uniforms.subDataUpdate(0, sizeof(SplatUniforms), &uniforms);
+	m_uniforms.bindAsUniformBuffer(1);
+
+	GLint first;
+	GLsizei count;
+	if(_level == 0)
+	{
+		m_sortedVoxels.bindAsShaderStorageBuffer(1);
+		m_sortedVoxels.visibleRange(_threshold, first, count);
+	} else {
+		const Level& level = m_levels[_level - 1];
+		level.cells->bindAsShaderStorageBuffer(3);
+		first = GLint(level.offsets[std::min(std::max(_threshold, 0), 256)]);
+		count = GLsizei(level.offsets[256] - first);
+	}
+
+	_context.setState(m_pipeline);
+	// The sprite size is written by the vertex shader.
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	if(count > 0)
+		glDrawArrays(GL_POINTS, first, count);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <gpuproframework.hpp>
+#include <glm/mat4x4.hpp>
+#include <memory>
+#include "volume.hpp"
+#include "sortedindex.hpp"
+#include "roi.hpp"
+
+// Renders every visible voxel of a level of detail as a single point sprite.
+// Level 0 are the voxels of the SortedVoxelIndex, level l > 0 has cells of
+// 2^l voxels per axis with the maximum luminance of the covered voxels, so
+// a cell is occupied if any of its voxels is. Each coarse level is sorted
+// by luminance like the SortedVoxelIndex, the visible cells are a suffix.
+//
+// The sprite covers the projected bounding box of the cell. splat.frag
+// intersects the view ray with the cell's cube, discards misses and writes
+// the depth of the hit, so the occlusion between splats is correct.
+// The cells are cropped to the box of the region of interest, cells which
+// are entirely outside the box or a clip plane are dropped.
+class PointSplatRenderer
+{
+public:
+	static const int MAX_LEVELS = 5;
+
+	// The index must outlive this object.
+	// _atlasFormat: see BrickAtlas::formatDefines()
+	PointSplatRenderer(const Volume& _volume, SortedVoxelIndex& _sortedVoxels, gpupro::ProgramCache& _programs,
+		const gpupro::Shader::Defines& _atlasFormat);
+
+	int numLevels() const { return int(m_levels.size()) + 1; }
+	// Number of cells with luminance >= _threshold (quantized) on a level.
+	GLsizei numVisible(int _level, int _threshold) const;
+	// Bytes of the coarse levels (level 0 is the SortedVoxelIndex).
+	size_t memoryUsage() const;
+
+	// Draw the cells of _level inside _roi. The voxel atlas (0, 6), AO (3)
+	// and light visibility (4) textures and the transform UBO (0) must be
+	// bound.
+	void draw(gpupro::OGLContext& _context, int _level, int _threshold, const glm::mat4& _viewProjection,
+		const RegionOfInterest& _roi);
+private:
+	struct Level
+	{
+		glm::ivec3 size;
+		std::vector<uint32_t> offsets;			///< First sorted position of each luminance (257 entries)
+		std::unique_ptr<gpupro::Buffer> cells;	///< uvec2(cell index, luminance) sorted by luminance
+	};
+
+	glm::ivec3 m_volumeSize;
+	SortedVoxelIndex& m_sortedVoxels;
+	std::vector<Level> m_levels;				///< Levels 1 to numLevels() - 1
+	gpupro::Buffer m_uniforms;
+	gpupro::SamplerState m_linearSampler;
+	gpupro::Program m_program;
+	gpupro::Pipeline m_pipeline;
+};
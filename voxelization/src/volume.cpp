@@ -0,0 +1,154 @@
+#include "volume.hpp"
+#include "parallel.hpp"
+
+#include <gli/gli.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+
+using namespace glm;
+
+Volume::Volume(const gli::texture3d& _texture) :
+	m_size(_texture.extent(0))
+{
+	m_luminance.resize(size_t(m_size.x) * m_size.y * m_size.z);
+
+	// Same rules as fetchVoxelColor() and voxelLuminance() in
+	// shaders/include/voxelatlas.glsl: integer values are normalized by the
+	// channel maximum and single channels are gray.
+	const vec3 LUMINANCE_WEIGHTS(0.299f, 0.587f, 0.114f);
+	bool singleChannel = gli::component_count(_texture.format()) == 1;
+	int channelBits = integerChannelBits(_texture);
+	float scale = channelBits > 0 ? 1.0f / float((1ull << channelBits) - 1) : 1.0f;
+	gli::fsampler3D sampler(_texture, gli::WRAP_CLAMP_TO_EDGE);
+	parallelFor(0, m_size.z, [&](int z) {
+		for(int y = 0; y < m_size.y; ++y)
+		{
+			uint8_t* row = &m_luminance[index(0, y, z)];
+			for(int x = 0; x < m_size.x; ++x)
+			{
+				vec4 texel = sampler.texel_fetch(ivec3(x, y, z), 0) * scale;
+				float lum = clamp(singleChannel ? texel.r : dot(vec3(texel), LUMINANCE_WEIGHTS), 0.0f, 1.0f);
+				row[x] = uint8_t(lum * 255.0f + 0.5f);
+			}
+		}
+	});
+}
+
+int Volume::integerChannelBits(const gli::texture3d& _texture)
+{
+	if(!gli::is_integer(_texture.format()))
+		return 0;
+	// Signed formats would need an isampler3D and packed formats (e.g.
+	// RGB10A2UI) differ per channel.
+	switch(_texture.format())
+	{
+	case gli::FORMAT_R8_UINT_PACK8:
+	case gli::FORMAT_RG8_UINT_PACK8:
+	case gli::FORMAT_RGB8_UINT_PACK8:
+	case gli::FORMAT_BGR8_UINT_PACK8:
+	case gli::FORMAT_RGBA8_UINT_PACK8:
+	case gli::FORMAT_BGRA8_UINT_PACK8:
+	case gli::FORMAT_RGBA8_UINT_PACK32:
+		return 8;
+	case gli::FORMAT_R16_UINT_PACK16:
+	case gli::FORMAT_RG16_UINT_PACK16:
+	case gli::FORMAT_RGB16_UINT_PACK16:
+	case gli::FORMAT_RGBA16_UINT_PACK16:
+		return 16;
+	case gli::FORMAT_R32_UINT_PACK32:
+	case gli::FORMAT_RG32_UINT_PACK32:
+	case gli::FORMAT_RGB32_UINT_PACK32:
+	case gli::FORMAT_RGBA32_UINT_PACK32:
+		return 32;
+	default:
+		throw std::exception("Signed or packed integer textures are not supported");
+	}
+}
+
+int Volume::quantizeThreshold(float _threshold)
+{
+	return clamp(int(ceil(_threshold * 255.0f)), 0, 256);
+}
+
+
+BrickPyramid::BrickPyramid(const Volume& _volume) :
+	m_volumeSize(_volume.size())
+{
+	// Same level count and sizes as the GL mip chain.
+	ivec3 size = (m_volumeSize + BRICK_SIZE - 1) / BRICK_SIZE;
+	int maxSize = max(max(size.x, size.y), size.z);
+	int numLevels = 1;
+	while((maxSize /= 2) > 0) ++numLevels;
+	m_levelSizes.resize(numLevels);
+	m_levels.resize(numLevels);
+	for(int l = 0; l < numLevels; ++l)
+	{
+		m_levelSizes[l] = max(size >> l, ivec3(1));
+		m_levels[l].resize(size_t(m_levelSizes[l].x) * m_levelSizes[l].y * m_levelSizes[l].z);
+	}
+
+	// Level 0: reduce the voxels of each brick. One slab of bricks per task.
+	parallelFor(0, size.z, [&](int bz) {
+		for(int by = 0; by < size.y; ++by)
+			for(int bx = 0; bx < size.x; ++bx)
+			{
+				ivec3 lo = ivec3(bx, by, bz) * BRICK_SIZE;
+				ivec3 hi = min(lo + BRICK_SIZE, m_volumeSize);
+				uint8_t minLum = 255, maxLum = 0;
+				for(int z = lo.z; z < hi.z; ++z)
+					for(int y = lo.y; y < hi.y; ++y)
+					{
+						const uint8_t* row = _volume.data() + _volume.index(0, y, z);
+						for(int x = lo.x; x < hi.x; ++x)
+						{
+							minLum = std::min(minLum, row[x]);
+							maxLum = std::max(maxLum, row[x]);
+						}
+					}
+				m_levels[0][bx + size_t(size.x) * (by + size_t(size.y) * bz)] = u8vec2(minLum, maxLum);
+			}
+	});
+
+	// Further levels: reduce 2x2x2 children (3 for the last node of an odd size).
+	for(int l = 1; l < numLevels; ++l)
+	{
+		const ivec3& childSize = m_levelSizes[l - 1];
+		const ivec3& levelSize = m_levelSizes[l];
+		parallelFor(0, levelSize.z, [&](int z) {
+			for(int y = 0; y < levelSize.y; ++y)
+				for(int x = 0; x < levelSize.x; ++x)
+				{
+					ivec3 node(x, y, z);
+					ivec3 lo = node * 2;
+					ivec3 hi = min(lo + 2, childSize);
+					for(int i = 0; i < 3; ++i)
+						if(node[i] == levelSize[i] - 1) hi[i] = childSize[i];
+					u8vec2 mm(255, 0);
+					for(int cz = lo.z; cz < hi.z; ++cz)
+						for(int cy = lo.y; cy < hi.y; ++cy)
+							for(int cx = lo.x; cx < hi.x; ++cx)
+							{
+								const u8vec2& c = minMax(l - 1, ivec3(cx, cy, cz));
+								mm.x = std::min(mm.x, c.x);
+								mm.y = std::max(mm.y, c.y);
+							}
+					m_levels[l][x + size_t(levelSize.x) * (y + size_t(levelSize.y) * z)] = mm;
+				}
+		});
+	}
+}
+
+ivec3 BrickPyramid::nodeOf(const ivec3& _brick, int _level) const
+{
+	return min(_brick >> _level, m_levelSizes[_level] - 1);
+}
+
+void BrickPyramid::nodeBounds(int _level, const ivec3& _node, ivec3& _lo, ivec3& _hi) const
+{
+	_lo = (_node << _level) * BRICK_SIZE;
+	_hi = ((_node + 1) << _level) * BRICK_SIZE;
+	// The last node covers the rest of the volume.
+	for(int i = 0; i < 3; ++i)
+		if(_node[i] == m_levelSizes[_level][i] - 1) _hi[i] = m_volumeSize[i];
+	_hi = min(_hi, m_volumeSize);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace gli { class texture3d; }
+
+// CPU side copy of the volume. Only the luminance, which is used for the
+// thresholding (see voxel.geom), is kept with one byte per voxel.
+// The voxels are stored x-fastest which is the same order as the primitive
+// ids in the voxel renderer.
+class Volume
+{
+public:
+	// Convert the first mip level of a loaded texture. All uncompressed
+	// formats which can be fetched by gli are supported, except for signed
+	// and packed integer formats.
+	Volume(const gli::texture3d& _texture);
+
+	const glm::ivec3& size() const { return m_size; }
+	size_t numVoxels() const { return m_luminance.size(); }
+	size_t index(int _x, int _y, int _z) const { return _x + size_t(m_size.x) * (_y + size_t(m_size.y) * _z); }
+	uint8_t at(int _x, int _y, int _z) const { return m_luminance[index(_x, _y, _z)]; }
+	const uint8_t* data() const { return m_luminance.data(); }
+
+	// Bits per channel of unsigned integer formats, which are normalized by
+	// the channel maximum. 0 for normalized and float formats. Throws for
+	// signed and packed integer formats.
+	static int integerChannelBits(const gli::texture3d& _texture);
+
+	// Get the smallest 8-bit luminance which passes the test
+	// luminance >= _threshold. The result is 256 if no voxel can pass.
+	static int quantizeThreshold(float _threshold);
+private:
+	glm::ivec3 m_size;
+	std::vector<uint8_t> m_luminance;
+};
+
+// Hierarchy of min/max luminance values over bricks of BRICK_SIZE^3 voxels.
+// Level 0 has one node per brick and each further level halves the
+// resolution like a mip-map. Sizes are rounded down like the GL mip chain,
+// so the last node of an odd dimension covers three children. This allows
+// to upload the pyramid as mip levels of a single RG8 texture.
+class BrickPyramid
+{
+public:
+	static const int BRICK_SIZE = 8;
+
+	BrickPyramid(const Volume& _volume);
+
+	int numLevels() const { return int(m_levels.size()); }
+	const glm::ivec3& levelSize(int _level) const { return m_levelSizes[_level]; }
+	// Min (x) and max (y) luminance of all voxels inside a node.
+	const glm::u8vec2& minMax(int _level, const glm::ivec3& _node) const
+	{
+		const glm::ivec3& s = m_levelSizes[_level];
+		return m_levels[_level][_node.x + size_t(s.x) * (_node.y + size_t(s.y) * _node.z)];
+	}
+	const glm::u8vec2* levelData(int _level) const { return m_levels[_level].data(); }
+
+	// Get the node on _level which contains the level 0 brick _brick.
+	glm::ivec3 nodeOf(const glm::ivec3& _brick, int _level) const;
+	// Get the voxel range [_lo, _hi) which is covered by a node.
+	void nodeBounds(int _level, const glm::ivec3& _node, glm::ivec3& _lo, glm::ivec3& _hi) const;
+private:
+	glm::ivec3 m_volumeSize;
+	std::vector<glm::ivec3> m_levelSizes;
+	std::vector<std::vector<glm::u8vec2>> m_levels;
+};
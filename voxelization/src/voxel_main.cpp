@@ -6,8 +6,25 @@
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <random>
 #include <gli/gli.hpp>
 #include "DialogOpenFile.h"
+#include "volume.hpp"
+#include "projection.hpp"
+#include "ambientocclusion.hpp"
+#include "shadowvolume.hpp"
+#include "occupancy.hpp"
+#include "octree.hpp"
+#include "brickatlas.hpp"
+#include "roi.hpp"
+#include "picking.hpp"
+#include "sortedindex.hpp"
+#include "faceintervals.hpp"
+#include "instancedcubes.hpp"
+#include "splats.hpp"
+#include "feedbackcache.hpp"
+#include "labels.hpp"
+#include "multiview.hpp"
 
 using namespace gpupro;
 using namespace glm;
@@ -17,8 +34,15 @@ struct TransformUniforms
 	mat4 viewProjection;
 	vec3 cameraPosition;
 	float shadownTresh;
+	vec3 lightDirection;
+	float padding;
+	ivec3 volumeSize;
+	int padding2;
 };
 
+// GPU memory for the voxel colors (see BrickAtlas)
+static const size_t VOXEL_BRICK_BUDGET = size_t(512) * 1024 * 1024;
+
 static vec3 s_camPos;
 static vec3 s_camDir;
 static bool s_wDown = false;
@@ -28,6 +52,98 @@ static bool s_dDown = false;
 static bool s_spaceDown = false;
 static bool s_shiftDown = false;
 static float s_discardThresh = 0.01f;
+
+enum class RenderMode
+{
+	VOXELS,
+	MAXIMUM_PROJECTION,
+	AVERAGE_PROJECTION,
+	OCTREE,
+	FACE_CACHE,
+	INSTANCED_CUBES,
+	POINT_SPLATS,
+	CAPTURED_FACES,
+	MULTI_VIEW,
+	LABELS,
+	COUNT
+};
+static RenderMode s_renderMode = RenderMode::VOXELS;
+static bool s_compareProjection = false;
+static bool s_benchmarkPicking = false;
+static bool s_compareFaceCache = false;
+static bool s_benchmarkCubes = false;
+static bool s_benchmarkMultiView = false;
+static bool s_benchmarkStateChanges = false;
+// Level of detail of the point splats, 0 is one splat per voxel
+static int s_splatLevel = 0;
+// Label volumes (see LabelVolume) only
+static bool s_hasLabels = false;
+static bool s_hideLabel = false;
+static bool s_showAllLabels = false;
+
+static void nextRenderMode()
+{
+	do s_renderMode = RenderMode((int(s_renderMode) + 1) % int(RenderMode::COUNT));
+	while(s_renderMode == RenderMode::LABELS && !s_hasLabels);
+}
+static vec2 s_cursorPos;
+// Direction towards the light
+static vec3 s_lightDir = normalize(vec3(1.0f, 3.0f, 2.0f));
+
+static void rotateLight(float _angle, const vec3& _axis)
+{
+	s_lightDir = normalize(vec3(glm::rotate(mat4(), _angle, _axis) * vec4(s_lightDir, 0.0f)));
+}
+
+static void tiltLight(float _angle)
+{
+	// Stop before the light becomes vertical (undefined tilt axis)
+	vec3 axis = cross(s_lightDir, vec3(0.0f, 1.0f, 0.0f));
+	vec3 oldDir = s_lightDir;
+	if(length(axis) > 1e-3f)
+		rotateLight(_angle, normalize(axis));
+	if(length(cross(s_lightDir, vec3(0.0f, 1.0f, 0.0f))) < 0.05f)
+		s_lightDir = oldDir;
+}
+
+// Region of interest, created after loading the volume.
+static RegionOfInterest* s_roi = nullptr;
+// Selected face of the region box: 2 * axis + (0: min, 1: max)
+static int s_roiFace = 0;
+static const int ROI_STEP = 4;
+
+// Move the selected face of the region box, positive values shrink it.
+static void moveRoiFace(int _delta)
+{
+	if(!s_roi) return;
+	ivec3 boxMin = s_roi->boxMin();
+	ivec3 boxMax = s_roi->boxMax();
+	int axis = s_roiFace / 2;
+	if(s_roiFace % 2 == 0)
+		boxMin[axis] = std::min(boxMin[axis] + _delta, boxMax[axis]);
+	else boxMax[axis] = std::max(boxMax[axis] - _delta, boxMin[axis]);
+	s_roi->setBox(boxMin, boxMax);
+}
+
+// Add a clip plane through the center of the region box which removes the
+// half in front of the camera.
+static void addClipPlane()
+{
+	if(!s_roi) return;
+	vec3 normal = normalize(s_camDir);
+	vec3 center = vec3(s_roi->boxMin() + s_roi->boxMax() - 1) * 0.5f;
+	s_roi->addClipPlane(vec4(normal, -dot(normal, center)));
+}
+
+static void moveClipPlane(float _delta)
+{
+	if(!s_roi || s_roi->numClipPlanes() == 0) return;
+	int last = s_roi->numClipPlanes() - 1;
+	vec4 plane = s_roi->clipPlane(last);
+	plane.w -= _delta;
+	s_roi->setClipPlane(last, plane);
+}
+
 static void keyFunc(GLFWwindow * _window, int _key, int, int _action, int)
 {
 	if(_action == GLFW_PRESS)
@@ -43,6 +159,29 @@ static void keyFunc(GLFWwindow * _window, int _key, int, int _action, int)
 			case GLFW_KEY_LEFT_SHIFT: s_shiftDown = true; break;
 			case GLFW_KEY_R: s_discardThresh = std::max(s_discardThresh - 0.01f, 0.0f); break;
 			case GLFW_KEY_T: s_discardThresh = std::min(s_discardThresh + 0.01f, 0.99f); break;
+			case GLFW_KEY_P: nextRenderMode(); break;
+			case GLFW_KEY_C: s_compareProjection = true; break;
+			case GLFW_KEY_B: s_benchmarkPicking = true; break;
+			case GLFW_KEY_V: s_compareFaceCache = true; break;
+			case GLFW_KEY_X: s_benchmarkCubes = true; break;
+			case GLFW_KEY_Y: s_benchmarkMultiView = true; break;
+			case GLFW_KEY_Z: s_splatLevel = (s_splatLevel + 1) % PointSplatRenderer::MAX_LEVELS; break;
+			case GLFW_KEY_J: rotateLight(-0.1f, vec3(0.0f, 1.0f, 0.0f)); break;
+			case GLFW_KEY_L: rotateLight(0.1f, vec3(0.0f, 1.0f, 0.0f)); break;
+			case GLFW_KEY_I: tiltLight(-0.1f); break;
+			case GLFW_KEY_K: tiltLight(0.1f); break;
+			case GLFW_KEY_1: case GLFW_KEY_2: case GLFW_KEY_3:
+			case GLFW_KEY_4: case GLFW_KEY_5: case GLFW_KEY_6: s_roiFace = _key - GLFW_KEY_1; break;
+			case GLFW_KEY_N: moveRoiFace(ROI_STEP); break;
+			case GLFW_KEY_M: moveRoiFace(-ROI_STEP); break;
+			case GLFW_KEY_F: addClipPlane(); break;
+			case GLFW_KEY_G: if(s_roi) s_roi->removeClipPlane(); break;
+			case GLFW_KEY_Q: moveClipPlane(-float(ROI_STEP)); break;
+			case GLFW_KEY_E: moveClipPlane(float(ROI_STEP)); break;
+			case GLFW_KEY_O: if(s_roi) s_roi->reset(); break;
+			case GLFW_KEY_H: s_hideLabel = true; break;
+			case GLFW_KEY_U: s_showAllLabels = true; break;
+			case GLFW_KEY_7: s_benchmarkStateChanges = true; break;
 		}
 	}
 	else if(_action == GLFW_RELEASE)
@@ -98,6 +237,7 @@ static void mouseFunc(GLFWwindow * _window, double _x, double _y)
 	}
 	oldX = _x;
 	oldY = _y;
+	s_cursorPos = vec2(float(_x), float(_y));
 }
 
 static float s_camZoom = 4.0f;
@@ -106,6 +246,122 @@ static void scrollFunc(GLFWwindow *, double , double _sy)
 	s_camZoom = clamp(s_camZoom - 0.5f * (float)_sy, 1.0f, 6.0f);
 }
 
+// Read back the projection from the framebuffer and compute the same image
+// with the CPU kernel.
+static void compareProjectionWithCPU(const Volume& _volume, const BrickPyramid& _pyramid, ProjectionMode _mode,
+	const mat4& _viewProjection, float _stepSize)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = viewport[2], height = viewport[3];
+	std::vector<float> gpuImage(size_t(width) * height);
+	std::vector<float> cpuImage(size_t(width) * height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(viewport[0], viewport[1], width, height, GL_RED, GL_FLOAT, gpuImage.data());
+
+	auto time_start = std::chrono::high_resolution_clock::now();
+	renderProjectionCPU(_volume, _pyramid, _mode, _viewProjection, _stepSize, width, height, cpuImage.data());
+	auto time_end = std::chrono::high_resolution_clock::now();
+
+	// The framebuffer has 8 bit per channel. Everything above half a step
+	// is a real difference.
+	float maxError = 0.0f;
+	size_t numDifferent = 0;
+	for(size_t i = 0; i < gpuImage.size(); ++i)
+	{
+		float error = std::abs(gpuImage[i] - cpuImage[i]);
+		maxError = std::max(maxError, error);
+		if(error > 0.5f / 255.0f) ++numDifferent;
+	}
+	std::cerr << "\nINF: CPU projection " << width << 'x' << height << " took "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count() << " ms, max error "
+		<< maxError << ", " << numDifferent << " pixels differ\n";
+}
+
+// Draw all voxels with the geometry shader (sorted index) and with the face
+// interval cache several times and print the GPU times and memory of both.
+// All textures and buffers must be bound.
+static void compareFaceCache(OGLContext& _context, Pipeline& _voxelsPipe, const SortedVoxelIndex& _sortedVoxels,
+	Pipeline& _facesPipe, const FaceIntervalCache& _faceCache, const OccupancyMask& _occupancy)
+{
+	const int NUM_DRAWS = 20;
+	Query timer(Query::Type::TIME_ELAPSED);
+	double time[2];
+	for(int path = 0; path < 2; ++path)
+	{
+		_context.setState(path == 0 ? _voxelsPipe : _facesPipe);
+		double sum = 0.0;
+		for(int i = 0; i < NUM_DRAWS; ++i)
+		{
+			glClear(GL_DEPTH_BUFFER_BIT);
+			timer.begin();
+			if(path == 0) _sortedVoxels.draw(_occupancy.threshold());
+			else _faceCache.draw(_occupancy.threshold());
+			timer.end();
+			timer.receive();
+			sum += timer.latest();
+		}
+		time[path] = sum / NUM_DRAWS;
+	}
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	std::cerr << "\nINF: Voxel draw on GPU: geometry shader " << time[0] << " ms, face cache " << time[1]
+		<< " ms (" << _faceCache.numCandidateFaces(_occupancy.threshold()) << " of " << _faceCache.numFaces()
+		<< " faces drawn). Memory: sorted index + occupancy mask "
+		<< (_sortedVoxels.memoryUsage() + _occupancy.memoryUsage()) / (1024 * 1024) << " MB, face cache "
+		<< _faceCache.memoryUsage() / (1024 * 1024) << " MB\n";
+}
+
+// Switch between the pipelines with both variants of OGLContext::setState
+// and print the calls per second and the issued and skipped state changes.
+// Then compare the state changes of a frame with and without sorting the
+// render queue.
+static void benchmarkStateChanges(OGLContext& _context, const std::vector<Pipeline*>& _pipelines)
+{
+	const int NUM_CALLS = 1000000;
+	std::vector<PipelineStateBlock> blocks;
+	for(Pipeline* pipeline : _pipelines)
+		blocks.emplace_back(*pipeline);
+	for(int variant = 0; variant < 2; ++variant)
+	{
+		_context.resetStatistics();
+		auto time_start = std::chrono::high_resolution_clock::now();
+		for(int i = 0; i < NUM_CALLS; ++i)
+		{
+			// Every fourth call repeats the previous state
+			size_t index = (i - i / 4) % _pipelines.size();
+			if(variant == 0) _context.setState(*_pipelines[index]);
+			else _context.setState(blocks[index]);
+		}
+		auto time_end = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(time_end - time_start).count();
+		std::cerr << (variant == 0 ? "\nINF: setState(Pipeline): " : "INF: setState(PipelineStateBlock): ")
+			<< NUM_CALLS / seconds / 1e6 << " M calls/s, state changes issued: " << _context.statistics().issuedCalls
+			<< ", skipped: " << _context.statistics().skippedCalls << '\n';
+	}
+
+	// A synthetic frame of many small draws in random order through the
+	// render queue, the draws themselves are empty. The real frames of the
+	// viewer queue only a few draws, see the status line.
+	const int NUM_ITEMS = 10000;
+	RenderQueue queue;
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<size_t> randomBlock(0, blocks.size() - 1);
+	std::uniform_real_distribution<float> randomDepth(0.0f, 1000.0f);
+	for(int sorted = 0; sorted < 2; ++sorted)
+	{
+		for(int i = 0; i < NUM_ITEMS; ++i)
+			queue.submit(blocks[randomBlock(rng)], nullptr, [](){}, randomDepth(rng));
+		_context.resetStatistics();
+		auto time_start = std::chrono::high_resolution_clock::now();
+		queue.flush(_context, sorted != 0);
+		auto time_end = std::chrono::high_resolution_clock::now();
+		std::cerr << "INF: Render queue with " << NUM_ITEMS << (sorted ? " sorted" : " unsorted") << " items: "
+			<< std::chrono::duration<double, std::milli>(time_end - time_start).count() << " ms, setState calls "
+			<< queue.statistics().stateChangesSubmitted << " submitted / " << queue.statistics().stateChanges << " executed, state changes issued: "
+			<< _context.statistics().issuedCalls << '\n';
+	}
+	_context.resetStatistics();
+}
 
 int main()
 {
@@ -116,22 +372,71 @@ int main()
 		<< "  ESC:          quit program" << std::endl
 		<< "  WASD:         move camera" << std::endl
 		<< "  Space/Shift:  move camera up/down" << std::endl
-		<< "  Mouse:        change camera rotation (press left button)" << std::endl;
+		<< "  Mouse:        change camera rotation (press left button)" << std::endl
+		<< "  R/T:          decrease/increase discard threshold" << std::endl
+		<< "  P:            switch voxels/maximum projection/average projection/octree ray casting/face cache/instanced cubes/point splats/captured faces/multi view/labels" << std::endl
+		<< "  C:            compare the projection with the CPU implementation" << std::endl
+		<< "  B:            benchmark voxel picking with random rays" << std::endl
+		<< "  V:            compare the geometry shader with the face cache (voxel modes)" << std::endl
+		<< "  X:            compare the geometry shader with instanced cubes (voxel modes)" << std::endl
+		<< "  Y:            compare the multi view pass with one pass per view (multi view)" << std::endl
+		<< "  Z:            switch the level of detail of the point splats" << std::endl
+		<< "  IJKL:         rotate the light" << std::endl
+		<< "  1-6:          select face of the region of interest (-x, +x, -y, +y, -z, +z)" << std::endl
+		<< "  N/M:          shrink/grow the region at the selected face" << std::endl
+		<< "  F/G:          add/remove a clip plane facing the camera" << std::endl
+		<< "  Q/E:          move the last clip plane" << std::endl
+		<< "  O:            reset the region of interest" << std::endl
+		<< "  H/U:          hide the label under the cursor/show all labels (label volumes)" << std::endl
+		<< "  7:            benchmark the state changes of the pipelines, state blocks and render queue" << std::endl;
 
 	try {
 		DemoWindow window(1024, 1024, "3D Image Viewer");
-		OGLContext context(OGLContext::DebugSeverity::LOW);
+		OGLContext context(OGLContext::DebugSeverity::LOW, reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 		window.setKeyCallback(keyFunc);
 		window.setMouseCallback(mouseFunc);
 		window.setScrollCallback(scrollFunc);
 
-		Pipeline showVoxelsPipe;
-		showVoxelsPipe.depthStencil.depthTest = true;
-		Shader voxelVert(Shader::Type::VERTEX, "shaders/voxel.vert");
-		Shader voxelGeom(Shader::Type::GEOMETRY, "shaders/voxel.geom");
-		Shader shadingFrag(Shader::Type::FRAGMENT, "shaders/shading.frag");
-		Program showVoxelsShader(voxelVert, voxelGeom, shadingFrag);
-		showVoxelsPipe.shader = &showVoxelsShader;
+		// Linked programs are reused from disk if the sources and the
+		// driver did not change.
+		ProgramCache programs("shadercache");
+		// The labels do not depend on the format and compile while the
+		// user picks the file.
+		ProgramCache::Future showLabelsFuture = programs.loadAsync({
+			{Shader::Type::VERTEX, "shaders/voxel.vert"},
+			{Shader::Type::GEOMETRY, "shaders/labels.geom"},
+			{Shader::Type::FRAGMENT, "shaders/labels.frag"}
+		});
+		// The main programs are specialized for the format of the texture.
+		// The common RGBA float/unorm variant starts before the dialog as
+		// well, other formats restart them after the texture is loaded.
+		const std::vector<ProgramCache::Stage> showVoxelsStages = {
+			{Shader::Type::VERTEX, "shaders/voxel.vert"},
+			{Shader::Type::GEOMETRY, "shaders/voxel.geom"},
+			{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+		};
+		// Same pipeline, but the voxels are read from the SortedVoxelIndex
+		const std::vector<ProgramCache::Stage> showSortedVoxelsStages = {
+			{Shader::Type::VERTEX, "shaders/voxel_sorted.vert"},
+			{Shader::Type::GEOMETRY, "shaders/voxel.geom"},
+			{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+		};
+		// Static faces of the FaceIntervalCache, no geometry shader
+		const std::vector<ProgramCache::Stage> showFacesStages = {
+			{Shader::Type::VERTEX, "shaders/faces.vert"},
+			{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+		};
+		// Instanced cubes with the SortedVoxelIndex as instance buffer
+		const std::vector<ProgramCache::Stage> showCubesStages = {
+			{Shader::Type::VERTEX, "shaders/cubes.vert"},
+			{Shader::Type::FRAGMENT, "shaders/shading.frag"}
+		};
+		const Shader::Defines commonFormat = {{"VOXEL_CHANNELS", "4"}, {"VOXEL_INTEGER", "0"}};
+		ProgramCache::Future showVoxelsFuture = programs.loadAsync(showVoxelsStages, commonFormat);
+		ProgramCache::Future showSortedVoxelsFuture = programs.loadAsync(showSortedVoxelsStages, commonFormat);
+		ProgramCache::Future showFacesFuture = programs.loadAsync(showFacesStages, commonFormat);
+		ProgramCache::Future showCubesFuture = programs.loadAsync(showCubesStages, commonFormat);
+		InstancedCubeRenderer cubeRenderer;
 
 		std::string texFilename = "";
 		{
@@ -146,15 +451,69 @@ int main()
 		auto gliTex = gli::texture3d(gli::load(texFilename));
 		if (gliTex.empty())
 			throw std::exception("test tex not found");
-		gli::gl gliGL(gli::gl::PROFILE_GL33);
-		auto texFormat = gliGL.translate(gliTex.format(), gliTex.swizzles());
 
-		Texture myVoxelTex = Texture(Texture::Layout::TEX_3D, gliTex.extent().x, gliTex.extent().y, gliTex.extent().z,
-			static_cast<InternalFormat>(texFormat.Internal), 1);
+		// Other formats replace the common variants, which are discarded
+		// unfinished. They compile while the volume is prepared.
+		Shader::Defines atlasFormat = BrickAtlas::formatDefines(gliTex);
+		if(atlasFormat != commonFormat)
 		{
-			
-			myVoxelTex.setData(0, 0, SetDataFormat(texFormat.External),
-				SetDataType(texFormat.Type), gliTex.data());
+			showVoxelsFuture = programs.loadAsync(showVoxelsStages, atlasFormat);
+			showSortedVoxelsFuture = programs.loadAsync(showSortedVoxelsStages, atlasFormat);
+			showFacesFuture = programs.loadAsync(showFacesStages, atlasFormat);
+			showCubesFuture = programs.loadAsync(showCubesStages, atlasFormat);
+		}
+
+		auto prepare_start = std::chrono::high_resolution_clock::now();
+		Volume volume(gliTex);
+		BrickPyramid brickPyramid(volume);
+		auto prepare_end = std::chrono::high_resolution_clock::now();
+		std::cerr << "INF: Built luminance volume and brick pyramid in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(prepare_end - prepare_start).count() << " ms\n";
+		// Only the colors are paged, the luminance derived textures are dense.
+		GLint maxTextureSize;
+		glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+		if(any(greaterThan(volume.size(), ivec3(maxTextureSize))))
+			throw std::exception(("The volume is larger than GL_MAX_3D_TEXTURE_SIZE (" + std::to_string(maxTextureSize) + ")").c_str());
+
+		Program showVoxelsShader = showVoxelsFuture.get();
+		Program showSortedVoxelsShader = showSortedVoxelsFuture.get();
+		Program showFacesShader = showFacesFuture.get();
+		Program showCubesShader = showCubesFuture.get();
+		Program showLabelsShader = showLabelsFuture.get();
+		Pipeline showVoxelsPipe;
+		showVoxelsPipe.depthStencil.depthTest = true;
+		showVoxelsPipe.shader = &showVoxelsShader;
+		OctreeRenderer octreeRenderer(programs, atlasFormat);
+		ProjectionRenderer projectionRenderer(volume, brickPyramid, programs);
+		OccupancyMask occupancy(volume);
+		AmbientOcclusionVolume ambientOcclusion(volume, brickPyramid, occupancy);
+		ShadowVolume shadowVolume(volume, occupancy);
+		SparseVoxelOctree octree(occupancy);
+		BrickAtlas brickAtlas(gliTex, brickPyramid, VOXEL_BRICK_BUDGET);
+		// Luminance, ambient occlusion and light visibility (R8) and the occupancy bits
+		std::cerr << "INF: Dense luminance textures use " << (volume.numVoxels() * 3 + occupancy.memoryUsage()) / (1024 * 1024)
+			<< " MB in addition to the brick budget\n";
+		RegionOfInterest roi(volume.size());
+		s_roi = &roi;
+		VoxelDrawRanges voxelDrawRanges(brickPyramid, volume.size());
+		VoxelPicker picker(octree, occupancy, volume, gliTex);
+		SortedVoxelIndex sortedVoxels(volume);
+		FaceIntervalCache faceCache(volume);
+		PointSplatRenderer splatRenderer(volume, sortedVoxels, programs, atlasFormat);
+		FeedbackFaceCache feedbackCache(occupancy, programs, atlasFormat);
+		MultiViewRenderer multiView(volume.size(), programs, atlasFormat);
+		std::cerr << "INF: " << programs.numLoaded() + programs.numCompiled() << " programs ready in " << programs.loadTime()
+			<< " ms (" << programs.numLoaded() << " from the cache, " << programs.numCompiled() << " compiled)\n";
+		// Integer textures are segmentations
+		std::unique_ptr<LabelVolume> labels;
+		Pipeline showLabelsPipe;
+		showLabelsPipe.depthStencil.depthTest = true;
+		showLabelsPipe.shader = &showLabelsShader;
+		if(LabelVolume::isLabelTexture(gliTex))
+		{
+			labels.reset(new LabelVolume(gliTex));
+			s_hasLabels = true;
+			s_renderMode = RenderMode::LABELS;
 		}
 
 		// Create the vertex formats
@@ -167,10 +526,47 @@ int main()
 		SamplerState pointSampler(SamplerState::Filter::NEAREST, SamplerState::Filter::NEAREST, SamplerState::Filter::NEAREST,
 			1.0f, SamplerState::DepthCompareFunc::DISABLE, SamplerState::BorderHandling::BORDER, zero);
 		showVoxelsPipe.samplerState[0] = &pointSampler;
+		SamplerState linearSampler(SamplerState::Filter::LINEAR, SamplerState::Filter::LINEAR, SamplerState::Filter::NONE,
+			1.0f, SamplerState::DepthCompareFunc::DISABLE, SamplerState::BorderHandling::CLAMP);
+		showVoxelsPipe.samplerState[4] = &linearSampler;
+		Pipeline showSortedVoxelsPipe = showVoxelsPipe;
+		showSortedVoxelsPipe.shader = &showSortedVoxelsShader;
+		Pipeline showFacesPipe = showVoxelsPipe;
+		showFacesPipe.shader = &showFacesShader;
+		Pipeline showCubesPipe = showVoxelsPipe;
+		showCubesPipe.shader = &showCubesShader;
+		showCubesPipe.vertexFormat = &cubeRenderer.vertexFormat();
+		// The states of the main loop do not change anymore
+		PipelineStateBlock showVoxelsBlock(showVoxelsPipe);
+		PipelineStateBlock showSortedVoxelsBlock(showSortedVoxelsPipe);
+		PipelineStateBlock showFacesBlock(showFacesPipe);
+		PipelineStateBlock showCubesBlock(showCubesPipe);
+		PipelineStateBlock showLabelsBlock(showLabelsPipe);
 
-		// Create a uniform buffers
-		Buffer transformUBO(Buffer::Type::UNIFORM, sizeof(TransformUniforms), 1, Buffer::Usage::SUB_DATA_UPDATE);
+		// Per-frame uniforms are written into a persistent mapped ring
+		// with up to three frames in flight.
+		UniformRing uniformRing(sizeof(TransformUniforms), 3);
 		TransformUniforms transformUniforms;
+
+		// The voxel draws of a frame go through a render queue. All voxel
+		// pipelines share these bindings, only the offset of the per-frame
+		// uniform block changes.
+		using BufferBinding = ResourceBindings::BufferBinding;
+		RenderQueue frameQueue;
+		ResourceBindings voxelBindings;
+		voxelBindings.textures = {
+			{&brickAtlas.atlasTexture(), 0}, {&ambientOcclusion.texture(), 3}, {&shadowVolume.texture(), 4},
+			{&occupancy.texture(), 5}, {&brickAtlas.pageTableTexture(), 6}
+		};
+		voxelBindings.buffers = {
+			{&uniformRing.buffer(), BufferBinding::Target::UNIFORM, 0, 0, sizeof(TransformUniforms)},
+			{&sortedVoxels.buffer(), BufferBinding::Target::SHADER_STORAGE, 1, 0, -1}
+		};
+		if(faceCache.isValid())
+			voxelBindings.buffers.push_back({faceCache.buffer(), BufferBinding::Target::SHADER_STORAGE, 2, 0, -1});
+		// The instanced cubes read the sorted voxels per instance
+		ResourceBindings cubeBindings = voxelBindings;
+		cubeBindings.buffers.push_back({&sortedVoxels.buffer(), BufferBinding::Target::VERTEX, 0, 0, -1});
 		
 		s_camPos = vec3(float(gliTex.extent().x) / 2.0f,
 			float(gliTex.extent().y / 2.0f),
@@ -182,26 +578,189 @@ int main()
 		while(window.isOpen())
 		{
 			auto time_start = std::chrono::high_resolution_clock::now();		
+			context.resetStatistics();
 			transformUniforms.viewProjection = glm::perspective(40.0f * 3.1415926f / 180.0f, 1.0f, 0.1f, 100.0f) * 
 				glm::lookAt(s_camPos, s_camPos + s_camDir, vec3(0.0f, 1.0f, 0.0f));
 			transformUniforms.cameraPosition = s_camPos;
 			transformUniforms.shadownTresh = s_discardThresh;
-			transformUBO.subDataUpdate(0, sizeof(TransformUniforms), &transformUniforms);
+			transformUniforms.lightDirection = s_lightDir;
+			transformUniforms.volumeSize = volume.size();
+			UniformRing::Block transformBlock = uniformRing.push(transformUniforms);
 
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			myVoxelTex.bindAsTexture(0);
+			GLsizei numDrawnVoxels = 0;
+			// The octree is needed for picking in all modes
+			occupancy.update(s_discardThresh);
+			octree.update();
+
+			if(s_renderMode == RenderMode::VOXELS || s_renderMode == RenderMode::FACE_CACHE
+				|| s_renderMode == RenderMode::INSTANCED_CUBES || s_renderMode == RenderMode::CAPTURED_FACES)
+			{
+				ambientOcclusion.update();
+				shadowVolume.update(s_lightDir);
+				brickAtlas.update(transformUniforms.viewProjection, s_camPos, occupancy.threshold(), roi);
+				voxelBindings.buffers[0].offset = transformBlock.offset;
+				cubeBindings.buffers[0].offset = transformBlock.offset;
+				// The benchmarks and the feedback cache draw directly
+				voxelBindings.apply();
+				if(s_benchmarkCubes)
+					cubeRenderer.benchmark(context, showSortedVoxelsPipe, showCubesPipe, volume, occupancy.threshold());
+				s_benchmarkCubes = false;
+				if(s_compareFaceCache && faceCache.isValid())
+					compareFaceCache(context, showSortedVoxelsPipe, sortedVoxels, showFacesPipe, faceCache, occupancy);
+				s_compareFaceCache = false;
+				if(s_renderMode == RenderMode::CAPTURED_FACES)
+					feedbackCache.update(context, sortedVoxels, voxelDrawRanges, roi);
+				if(s_renderMode == RenderMode::CAPTURED_FACES && feedbackCache.isValid())
+				{
+					// Expanded once per threshold and region
+					feedbackCache.draw(context);
+					if(roi.isEntireVolume())
+					{
+						GLint first;
+						sortedVoxels.visibleRange(occupancy.threshold(), first, numDrawnVoxels);
+					} else numDrawnVoxels = GLsizei(voxelDrawRanges.numDrawnVoxels());
+				}
+				// The face cache and the instanced cubes ignore the region of
+				// interest, cropped volumes always use the geometry shader.
+				else if(roi.isEntireVolume())
+				{
+					GLint first;
+					sortedVoxels.visibleRange(occupancy.threshold(), first, numDrawnVoxels);
+					if(s_renderMode == RenderMode::FACE_CACHE && faceCache.isValid())
+					{
+						int threshold = occupancy.threshold();
+						frameQueue.submit(showFacesBlock, &voxelBindings, [&faceCache, threshold]() { faceCache.draw(threshold); });
+					} else if(s_renderMode == RenderMode::INSTANCED_CUBES) {
+						GLsizei count = numDrawnVoxels;
+						frameQueue.submit(showCubesBlock, &cubeBindings, [&cubeRenderer, first, count]() { cubeRenderer.draw(GLuint(first), count); });
+					} else if(numDrawnVoxels > 0) {
+						// Exactly the voxels above the threshold
+						DrawArgs args;
+						args.primitive = GL_POINTS;
+						args.first = first;
+						args.count = numDrawnVoxels;
+						frameQueue.submit(showSortedVoxelsBlock, &voxelBindings, args);
+					}
+				} else {
+					voxelDrawRanges.update(roi, occupancy.threshold());
+					frameQueue.submit(showVoxelsBlock, &voxelBindings, [&voxelDrawRanges]() { voxelDrawRanges.draw(); });
+					numDrawnVoxels = GLsizei(voxelDrawRanges.numDrawnVoxels());
+				}
+			} else if(s_renderMode == RenderMode::POINT_SPLATS) {
+				ambientOcclusion.update();
+				shadowVolume.update(s_lightDir);
+				brickAtlas.update(transformUniforms.viewProjection, s_camPos, occupancy.threshold(), roi);
+				brickAtlas.bindAsTexture(0, 6);
+				ambientOcclusion.bindAsTexture(3);
+				shadowVolume.bindAsTexture(4);
+				uniformRing.bindAsUniformBuffer(0, transformBlock);
+				// Small volumes have less levels
+				int level = std::min(s_splatLevel, splatRenderer.numLevels() - 1);
+				splatRenderer.draw(context, level, occupancy.threshold(), transformUniforms.viewProjection, roi);
+				numDrawnVoxels = splatRenderer.numVisible(level, occupancy.threshold());
+			} else if(s_renderMode == RenderMode::MULTI_VIEW) {
+				// The slices go through the center of the region box
+				multiView.setViews(transformUniforms.viewProjection, s_camPos, roi);
+				ambientOcclusion.update();
+				shadowVolume.update(s_lightDir);
+				// The slices need bricks outside of the camera frustum
+				brickAtlas.update(multiView.volumeViewProjection(), s_camPos, occupancy.threshold(), roi);
+				brickAtlas.bindAsTexture(0, 6);
+				ambientOcclusion.bindAsTexture(3);
+				shadowVolume.bindAsTexture(4);
+				occupancy.bindAsTexture(5);
+				uniformRing.bindAsUniformBuffer(0, transformBlock);
+				sortedVoxels.bindAsShaderStorageBuffer(1);
+				// Cropped regions draw the 3D view from the ranges like the
+				// voxel mode, only their bricks are requested.
+				const VoxelDrawRanges* ranges = nullptr;
+				if(!roi.isEntireVolume())
+				{
+					voxelDrawRanges.update(roi, occupancy.threshold());
+					ranges = &voxelDrawRanges;
+					numDrawnVoxels = GLsizei(voxelDrawRanges.numDrawnVoxels());
+				} else {
+					GLint first;
+					sortedVoxels.visibleRange(occupancy.threshold(), first, numDrawnVoxels);
+				}
+				if(s_benchmarkMultiView)
+					multiView.benchmark(context, sortedVoxels, occupancy.threshold(), ranges);
+				s_benchmarkMultiView = false;
+				multiView.draw(context, sortedVoxels, occupancy.threshold(), ranges);
+			} else if(s_renderMode == RenderMode::LABELS) {
+				// Hidden labels only change the label table
+				labels->bind(7, 4);
+				uniformRing.bindAsUniformBuffer(0, transformBlock);
+				context.setState(showLabelsBlock);
+				labels->draw();
+				numDrawnVoxels = GLsizei(labels->numDrawnVoxels());
+			} else if(s_renderMode == RenderMode::OCTREE) {
+				brickAtlas.update(transformUniforms.viewProjection, s_camPos, occupancy.threshold(), roi);
+				brickAtlas.bindAsTexture(0, 6);
+				octreeRenderer.draw(context, octree, transformUniforms.viewProjection, s_lightDir, roi);
+			} else {
+				ProjectionMode mode = s_renderMode == RenderMode::MAXIMUM_PROJECTION ? ProjectionMode::MAXIMUM : ProjectionMode::AVERAGE;
+				projectionRenderer.draw(context, mode, transformUniforms.viewProjection);
+				if(s_compareProjection)
+					compareProjectionWithCPU(volume, brickPyramid, mode, transformUniforms.viewProjection, projectionRenderer.stepSize());
+			}
+			frameQueue.flush(context);
+			s_compareProjection = false;
+			if(s_benchmarkPicking)
+				picker.benchmark(100000);
+			s_benchmarkPicking = false;
+			if(s_benchmarkStateChanges)
+				benchmarkStateChanges(context, {&showVoxelsPipe, &showSortedVoxelsPipe, &showFacesPipe, &showCubesPipe, &showLabelsPipe});
+			s_benchmarkStateChanges = false;
+
+			// Voxel under the cursor
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			PickResult pick;
+			// The labels have their own occupancy: background and hidden
+			// labels do not stop the ray.
+			VoxelPicker::OccupancyTest isLabelOccupied;
+			if(labels && s_renderMode == RenderMode::LABELS)
+			{
+				const LabelVolume* labelVolume = labels.get();
+				isLabelOccupied = [labelVolume](const ivec3& _voxel) {
+					return labelVolume->isVisible(labelVolume->at(_voxel.x, _voxel.y, _voxel.z));
+				};
+			}
+			bool picked = picker.pick(transformUniforms.viewProjection, s_cursorPos, ivec2(viewport[2], viewport[3]), &roi, pick,
+				isLabelOccupied);
+			if(labels && s_hideLabel && picked)
+			{
+				int label = labels->at(pick.voxel.x, pick.voxel.y, pick.voxel.z);
+				labels->setVisible(label, false);
+				std::cerr << "\nINF: Label " << label << " hidden\n";
+			}
+			if(labels && s_showAllLabels)
+				labels->showAll();
+			s_hideLabel = false;
+			s_showAllLabels = false;
 
-			transformUBO.bindAsUniformBuffer(0);
-			context.setState(showVoxelsPipe);
-			glDrawArrays(GL_POINTS, 0, gliTex.extent().x * gliTex.extent().y * gliTex.extent().z);
+			// All draws which read the uniform blocks of this frame are issued
+			uniformRing.endFrame();
 
 			// Input handling
 			window.handleEventsAndPresent();	
 			auto time_end = std::chrono::high_resolution_clock::now();
 			tick(float(std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count()) / 100.0f);
 
-			std::cerr << "discard threshold (R- T+): " << s_discardThresh << "        \r";
+			std::cerr << "discard threshold (R- T+): " << s_discardThresh << "  resident bricks: "
+				<< brickAtlas.numResident() << '/' << brickAtlas.numSlots() << " (" << brickAtlas.numLoading() << " loading)  drawn voxels: "
+				<< size_t(numDrawnVoxels) * 100 / volume.numVoxels() << "%  GL state calls: "
+				<< context.statistics().issuedCalls << " (" << context.statistics().skippedCalls << " skipped)  queued draws: "
+				<< frameQueue.statistics().numItems << " (" << frameQueue.statistics().stateChanges << " state / "
+				<< frameQueue.statistics().bindingChanges << " binding changes)  uniform stalls: "
+				<< uniformRing.numStalls() << "  cursor: ";
+			if(picked)
+				std::cerr << '(' << pick.voxel.x << ", " << pick.voxel.y << ", " << pick.voxel.z << ") luminance "
+					<< int(pick.luminance) << "        \r";
+			else std::cerr << "-                          \r";
 		}
 	} catch(std::exception _ex) {
 		std::cerr << "ERR: " << _ex.what();